@@ -0,0 +1,184 @@
+/*
+ * Copyright (c) 2019, Institute of Electronics and Computer Science (EDI)
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * Author: Atis Elsts
+ */
+
+
+/*
+ * File: angles.h
+ * Fast arc tangents, for the orientation of the device from the direction of gravity.
+ *
+ * `atan2_fast_f()` reduces the angle to [0, pi/4] with the ratio of the smaller
+ * to the larger absolute value, and takes the odd polynomial of degree 9 from
+ * Abramowitz and Stegun 4.4.47 there, so the error is within 2e-5 rad.
+ * It has no branches, so the loops over blocks of it are vectorized.
+ *
+ * `cordic_atan2_q13()` needs no multiplications: the CORDIC rotations with shifts
+ * turn the vector onto the x axis, adding up the angles from a table.
+ * The angle is in Q13 radians, the error is within 3e-4 rad (about two units of the last place).
+ * The length of the vector comes out as well, scaled by the gain of the rotations.
+ */
+
+#ifndef ANGLES_H
+#define ANGLES_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <math.h>
+
+// -----------------------------------------------------------
+
+static inline float atan2_fast_f(float y, float x)
+{
+    float ax = fabsf(x);
+    float ay = fabsf(y);
+    float hi = ax > ay ? ax : ay;
+    float lo = ax > ay ? ay : ax;
+    // zero for (0, 0)
+    float a = lo / (hi > 1e-30f ? hi : 1e-30f);
+    float s = a * a;
+    float r = a * (0.9998660f + s * (-0.3302995f + s * (0.1801410f + s * (-0.0851330f + s * 0.0208351f))));
+    // only constants are selected, so that the loops have no branches:
+    // the results are the same as of pi/2 - r, pi - r and -r
+    r = (ay > ax ? (float)M_PI_2 : 0.0f) + (ay > ax ? -1.0f : 1.0f) * r;
+    r = (x < 0.0f ? (float)M_PI : 0.0f) + (x < 0.0f ? -1.0f : 1.0f) * r;
+    return (y < 0.0f ? -1.0f : 1.0f) * r;
+}
+
+// r[k] = atan2_fast_f(y[k], x[k])
+static inline void atan2_block_f(const float *restrict y, const float *restrict x,
+                                 float *restrict r, int n)
+{
+    int k;
+    for (k = 0; k < n; ++k) {
+        r[k] = atan2_fast_f(y[k], x[k]);
+    }
+}
+
+// -----------------------------------------------------------
+
+#define ANGLE_Q13_PI 25736
+#define ANGLE_Q13_PI_2 12868
+
+#define CORDIC_ITERATIONS 14
+
+// The gain of the rotations, 1.64676 in Q14
+#define CORDIC_GAIN_Q14 26981
+
+// atan(2^-i) in Q13
+static const int16_t cordic_atan_table_q13[CORDIC_ITERATIONS] = {
+    6434, 3798, 2007, 1019, 511, 256, 128, 64, 32, 16, 8, 4, 2, 1
+};
+
+// The angle of (x, y) in Q13 radians, from -pi to pi, and zero for (0, 0); the magnitude
+// times the gain of CORDIC_GAIN_Q14 is returned in `magnitude`, if not NULL.
+// |x| and |y| must be below 2^29.
+static inline int32_t cordic_atan2_q13(int32_t y, int32_t x, int32_t *magnitude)
+{
+    int32_t angle = 0;
+    int i;
+
+    if (x == 0 && y == 0) {
+        if (magnitude) {
+            *magnitude = 0;
+        }
+        return 0;
+    }
+
+    // start from the right half-plane, where the rotations converge
+    if (x < 0) {
+        angle = y >= 0 ? ANGLE_Q13_PI : -ANGLE_Q13_PI;
+        x = -x;
+        y = -y;
+    }
+    for (i = 0; i < CORDIC_ITERATIONS; ++i) {
+        int32_t dx = y >> i;
+        int32_t dy = x >> i;
+        if (y > 0) {
+            x += dx;
+            y -= dy;
+            angle += cordic_atan_table_q13[i];
+        } else {
+            x -= dx;
+            y += dy;
+            angle -= cordic_atan_table_q13[i];
+        }
+    }
+    if (magnitude) {
+        *magnitude = x;
+    }
+    return angle;
+}
+
+// -----------------------------------------------------------
+//
+// The orientation of a device at rest, from the direction of gravity (x, y, z):
+// the pitch atan2(-x, sqrt(y^2 + z^2)) from -pi/2 to pi/2, the roll atan2(y, z)
+// from -pi to pi, and the tilt atan2(sqrt(x^2 + y^2), z) from 0 to pi, the angle
+// from the z axis. These are the same as asin(-x / g) and acos(z / g), with g the length
+// of the vector, but defined for any vector and with the same precision for all angles.
+//
+
+enum {
+    ORIENTATION_PITCH,
+    ORIENTATION_ROLL,
+    ORIENTATION_TILT,
+    ORIENTATION_NUM_ANGLES
+};
+
+// One of the angles, with the fast arc tangent
+static inline float orientation_angle_f(int x, int y, int z, int angle)
+{
+    switch (angle) {
+    case ORIENTATION_PITCH:
+        return atan2_fast_f(-x, sqrtf(y * y + z * z));
+    case ORIENTATION_ROLL:
+        return atan2_fast_f(y, z);
+    default:
+        return atan2_fast_f(sqrtf(x * x + y * y), z);
+    }
+}
+
+// The same in Q13 radians, with the lengths from the CORDIC instead of square roots:
+// a coordinate is multiplied by the gain when it is put together with a length.
+static inline int32_t orientation_angle_q13(int x, int y, int z, int angle)
+{
+    int32_t length;
+    switch (angle) {
+    case ORIENTATION_PITCH:
+        cordic_atan2_q13(y * 65536, z * 65536, &length);
+        return cordic_atan2_q13(-x * CORDIC_GAIN_Q14 * 4, length, NULL);
+    case ORIENTATION_ROLL:
+        return cordic_atan2_q13(y * 65536, z * 65536, NULL);
+    default:
+        cordic_atan2_q13(y * 65536, x * 65536, &length);
+        return cordic_atan2_q13(length, z * CORDIC_GAIN_Q14 * 4, NULL);
+    }
+}
+
+#endif // ANGLES_H
@@ -33,99 +33,15 @@
  * Reverse bits in a n-bit word: needed for the non-recursive implementation of FFT
  */
 
-#include "main.h"
+#include "tables.h"
 
 #ifndef BITREV_H
 #define BITREV_H
 
-static const uint8_t bitrev_table_32[] = 
-{
-    0, 16,  8, 24,  4, 20, 12, 28,  2, 18, 10, 26,  6, 22, 14, 30, 
-    1, 17,  9, 25,  5, 21, 13, 29,  3, 19, 11, 27,  7, 23, 15, 31,
-};
-
-static const uint8_t bitrev_table_64[] = 
-{
-    0, 32, 16, 48,  8, 40, 24, 56,  4, 36, 20, 52, 12, 44, 28, 60, 
-    2, 34, 18, 50, 10, 42, 26, 58,  6, 38, 22, 54, 14, 46, 30, 62, 
-    1, 33, 17, 49,  9, 41, 25, 57,  5, 37, 21, 53, 13, 45, 29, 61, 
-    3, 35, 19, 51, 11, 43, 27, 59,  7, 39, 23, 55, 15, 47, 31, 63, 
-};
-
-static const uint8_t bitrev_table_128[] = 
-{
-    0,  64,  32,  96,  16,  80,  48, 112,   8,  72,  40, 104,  24,  88,  56, 120, 
-    4,  68,  36, 100,  20,  84,  52, 116,  12,  76,  44, 108,  28,  92,  60, 124, 
-    2,  66,  34,  98,  18,  82,  50, 114,  10,  74,  42, 106,  26,  90,  58, 122, 
-    6,  70,  38, 102,  22,  86,  54, 118,  14,  78,  46, 110,  30,  94,  62, 126, 
-    1,  65,  33,  97,  17,  81,  49, 113,   9,  73,  41, 105,  25,  89,  57, 121, 
-    5,  69,  37, 101,  21,  85,  53, 117,  13,  77,  45, 109,  29,  93,  61, 125, 
-    3,  67,  35,  99,  19,  83,  51, 115,  11,  75,  43, 107,  27,  91,  59, 123, 
-    7,  71,  39, 103,  23,  87,  55, 119,  15,  79,  47, 111,  31,  95,  63, 127, 
-};
-
-static const uint8_t bitrev_table_256[] = 
-{
-     0, 128,  64, 192,  32, 160,  96, 224,  16, 144,  80, 208,  48, 176, 112, 240, 
-     8, 136,  72, 200,  40, 168, 104, 232,  24, 152,  88, 216,  56, 184, 120, 248, 
-     4, 132,  68, 196,  36, 164, 100, 228,  20, 148,  84, 212,  52, 180, 116, 244, 
-    12, 140,  76, 204,  44, 172, 108, 236,  28, 156,  92, 220,  60, 188, 124, 252, 
-     2, 130,  66, 194,  34, 162,  98, 226,  18, 146,  82, 210,  50, 178, 114, 242, 
-    10, 138,  74, 202,  42, 170, 106, 234,  26, 154,  90, 218,  58, 186, 122, 250, 
-     6, 134,  70, 198,  38, 166, 102, 230,  22, 150,  86, 214,  54, 182, 118, 246, 
-    14, 142,  78, 206,  46, 174, 110, 238,  30, 158,  94, 222,  62, 190, 126, 254, 
-     1, 129,  65, 193,  33, 161,  97, 225,  17, 145,  81, 209,  49, 177, 113, 241, 
-     9, 137,  73, 201,  41, 169, 105, 233,  25, 153,  89, 217,  57, 185, 121, 249, 
-     5, 133,  69, 197,  37, 165, 101, 229,  21, 149,  85, 213,  53, 181, 117, 245, 
-    13, 141,  77, 205,  45, 173, 109, 237,  29, 157,  93, 221,  61, 189, 125, 253, 
-     3, 131,  67, 195,  35, 163,  99, 227,  19, 147,  83, 211,  51, 179, 115, 243, 
-    11, 139,  75, 203,  43, 171, 107, 235,  27, 155,  91, 219,  59, 187, 123, 251, 
-     7, 135,  71, 199,  39, 167, 103, 231,  23, 151,  87, 215,  55, 183, 119, 247, 
-    15, 143,  79, 207,  47, 175, 111, 239,  31, 159,  95, 223,  63, 191, 127, 255, 
-};
-
-#if FREQUENCY_WINDOW_SIZE == 32
-
-static inline uint16_t bitrev(uint16_t j)
-{
-    return bitrev_table_32[j];
-}
-
-#elif FREQUENCY_WINDOW_SIZE == 64
-
-static inline uint16_t bitrev(uint16_t j)
-{
-    return bitrev_table_64[j];
-}
-
-#elif FREQUENCY_WINDOW_SIZE == 128
-
+// `bitrev_table` is generated for FREQUENCY_WINDOW_SIZE, see tables.h
 static inline uint16_t bitrev(uint16_t j)
 {
-    return bitrev_table_128[j];
+    return bitrev_table[j];
 }
 
-#elif FREQUENCY_WINDOW_SIZE == 256
-
-static inline uint16_t bitrev(uint16_t j)
-{
-    return bitrev_table_256[j];
-}
-
-#else
-
-/* slower, but a more generic algorithm */
-
-static uint16_t bitrev(uint16_t j, uint16_t nbits)
-{
-  uint16_t k = 0;
-  for (; nbits > 0; nbits--) {
-    k = (k << 1) + (j & 1);
-    j = j >> 1;
-  }
-  return k;
-}
-
-#endif
-
 #endif // BITREV_H
@@ -0,0 +1,1873 @@
+/*
+ * Copyright (c) 2019, Institute of Electronics and Computer Science (EDI)
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * Author: Atis Elsts
+ */
+
+/*
+ * File: check.c
+ * An application that checks the optimized variants of the features
+ * against their reference versions, and compares their speed.
+ *
+ * Each check runs one or more reference functions and a candidate function
+ * on the same inputs, collects their outputs with the output sink,
+ * and compares them value by value. When there are several reference functions,
+ * their outputs for each window are concatenated, e.g. `median` and `iqr`
+ * give the expected output of `median_iqr`.
+ *
+ * The inputs are all of the recordings in sample-data, in pieces of CHECK_NSAMPLES,
+ * and synthetic inputs with extreme and degenerate values.
+ * The program exits with status 1 if any of the checks fail.
+ */
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <limits.h>
+#include <time.h>
+
+#include "adaptation.h"
+
+#define DO_SINK_OUTPUT 1
+#include "main.h"
+
+// -----------------------------------------------------------
+
+// At least three of the longest windows; up to windows of 8192 samples,
+// the recordings of 30000 samples still give an input each
+#ifndef CHECK_NSAMPLES
+#define CHECK_NSAMPLES max(2048, 3 * max(TIME_WINDOW_SIZE, FREQUENCY_WINDOW_SIZE))
+#endif
+
+// the input data; the features are run on a copy of each input in turn
+accel_t data[CHECK_NSAMPLES];
+
+// -----------------------------------------------------------
+
+#include "features-time-basic.c"
+#include "features-time-sort.c"
+#include "features-time-advanced.c"
+#include "features-frequency.c"
+#include "transforms-filters.c"
+#include "pipeline.c"
+
+// the library, linked from libfeatures.a
+#include "feature-extraction.h"
+
+// -----------------------------------------------------------
+// The recordings
+
+static const accel_t check_recording_00001[] = {
+#include "sample-data/00001.c"
+};
+static const accel_t check_recording_00001_1[] = {
+#include "sample-data/00001-1.c"
+};
+static const accel_t check_recording_00001_2[] = {
+#include "sample-data/00001-2.c"
+};
+static const accel_t check_recording_00002[] = {
+#include "sample-data/00002.c"
+};
+static const accel_t check_recording_00002_1[] = {
+#include "sample-data/00002-1.c"
+};
+static const accel_t check_recording_00002_2[] = {
+#include "sample-data/00002-2.c"
+};
+static const accel_t check_recording_00003[] = {
+#include "sample-data/00003.c"
+};
+static const accel_t check_recording_00003_1[] = {
+#include "sample-data/00003-1.c"
+};
+static const accel_t check_recording_00003_2[] = {
+#include "sample-data/00003-2.c"
+};
+static const accel_t check_recording_00004[] = {
+#include "sample-data/00004.c"
+};
+static const accel_t check_recording_00004_1[] = {
+#include "sample-data/00004-1.c"
+};
+static const accel_t check_recording_00004_2[] = {
+#include "sample-data/00004-2.c"
+};
+static const accel_t check_recording_00005[] = {
+#include "sample-data/00005.c"
+};
+static const accel_t check_recording_00005_1[] = {
+#include "sample-data/00005-1.c"
+};
+static const accel_t check_recording_00005_2[] = {
+#include "sample-data/00005-2.c"
+};
+static const accel_t check_recording_00007[] = {
+#include "sample-data/00007.c"
+};
+static const accel_t check_recording_00007_1[] = {
+#include "sample-data/00007-1.c"
+};
+static const accel_t check_recording_00007_2[] = {
+#include "sample-data/00007-2.c"
+};
+
+typedef struct {
+    const char *name;
+    const accel_t *samples;
+    unsigned num_samples;
+} check_recording_t;
+
+#define CHECK_RECORDING_ENTRY(name) \
+    { #name, check_recording_##name, sizeof(check_recording_##name) / sizeof(accel_t) }
+
+static const check_recording_t check_recordings[] = {
+    CHECK_RECORDING_ENTRY(00001),
+    CHECK_RECORDING_ENTRY(00001_1),
+    CHECK_RECORDING_ENTRY(00001_2),
+    CHECK_RECORDING_ENTRY(00002),
+    CHECK_RECORDING_ENTRY(00002_1),
+    CHECK_RECORDING_ENTRY(00002_2),
+    CHECK_RECORDING_ENTRY(00003),
+    CHECK_RECORDING_ENTRY(00003_1),
+    CHECK_RECORDING_ENTRY(00003_2),
+    CHECK_RECORDING_ENTRY(00004),
+    CHECK_RECORDING_ENTRY(00004_1),
+    CHECK_RECORDING_ENTRY(00004_2),
+    CHECK_RECORDING_ENTRY(00005),
+    CHECK_RECORDING_ENTRY(00005_1),
+    CHECK_RECORDING_ENTRY(00005_2),
+    CHECK_RECORDING_ENTRY(00007),
+    CHECK_RECORDING_ENTRY(00007_1),
+    CHECK_RECORDING_ENTRY(00007_2),
+};
+
+// -----------------------------------------------------------
+// The synthetic inputs
+
+static uint32_t check_random_state;
+
+static inline int8_t check_random(void)
+{
+    // xorshift32
+    check_random_state ^= check_random_state << 13;
+    check_random_state ^= check_random_state >> 17;
+    check_random_state ^= check_random_state << 5;
+    return (int8_t)(check_random_state >> 24);
+}
+
+typedef int8_t (*check_generator_t)(int i, int axis);
+
+static int8_t check_all_min(int i, int axis) { return -128; }
+static int8_t check_all_max(int i, int axis) { return 127; }
+static int8_t check_all_zero(int i, int axis) { return 0; }
+static int8_t check_alternating(int i, int axis) { return (i + axis) & 1 ? 127 : -128; }
+// a step at the middle of each window
+static int8_t check_square(int i, int axis) { return (i / (TIME_WINDOW_SIZE / 2)) & 1 ? 100 : -100; }
+static int8_t check_ramp(int i, int axis) { return (int8_t)(i * (axis + 1)); }
+// steps of two or more equal values, up and then down
+static int8_t check_staircase(int i, int axis)
+{
+    int step = (i / (axis + 2)) % 32;
+    return (int8_t)((step < 16 ? step : 31 - step) * 8 - 64);
+}
+static int8_t check_uniform(int i, int axis) { return check_random(); }
+// many equal values
+static int8_t check_noisy_constant(int i, int axis) { return 50 + (check_random() & 3) - 2; }
+// mostly constant with rare spikes
+static int8_t check_impulses(int i, int axis) { return (check_random() & 63) == 0 ? 127 : -1; }
+// a device at rest in different positions, moving in between
+static int8_t check_resting(int i, int axis)
+{
+    return (i / 300) % 3 == 2 ? check_random() : (int8_t)((i / 300) * 37 + axis * 11);
+}
+
+typedef struct {
+    const char *name;
+    check_generator_t f;
+} check_synthetic_t;
+
+static const check_synthetic_t check_synthetic[] = {
+    { "all -128", check_all_min },
+    { "all 127", check_all_max },
+    { "all 0", check_all_zero },
+    { "alternating", check_alternating },
+    { "square", check_square },
+    { "ramp", check_ramp },
+    { "staircase", check_staircase },
+    { "uniform", check_uniform },
+    { "noisy constant", check_noisy_constant },
+    { "impulses", check_impulses },
+    { "resting", check_resting },
+};
+
+// -----------------------------------------------------------
+// Reference versions of some features, written for clarity rather than speed
+
+// the spectral features with the recursive FFT instead of the iterative one
+static void check_spectral_fftr(spectral_feature_function_f_t f, int axis)
+{
+    int i;
+    float re[FREQUENCY_WINDOW_SIZE];
+    float im[FREQUENCY_WINDOW_SIZE];
+
+    LOG("axis=%d\n", axis);
+    spectral_window_init();
+    for (i = 0; i <= NSAMPLES - FREQUENCY_WINDOW_SIZE;
+         i += PERIODIC_COMPUTATION_WINDOW_SIZE) {
+        int32_t sum = spectral_load_f(re, &data[i], axis);
+        memset(im, 0, sizeof(im));
+        fftr(re, im, FREQUENCY_WINDOW_SIZE);
+        spectral_detrend_f(re, sum);
+        f(re, im, axis);
+    }
+}
+
+static void check_spectral_density_fftr(int axis)
+{
+    check_spectral_fftr(spectral_feature_density_f, axis);
+}
+
+static void check_spectral_histogram_fftr(int axis)
+{
+    check_spectral_fftr(spectral_feature_histogram_f, axis);
+}
+
+// the spectral density with a direct DFT in double precision
+static void check_spectral_density_dft(int axis)
+{
+    int i, j, k;
+    double x[FREQUENCY_WINDOW_SIZE];
+
+    LOG("axis=%d\n", axis);
+    for (i = 0; i <= NSAMPLES - FREQUENCY_WINDOW_SIZE;
+         i += PERIODIC_COMPUTATION_WINDOW_SIZE) {
+        double mean = 0;
+        for (j = 0; j < FREQUENCY_WINDOW_SIZE; ++j) {
+            mean += data[i + j].v[axis];
+        }
+        mean = SPECTRAL_DETREND ? mean / FREQUENCY_WINDOW_SIZE : 0;
+        for (j = 0; j < FREQUENCY_WINDOW_SIZE; ++j) {
+            double phase = 2 * M_PI * j / FREQUENCY_WINDOW_SIZE;
+            double w = SPECTRAL_WINDOW_A0 - SPECTRAL_WINDOW_A1 * cos(phase)
+                + SPECTRAL_WINDOW_A2 * cos(2 * phase);
+            x[j] = (data[i + j].v[axis] - mean) * w;
+        }
+        for (k = 0; k <= FREQUENCY_WINDOW_SIZE / 2; ++k) {
+            double re = 0, im = 0;
+            for (j = 0; j < FREQUENCY_WINDOW_SIZE; ++j) {
+                double phase = 2 * M_PI * j * k / FREQUENCY_WINDOW_SIZE;
+                re += x[j] * cos(phase);
+                im -= x[j] * sin(phase);
+            }
+            OUTPUT_F(re * re + im * im, result_f.v[axis]);
+            LOG("\n");
+        }
+    }
+}
+
+// the maximal nonzero frequency with a loop from the Nyquist frequency down
+static void check_spectral_maxima_loop_f(float re[], float im[], int axis)
+{
+    int j;
+    for (j = FREQUENCY_WINDOW_SIZE / 2; j >= 0; --j) {
+        float msq = re[j] * re[j] + im[j] * im[j];
+        if (msq > SPECTRAL_MAXIMUM_EPSILON) {
+            OUTPUT_F(msq, result_f.v[axis]);
+            LOG("\n");
+            break;
+        }
+    }
+}
+
+static void check_spectral_maxima_loop_i(int16_t re[], int16_t im[], int axis)
+{
+    int j;
+    for (j = FREQUENCY_WINDOW_SIZE / 2; j >= 0; --j) {
+        uint32_t msq = (uint32_t)re[j] * re[j] + (uint32_t)im[j] * im[j];
+        if (msq > SPECTRAL_MAXIMUM_EPSILON_I) {
+            OUTPUT_I(msq, result_i.v[axis]);
+            LOG("\n");
+            break;
+        }
+    }
+}
+
+// the bin of it, or zero
+static void check_spectral_maximum_bin_loop(float re[], float im[], int axis)
+{
+    int j;
+    for (j = FREQUENCY_WINDOW_SIZE / 2; j > 0; --j) {
+        if (re[j] * re[j] + im[j] * im[j] > SPECTRAL_MAXIMUM_EPSILON) {
+            break;
+        }
+    }
+    OUTPUT_I(j, result_i.v[axis]);
+    LOG("\n");
+}
+
+// the highest peaks of the power spectrum, by finding the highest remaining one each time
+static void check_spectral_top_peaks_power(const float power[], int axis)
+{
+    int i, j;
+    bool taken[FREQUENCY_WINDOW_SIZE / 2 + 1] = { false };
+
+    for (i = 0; i < SPECTRAL_TOP_PEAKS; ++i) {
+        int best = 0;
+        for (j = 1; j <= FREQUENCY_WINDOW_SIZE / 2; ++j) {
+            // the peak is at the start of a plateau, which must end with a fall;
+            // the DC is not a frequency, so the bin 1 is not compared with it
+            int end = j;
+            bool is_peak;
+            while (end < FREQUENCY_WINDOW_SIZE / 2 && power[end + 1] == power[j]) {
+                end++;
+            }
+            is_peak = (j == 1 || power[j] > power[j - 1])
+                && (end == FREQUENCY_WINDOW_SIZE / 2 || power[j] > power[end + 1])
+                && power[j] > SPECTRAL_MAXIMUM_EPSILON;
+            if (is_peak && !taken[j] && (best == 0 || power[j] > power[best])) {
+                best = j;
+            }
+        }
+        taken[best] = true;
+        OUTPUT_I(best, result_i.v[axis]);
+        OUTPUT_F(best ? power[best] : 0, result_f.v[axis]);
+    }
+    LOG("\n");
+}
+
+static void check_spectral_top_peaks_select(float re[], float im[], int axis)
+{
+    int j;
+    float power[FREQUENCY_WINDOW_SIZE / 2 + 1];
+
+    for (j = 0; j <= FREQUENCY_WINDOW_SIZE / 2; ++j) {
+        power[j] = re[j] * re[j] + im[j] * im[j];
+    }
+    check_spectral_top_peaks_power(power, axis);
+}
+
+// the power spectrum in coarse steps, so it has many plateaus and staircases (e.g. 1, 2, 2, 3)
+static void check_spectral_staircase_power(const float re[], const float im[], float power[])
+{
+    int j;
+    for (j = 0; j < SPECTRAL_NUM_BINS; ++j) {
+        power[j] = floorf(log2f(1.0f + re[j] * re[j] + im[j] * im[j]));
+    }
+}
+
+static void check_spectral_staircase_select(float re[], float im[], int axis)
+{
+    float power[SPECTRAL_NUM_BINS];
+
+    check_spectral_staircase_power(re, im, power);
+    check_spectral_top_peaks_power(power, axis);
+}
+
+static void check_spectral_staircase_loop(float re[], float im[], int axis)
+{
+    float power[SPECTRAL_NUM_BINS];
+    int bins[SPECTRAL_TOP_PEAKS];
+    float powers[SPECTRAL_TOP_PEAKS];
+    int i;
+
+    check_spectral_staircase_power(re, im, power);
+    spectral_top_peaks_f(power, bins, powers);
+    for (i = 0; i < SPECTRAL_TOP_PEAKS; ++i) {
+        OUTPUT_I(bins[i], result_i.v[axis]);
+        OUTPUT_F(powers[i], result_f.v[axis]);
+    }
+    LOG("\n");
+}
+
+// the bin with the highest power other than the DC, or zero
+static void check_spectral_argmax_loop(float re[], float im[], int axis)
+{
+    int j, best = 0;
+    float highest = SPECTRAL_MAXIMUM_EPSILON;
+    for (j = 1; j <= FREQUENCY_WINDOW_SIZE / 2; ++j) {
+        float power = re[j] * re[j] + im[j] * im[j];
+        if (power > highest) {
+            highest = power;
+            best = j;
+        }
+    }
+    OUTPUT_I(best, result_i.v[axis]);
+    LOG("\n");
+}
+
+// the bin of the highest one of the top peaks
+static void check_spectral_top_peak_loop(float re[], float im[], int axis)
+{
+    float power[SPECTRAL_NUM_BINS];
+    int bins[SPECTRAL_TOP_PEAKS];
+    float powers[SPECTRAL_TOP_PEAKS];
+
+    spectral_power_f(re, im, power);
+    spectral_top_peaks_f(power, bins, powers);
+    OUTPUT_I(bins[0], result_i.v[axis]);
+    LOG("\n");
+}
+
+static void check_spectral_maxima_f(int axis)
+{
+    feature_spectral_f(check_spectral_maxima_loop_f, axis);
+}
+
+static void check_spectral_maxima_i(int axis)
+{
+    feature_spectral_i(check_spectral_maxima_loop_i, axis);
+}
+
+static void check_spectral_maximum_bin(int axis)
+{
+    feature_spectral_f(check_spectral_maximum_bin_loop, axis);
+}
+
+static void check_spectral_top_peaks(int axis)
+{
+    feature_spectral_f(check_spectral_top_peaks_select, axis);
+}
+
+static void check_spectral_staircase_peaks_select(int axis)
+{
+    feature_spectral_f(check_spectral_staircase_select, axis);
+}
+
+static void check_spectral_staircase_peaks(int axis)
+{
+    feature_spectral_f(check_spectral_staircase_loop, axis);
+}
+
+static void check_spectral_argmax(int axis)
+{
+    feature_spectral_f(check_spectral_argmax_loop, axis);
+}
+
+static void check_spectral_top_peak(int axis)
+{
+    feature_spectral_f(check_spectral_top_peak_loop, axis);
+}
+
+// the dominant period with the autocorrelation computed directly in double precision
+static void check_spectral_autocorrelation_direct(int axis)
+{
+    int i, j, k;
+    double x[FREQUENCY_WINDOW_SIZE];
+    float r[FREQUENCY_WINDOW_SIZE];
+
+    LOG("axis=%d\n", axis);
+    for (i = 0; i <= NSAMPLES - FREQUENCY_WINDOW_SIZE;
+         i += PERIODIC_COMPUTATION_WINDOW_SIZE) {
+        double mean = 0, windowed_mean = 0;
+        int lag = 0;
+        float strength = 0;
+
+        for (j = 0; j < FREQUENCY_WINDOW_SIZE; ++j) {
+            mean += data[i + j].v[axis];
+        }
+        mean = SPECTRAL_DETREND ? mean / FREQUENCY_WINDOW_SIZE : 0;
+        for (j = 0; j < FREQUENCY_WINDOW_SIZE; ++j) {
+            double phase = 2 * M_PI * j / FREQUENCY_WINDOW_SIZE;
+            double w = SPECTRAL_WINDOW_A0 - SPECTRAL_WINDOW_A1 * cos(phase)
+                + SPECTRAL_WINDOW_A2 * cos(2 * phase);
+            x[j] = (data[i + j].v[axis] - mean) * w;
+            windowed_mean += x[j];
+        }
+        // without the DC bin
+        windowed_mean /= FREQUENCY_WINDOW_SIZE;
+        for (j = 0; j < FREQUENCY_WINDOW_SIZE; ++j) {
+            x[j] -= windowed_mean;
+        }
+        for (k = 0; k < FREQUENCY_WINDOW_SIZE; ++k) {
+            double sum = 0;
+            for (j = 0; j < FREQUENCY_WINDOW_SIZE - k; ++j) {
+                sum += x[j] * x[j + k];
+            }
+            r[k] = sum;
+        }
+        spectral_period_f(r, &lag, &strength);
+        OUTPUT_I(lag, result_i.v[axis]);
+        OUTPUT_F(strength, result_f.v[axis]);
+        LOG("\n");
+    }
+}
+
+// the shape of the power spectrum in double precision, with the zero powers taken as
+// `zero_power`; the flatness as -log2 if `log_flatness`
+static void check_spectral_shape_double(const double power[], double zero_power,
+                                        bool log_flatness, int axis)
+{
+    int j;
+    double total = 0, weighted = 0, weighted_sq = 0, low = 0, log_sum = 0, flat_total = 0;
+    double centroid = 0, spread = 0, flatness = 0, highest = 0, cumulative = 0;
+    int rolloff = 0, dominant = 0;
+
+    for (j = 1; j < SPECTRAL_NUM_BINS; ++j) {
+        total += power[j];
+        weighted += j * power[j];
+        if (j <= SPECTRAL_BAND_SPLIT) {
+            low += power[j];
+        }
+        highest = max(highest, power[j]);
+    }
+    if (total) {
+        dominant = 1;
+        while (power[dominant] < highest * (1 - SPECTRAL_DOMINANT_EPSILON)) {
+            ++dominant;
+        }
+        centroid = weighted / total;
+        for (j = 1; j < SPECTRAL_NUM_BINS; ++j) {
+            weighted_sq += (j - centroid) * (j - centroid) * power[j];
+        }
+        spread = sqrt(weighted_sq / total);
+        for (rolloff = 1; rolloff < SPECTRAL_NUM_BINS - 1; ++rolloff) {
+            cumulative += power[rolloff];
+            if (cumulative >= total * SPECTRAL_ROLLOFF_PERCENT / 100) {
+                break;
+            }
+        }
+    }
+    for (j = 1; j < SPECTRAL_NUM_BINS; ++j) {
+        double p = power[j] ? power[j] : zero_power;
+        flat_total += p;
+        log_sum += p ? log2(p) : -INFINITY;
+    }
+    if (flat_total) {
+        double log_flat = log_sum / (SPECTRAL_NUM_BINS - 1) - log2(flat_total / (SPECTRAL_NUM_BINS - 1));
+        flatness = log_flatness ? -log_flat : exp2(log_flat);
+    }
+
+    OUTPUT_F(centroid, result_f.v[axis]);
+    OUTPUT_F(spread, result_f.v[axis]);
+    OUTPUT_F(rolloff, result_f.v[axis]);
+    OUTPUT_F(flatness, result_f.v[axis]);
+    OUTPUT_F(dominant, result_f.v[axis]);
+    OUTPUT_F(total ? low / total : 0, result_f.v[axis]);
+    LOG("\n");
+}
+
+static void check_spectral_shape_f_double(float re[], float im[], int axis)
+{
+    int j;
+    double power[SPECTRAL_NUM_BINS];
+    for (j = 0; j < SPECTRAL_NUM_BINS; ++j) {
+        power[j] = (double)re[j] * re[j] + (double)im[j] * im[j];
+    }
+    check_spectral_shape_double(power, 0, false, axis);
+}
+
+static void check_spectral_shape_i_double(int16_t re[], int16_t im[], int axis)
+{
+    int j;
+    double power[SPECTRAL_NUM_BINS];
+    for (j = 0; j < SPECTRAL_NUM_BINS; ++j) {
+        power[j] = (double)re[j] * re[j] + (double)im[j] * im[j];
+    }
+    check_spectral_shape_double(power, 1, true, axis);
+}
+
+static void check_spectral_shape_f_reference(int axis)
+{
+    feature_spectral_f(check_spectral_shape_f_double, axis);
+}
+
+static void check_spectral_shape_i_reference(int axis)
+{
+    feature_spectral_i(check_spectral_shape_i_double, axis);
+}
+
+// the fixed point shape of the power spectrum, in bins and fractions
+static void check_spectral_shape_fixed(int16_t re[], int16_t im[], int axis)
+{
+    uint32_t power[SPECTRAL_NUM_BINS];
+
+    spectral_power_i(re, im, power);
+    OUTPUT_F(spectral_centroid_q8(power) / 256.0, result_f.v[axis]);
+    OUTPUT_F(spectral_spread_q8(power) / 256.0, result_f.v[axis]);
+    OUTPUT_F(spectral_rolloff_i(power), result_f.v[axis]);
+    OUTPUT_F(spectral_flatness_log2_q16(power) / 65536.0, result_f.v[axis]);
+    OUTPUT_F(spectral_dominant_i(power), result_f.v[axis]);
+    OUTPUT_F(spectral_band_ratio_q15(power) / 32768.0, result_f.v[axis]);
+    LOG("\n");
+}
+
+static void check_spectral_shape_i(int axis)
+{
+    feature_spectral_i(check_spectral_shape_fixed, axis);
+}
+
+// the spectral entropy of the output of the integer FFT, in double precision;
+// zero if all of it is zero
+static void check_spectral_entropy_intfft_log2(int16_t re[], int16_t im[], int axis)
+{
+    int j;
+    double squared_sum = 0, entropy = 0;
+    for (j = 0; j < FREQUENCY_WINDOW_SIZE; ++j) {
+        squared_sum += (double)re[j] * re[j] + (double)im[j] * im[j];
+    }
+    for (j = 0; j < FREQUENCY_WINDOW_SIZE; ++j) {
+        double q = ((double)re[j] * re[j] + (double)im[j] * im[j]) / squared_sum;
+        if (q > 0) {
+            entropy -= q * log2(q);
+        }
+    }
+    OUTPUT_F(entropy, result_f.v[axis]);
+    LOG("\n");
+}
+
+static void check_spectral_entropy_intfft(int axis)
+{
+    feature_spectral_i(check_spectral_entropy_intfft_log2, axis);
+}
+
+// the fixed point spectral entropy, in bits
+static void check_spectral_entropy_q16(int16_t re[], int16_t im[], int axis)
+{
+    OUTPUT_F(spectral_entropy_q16(re, im) / 65536.0, result_f.v[axis]);
+    LOG("\n");
+}
+
+static void check_spectral_entropy_i(int axis)
+{
+    feature_spectral_i(check_spectral_entropy_q16, axis);
+}
+
+// The integer spectral features against the float ones. The integer FFT truncates at each
+// stage and has 7-bit twiddle factors; the errors add up to a few units in each bin, which is
+// all there is in the windows of a device at rest. So only the windows with a std of at least
+// CHECK_SPECTRAL_MIN_STD are compared. The scales of the two FFTs differ, so the powers are
+// compared as fractions of the power of the nonzero frequencies: the DC bin mostly holds gravity,
+// and with SPECTRAL_DETREND the remainder of the integer mean. The entropy does not depend
+// on the scale. The maxima are not compared: they are the last bins above thresholds of
+// different scales, which are different bins when those powers are as small as the errors.
+// With the other analysis windows, the integer samples are truncated to 8 bits after the
+// window function, which leaves too little of the signal to compare. The truncation error
+// grows with the number of stages of the FFT as well, so the comparison is limited to the
+// windows of up to 128 samples (7 stages); at 1024 the truncation hides e.g. the square wave.
+
+#define CHECK_SPECTRAL_MIN_STD 8
+
+enum {
+    CHECK_SPECTRAL_DENSITY,
+    CHECK_SPECTRAL_HISTOGRAM,
+    CHECK_SPECTRAL_ENTROPY,
+};
+
+static bool check_spectral_has_signal(const accel_t *w, int axis)
+{
+    int j;
+    int64_t sum = 0, sqsum = 0;
+    for (j = 0; j < FREQUENCY_WINDOW_SIZE; ++j) {
+        sum += w[j].v[axis];
+        sqsum += w[j].v[axis] * w[j].v[axis];
+    }
+    // the variance times N^2
+    return sqsum * FREQUENCY_WINDOW_SIZE - sum * sum
+        >= (int64_t)CHECK_SPECTRAL_MIN_STD * CHECK_SPECTRAL_MIN_STD
+           * FREQUENCY_WINDOW_SIZE * FREQUENCY_WINDOW_SIZE;
+}
+
+// the bins as in `spectral_feature_density_*()` or `spectral_feature_histogram_*()`,
+// without the DC bin, as fractions of their sum
+static void check_spectral_output_fractions(const double power[SPECTRAL_NUM_BINS], int kind, int axis)
+{
+    double bins[SPECTRAL_NUM_BINS] = {0};
+    double total = 0;
+    int j, n;
+
+    if (kind == CHECK_SPECTRAL_DENSITY) {
+        n = SPECTRAL_NUM_BINS - 1;
+        for (j = 1; j < SPECTRAL_NUM_BINS; ++j) {
+            bins[j - 1] = power[j];
+        }
+    } else {
+        n = NUM_FREQUENCY_HISTOGRAM_BINS - 1;
+        for (j = 1; j < SPECTRAL_NUM_BINS; ++j) {
+            bins[(j - 1) / FREQUENCY_HISTOGRAM_DIVIDER] += power[j];
+        }
+    }
+    for (j = 0; j < n; ++j) {
+        total += bins[j];
+    }
+    for (j = 0; j < n; ++j) {
+        OUTPUT_F(bins[j] / total, result_f.v[axis]);
+    }
+    LOG("\n");
+}
+
+static void check_spectral_signal(int kind, bool fixed, int axis)
+{
+    int i, j;
+    LOG("axis=%d\n", axis);
+
+    spectral_window_init();
+
+    for (i = 0; i <= NSAMPLES - FREQUENCY_WINDOW_SIZE; i += PERIODIC_COMPUTATION_WINDOW_SIZE) {
+        double power[SPECTRAL_NUM_BINS];
+        double entropy;
+
+        if (!check_spectral_has_signal(&data[i], axis)) {
+            continue;
+        }
+        if (fixed) {
+            int16_t re[FREQUENCY_WINDOW_SIZE];
+            int16_t im[FREQUENCY_WINDOW_SIZE];
+            uint32_t power_i[SPECTRAL_NUM_BINS];
+            spectral_load_i(re, &data[i], axis);
+            memset(im, 0, sizeof(im));
+            intfft(re, im, FREQUENCY_WINDOW_SIZE);
+            spectral_power_i(re, im, power_i);
+            for (j = 0; j < SPECTRAL_NUM_BINS; ++j) {
+                power[j] = power_i[j];
+            }
+            entropy = spectral_entropy_q16(re, im) / 65536.0;
+        } else {
+            float re[FREQUENCY_WINDOW_SIZE];
+            float im[FREQUENCY_WINDOW_SIZE];
+            float power_f[SPECTRAL_NUM_BINS];
+            int32_t sum = spectral_load_f(re, &data[i], axis);
+            memset(im, 0, sizeof(im));
+            fft(re, im, FREQUENCY_WINDOW_SIZE);
+            spectral_detrend_f(re, sum);
+            spectral_power_f(re, im, power_f);
+            for (j = 0; j < SPECTRAL_NUM_BINS; ++j) {
+                power[j] = power_f[j];
+            }
+            entropy = spectral_entropy_f(re, im);
+        }
+
+        if (kind == CHECK_SPECTRAL_ENTROPY) {
+            OUTPUT_F(entropy, result_f.v[axis]);
+            LOG("\n");
+        } else {
+            check_spectral_output_fractions(power, kind, axis);
+        }
+    }
+}
+
+static void check_spectral_density_signal_f(int axis)
+{
+    check_spectral_signal(CHECK_SPECTRAL_DENSITY, false, axis);
+}
+
+static void check_spectral_density_signal_i(int axis)
+{
+    check_spectral_signal(CHECK_SPECTRAL_DENSITY, true, axis);
+}
+
+static void check_spectral_histogram_signal_f(int axis)
+{
+    check_spectral_signal(CHECK_SPECTRAL_HISTOGRAM, false, axis);
+}
+
+static void check_spectral_histogram_signal_i(int axis)
+{
+    check_spectral_signal(CHECK_SPECTRAL_HISTOGRAM, true, axis);
+}
+
+static void check_spectral_entropy_signal_f(int axis)
+{
+    check_spectral_signal(CHECK_SPECTRAL_ENTROPY, false, axis);
+}
+
+static void check_spectral_entropy_signal_i(int axis)
+{
+    check_spectral_signal(CHECK_SPECTRAL_ENTROPY, true, axis);
+}
+
+// the entropy with the logarithms computed in double precision
+static void check_entropy_log2(int axis)
+{
+    int i, j;
+    LOG("axis=%d\n", axis);
+    for (i = 0; i <= NSAMPLES - TIME_WINDOW_SIZE; i += PERIODIC_COMPUTATION_WINDOW_SIZE) {
+        int stats[256] = {0};
+        double entropy = 0;
+        for (j = 0; j < TIME_WINDOW_SIZE; ++j) {
+            stats[data[i + j].v[axis] + 128]++;
+        }
+        for (j = 0; j < 256; ++j) {
+            if (stats[j]) {
+                double p = (double)stats[j] / TIME_WINDOW_SIZE;
+                entropy -= p * log2(p);
+            }
+        }
+        OUTPUT_F(entropy, result_f.v[axis]);
+        LOG("\n");
+    }
+}
+
+// the higher moments with two passes over the window, in double precision
+static void check_moments_two_pass(int axis, bool kurtosis)
+{
+    int i, j;
+    LOG("axis=%d\n", axis);
+    for (i = 0; i <= NSAMPLES - TIME_WINDOW_SIZE; i += PERIODIC_COMPUTATION_WINDOW_SIZE) {
+        double mean = 0, m2 = 0, m3 = 0, m4 = 0;
+        double result = 0;
+        for (j = 0; j < TIME_WINDOW_SIZE; ++j) {
+            mean += data[i + j].v[axis];
+        }
+        mean /= TIME_WINDOW_SIZE;
+        for (j = 0; j < TIME_WINDOW_SIZE; ++j) {
+            double d = data[i + j].v[axis] - mean;
+            m2 += d * d;
+            m3 += d * d * d;
+            m4 += d * d * d * d;
+        }
+        m2 /= TIME_WINDOW_SIZE;
+        m3 /= TIME_WINDOW_SIZE;
+        m4 /= TIME_WINDOW_SIZE;
+        if (m2 > 0) {
+            result = kurtosis ? m4 / (m2 * m2) - 3 : m3 / pow(m2, 1.5);
+        }
+        OUTPUT_F(result, result_f.v[axis]);
+        LOG("\n");
+    }
+}
+
+// the correlation with the means subtracted first, in double precision
+static void check_correlation_two_pass(int axis)
+{
+    int i, j;
+    int next = (axis + 1) % NUM_AXIS;
+    LOG("axis=%d\n", axis);
+    for (i = 0; i <= NSAMPLES - TIME_WINDOW_SIZE; i += PERIODIC_COMPUTATION_WINDOW_SIZE) {
+        double mean1 = 0, mean2 = 0, var1 = 0, var2 = 0, cov = 0;
+        for (j = 0; j < TIME_WINDOW_SIZE; ++j) {
+            mean1 += data[i + j].v[axis];
+            mean2 += data[i + j].v[next];
+        }
+        mean1 /= TIME_WINDOW_SIZE;
+        mean2 /= TIME_WINDOW_SIZE;
+        for (j = 0; j < TIME_WINDOW_SIZE; ++j) {
+            double d1 = data[i + j].v[axis] - mean1;
+            double d2 = data[i + j].v[next] - mean2;
+            var1 += d1 * d1;
+            var2 += d2 * d2;
+            cov += d1 * d2;
+        }
+        OUTPUT_F(var1 > 0 && var2 > 0 ? cov / sqrt(var1 * var2) : 0.0, result_f.v[axis]);
+        LOG("\n");
+    }
+}
+
+static void check_skewness_two_pass(int axis)
+{
+    check_moments_two_pass(axis, false);
+}
+
+static void check_kurtosis_two_pass(int axis)
+{
+    check_moments_two_pass(axis, true);
+}
+
+// the crossings and peaks with plain loops; `level_mean` selects the mean instead of zero
+static void check_crossings_peaks_loops(int axis, bool level_mean, bool peaks)
+{
+    int i, j;
+    LOG("axis=%d\n", axis);
+    for (i = 0; i <= NSAMPLES - TIME_WINDOW_SIZE; i += PERIODIC_COMPUTATION_WINDOW_SIZE) {
+        const accel_t *w = &data[i];
+        int sum = 0, level = 0, count = 0, first = -1, last = -1;
+        for (j = 0; j < TIME_WINDOW_SIZE; ++j) {
+            sum += w[j].v[axis];
+        }
+        if (level_mean) {
+            level = sum / TIME_WINDOW_SIZE;
+        }
+        if (!peaks) {
+            for (j = 1; j < TIME_WINDOW_SIZE; ++j) {
+                bool above = w[j].v[axis] >= level;
+                bool previous_above = w[j - 1].v[axis] >= level;
+                if (above != previous_above) {
+                    count++;
+                }
+            }
+            OUTPUT_I(count, result_i.v[axis]);
+        } else {
+            for (j = 1; j < TIME_WINDOW_SIZE - 1; ++j) {
+                int v = w[j].v[axis];
+                int start = j;
+                // the peak is at the end of a plateau, which must start with a rise
+                while (start > 0 && w[start - 1].v[axis] == v) {
+                    start--;
+                }
+                if (v > level && start > 0 && v > w[start - 1].v[axis] && v > w[j + 1].v[axis]) {
+                    if (first < 0) {
+                        first = j;
+                    }
+                    last = j;
+                    count++;
+                }
+            }
+            OUTPUT_I(count, result_i.v[axis]);
+            OUTPUT_F(count > 1 ? (double)(last - first) / (count - 1) : 0.0, result_f.v[axis]);
+        }
+        LOG("\n");
+    }
+}
+
+static void check_zero_crossings_loops(int axis)
+{
+    check_crossings_peaks_loops(axis, false, false);
+}
+
+static void check_mean_crossings_loops(int axis)
+{
+    check_crossings_peaks_loops(axis, true, false);
+}
+
+static void check_peaks_loops(int axis)
+{
+    check_crossings_peaks_loops(axis, true, true);
+}
+
+// the integer roots, converted back from fixed point
+static void check_energy_q8(int axis)
+{
+    int i;
+    LOG("axis=%d\n", axis);
+    for (i = 0; i <= NSAMPLES - TIME_WINDOW_SIZE; i += PERIODIC_COMPUTATION_WINDOW_SIZE) {
+        window_moments_t m;
+        window_moments(&data[i], axis, &m);
+        OUTPUT_F(window_energy_q8(&m) / 256.0, result_f.v[axis]);
+        LOG("\n");
+    }
+}
+
+static void check_std_q8(int axis)
+{
+    int i;
+    LOG("axis=%d\n", axis);
+    for (i = 0; i <= NSAMPLES - TIME_WINDOW_SIZE; i += PERIODIC_COMPUTATION_WINDOW_SIZE) {
+        window_moments_t m;
+        window_moments(&data[i], axis, &m);
+        OUTPUT_F(window_std_q8(&m) / 256.0, result_f.v[axis]);
+        LOG("\n");
+    }
+}
+
+// the correlation matrix, from the moments of each axis and the correlations of each pair
+static void check_correlation_matrix_pairs(int axis)
+{
+    int i, j, a;
+    LOG("axis=%d\n", axis);
+    for (i = 0; i <= NSAMPLES - TIME_WINDOW_SIZE; i += PERIODIC_COMPUTATION_WINDOW_SIZE) {
+        window_moments_t m[NUM_AXIS];
+        for (a = 0; a < NUM_AXIS; ++a) {
+            float std;
+            window_moments(&data[i], a, &m[a]);
+            window_correlation(&data[i], a, (a + 1) % NUM_AXIS, &std, NULL);
+            OUTPUT_I(m[a].avg, result_i.v[a]);
+            OUTPUT_F(std, result_f.v[a]);
+        }
+        for (a = 0; a < NUM_AXIS; ++a) {
+            int next = (a + 1) % NUM_AXIS;
+            int64_t sum1 = 0, sum2 = 0, msum = 0;
+            for (j = 0; j < TIME_WINDOW_SIZE; ++j) {
+                sum1 += data[i + j].v[a];
+                sum2 += data[i + j].v[next];
+                msum += data[i + j].v[a] * data[i + j].v[next];
+            }
+            OUTPUT_F((TIME_WINDOW_SIZE * msum - sum1 * sum2) / ((float)TIME_WINDOW_SIZE * TIME_WINDOW_SIZE),
+                     result_f.v[a]);
+            OUTPUT_F(window_correlation(&data[i], a, next, NULL, NULL), result_f.v[a]);
+        }
+        LOG("\n");
+    }
+}
+
+static void check_correlation_q15(int axis)
+{
+    int i;
+    LOG("axis=%d\n", axis);
+    for (i = 0; i <= NSAMPLES - TIME_WINDOW_SIZE; i += PERIODIC_COMPUTATION_WINDOW_SIZE) {
+        int32_t corr = window_correlation_q15(&data[i], axis, (axis + 1) % NUM_AXIS);
+        OUTPUT_F(corr / 32768.0, result_f.v[axis]);
+        LOG("\n");
+    }
+}
+
+static void check_magnitude_q8(int axis)
+{
+    int i;
+    LOG("axis=%d\n", axis);
+    for (i = 0; i < NSAMPLES; i++) {
+        int x = data[i].v[0];
+        int y = data[i].v[1];
+        int z = data[i].v[2];
+        OUTPUT_F(isqrt_q8(x * x + y * y + z * z) / 256.0, result_f.v[axis]);
+        LOG("\n");
+    }
+    OUTPUT_F(0.0, result_f.v[axis]);
+    LOG("\n");
+}
+
+// the orientation angles with the arc tangent of the C library, in double precision
+static double check_orientation_angle(int x, int y, int z, int angle)
+{
+    switch (angle) {
+    case ORIENTATION_PITCH:
+        return atan2(-x, sqrt(y * y + z * z));
+    case ORIENTATION_ROLL:
+        return atan2(y, z);
+    default:
+        return atan2(sqrt(x * x + y * y), z);
+    }
+}
+
+static void check_orientation_atan2(int axis)
+{
+    int i;
+    LOG("axis=%d\n", axis);
+    for (i = 0; i < NSAMPLES; i++) {
+        OUTPUT_F(check_orientation_angle(data[i].v[0], data[i].v[1], data[i].v[2], axis),
+                 result_f.v[axis]);
+        LOG("\n");
+    }
+    OUTPUT_F(0.0, result_f.v[axis]);
+    LOG("\n");
+}
+
+static void check_orientation_q13(int axis)
+{
+    int i;
+    LOG("axis=%d\n", axis);
+    for (i = 0; i < NSAMPLES; i++) {
+        int32_t angle = orientation_angle_q13(data[i].v[0], data[i].v[1], data[i].v[2], axis);
+        OUTPUT_F(angle / 8192.0, result_f.v[axis]);
+        LOG("\n");
+    }
+    OUTPUT_F(0.0, result_f.v[axis]);
+    LOG("\n");
+}
+
+// the means of the angles of the samples, and the roll from the sums of its sine and cosine
+static void check_orientation_window_atan2(int axis)
+{
+    int i, j;
+    LOG("axis=%d\n", axis);
+    for (i = 0; i <= NSAMPLES - TIME_WINDOW_SIZE; i += PERIODIC_COMPUTATION_WINDOW_SIZE) {
+        double pitch = 0, tilt = 0, cos_roll = 0, sin_roll = 0;
+        for (j = 0; j < TIME_WINDOW_SIZE; ++j) {
+            int x = data[i + j].v[0];
+            int y = data[i + j].v[1];
+            int z = data[i + j].v[2];
+            double roll = check_orientation_angle(x, y, z, ORIENTATION_ROLL);
+            pitch += check_orientation_angle(x, y, z, ORIENTATION_PITCH);
+            tilt += check_orientation_angle(x, y, z, ORIENTATION_TILT);
+            if (y != 0 || z != 0) {
+                cos_roll += cos(roll);
+                sin_roll += sin(roll);
+            }
+        }
+        OUTPUT_F(pitch / TIME_WINDOW_SIZE, result_f.v[axis]);
+        OUTPUT_F(hypot(sin_roll, cos_roll) < WINDOW_ORIENTATION_MIN_RESULTANT * TIME_WINDOW_SIZE
+                 ? 0.0 : atan2(sin_roll, cos_roll), result_f.v[axis]);
+        OUTPUT_F(tilt / TIME_WINDOW_SIZE, result_f.v[axis]);
+        LOG("\n");
+    }
+}
+
+// the median filter with sorting of each window
+static void check_median_filter_sort(int axis, int width)
+{
+    int i, j;
+    int8_t buffer[MEDIAN_FILTER_MAX_WIDTH];
+    LOG("axis=%d\n", axis);
+    for (i = 0; i < width / 2; ++i) {
+        OUTPUT_I(0, result_i.v[axis]);
+        LOG("\n");
+    }
+    for (i = 0; i + width <= NSAMPLES; ++i) {
+        for (j = 0; j < width; ++j) {
+            buffer[j] = data[i + j].v[axis];
+        }
+        qsort(buffer, width, 1, cmp);
+        OUTPUT_I(buffer[width / 2], result_i.v[axis]);
+        LOG("\n");
+    }
+    for (i = 0; i < width / 2; ++i) {
+        OUTPUT_I(0, result_i.v[axis]);
+        LOG("\n");
+    }
+}
+
+static void check_median_filter5_sort(int axis)
+{
+    check_median_filter_sort(axis, 5);
+}
+
+static void check_median_filter9_sort(int axis)
+{
+    check_median_filter_sort(axis, 9);
+}
+
+static void check_median_filter15_sort(int axis)
+{
+    check_median_filter_sort(axis, 15);
+}
+
+static void check_median_filter3_network(int axis)
+{
+    filter_median_network(axis, 3);
+}
+
+static void check_median_filter3_sort(int axis)
+{
+    check_median_filter_sort(axis, 3);
+}
+
+// -----------------------------------------------------------
+// The library, on the same data
+
+// Enough for the rows of the windows of `data`
+#define CHECK_LIBRARY_MAX_VALUES (CHECK_NSAMPLES / PERIODIC_COMPUTATION_WINDOW_SIZE * 16)
+
+// Run the features `kinds` of the axis through the library and output its rows.
+// The sorting based feature functions skip the last window, and they are
+// given one sample less. If `chunk` is nonzero, the samples are streamed in chunks of that size.
+// If `cache_size` is nonzero, the rows of the windows are cached.
+static void check_library(int axis, const features_kind_t kinds[], int num_kinds,
+                          unsigned n, int chunk, int cache_size)
+{
+    static float out[CHECK_LIBRARY_MAX_VALUES];
+    const features_sample_t *samples = (const features_sample_t *)data;
+    features_context_t *ctx = features_create();
+    int width, rows = 0;
+    int i, k;
+
+    for (k = 0; k < num_kinds; ++k) {
+        features_plan_add(ctx, kinds[k], axis);
+    }
+    features_set_cache_size(ctx, cache_size);
+    width = features_plan_width(ctx);
+
+    if (chunk) {
+        unsigned start;
+        for (start = 0; start < n; start += chunk) {
+            int count = min((unsigned)chunk, n - start);
+            int max_windows = (CHECK_LIBRARY_MAX_VALUES - rows * width) / width;
+            rows += features_process_stream(ctx, &samples[start], count,
+                                            &out[rows * width], max_windows);
+        }
+    } else {
+        rows = features_process_batch(ctx, samples, n, out, CHECK_LIBRARY_MAX_VALUES / width);
+    }
+
+    for (i = 0; i < rows; ++i) {
+        for (k = 0; k < width; ++k) {
+            OUTPUT_F(out[i * width + k], result_f.v[axis]);
+        }
+        LOG("\n");
+    }
+    features_destroy(ctx);
+}
+
+static void check_library_moments(int axis)
+{
+    static const features_kind_t kinds[] = { FEATURES_MEAN, FEATURES_ENERGY, FEATURES_STD };
+    check_library(axis, kinds, 3, NSAMPLES, 0, 0);
+}
+
+static void check_library_moments_stream(int axis)
+{
+    static const features_kind_t kinds[] = { FEATURES_MEAN, FEATURES_ENERGY, FEATURES_STD };
+    check_library(axis, kinds, 3, NSAMPLES, 37, 0);
+}
+
+static void check_library_higher_moments(int axis)
+{
+    static const features_kind_t kinds[] = {
+        FEATURES_MEAN, FEATURES_STD, FEATURES_SKEWNESS, FEATURES_KURTOSIS
+    };
+    check_library(axis, kinds, 4, NSAMPLES, 0, 0);
+}
+
+static void check_library_crossings_peaks(int axis)
+{
+    static const features_kind_t kinds[] = {
+        FEATURES_ZERO_CROSSINGS, FEATURES_MEAN_CROSSINGS, FEATURES_PEAKS, FEATURES_PEAK_INTERVAL
+    };
+    check_library(axis, kinds, 4, NSAMPLES, 0, 0);
+}
+
+static void check_library_orientation(int axis)
+{
+    static const features_kind_t kinds[] = { FEATURES_PITCH, FEATURES_ROLL, FEATURES_TILT };
+    check_library(axis, kinds, 3, NSAMPLES, 0, 0);
+}
+
+static void check_library_other(int axis)
+{
+    static const features_kind_t kinds[] = { FEATURES_SMA, FEATURES_ENTROPY, FEATURES_CORRELATION };
+    check_library(axis, kinds, 3, NSAMPLES, 0, 0);
+}
+
+static void check_library_quantiles(int axis)
+{
+    static const features_kind_t kinds[] = {
+        FEATURES_MEDIAN, FEATURES_Q25, FEATURES_Q75, FEATURES_MIN, FEATURES_MAX
+    };
+    check_library(axis, kinds, 5, NSAMPLES - 1, 0, 0);
+}
+
+static void check_library_iqr(int axis)
+{
+    static const features_kind_t kinds[] = { FEATURES_IQR };
+    check_library(axis, kinds, 1, NSAMPLES - 1, 0, 0);
+}
+
+static void check_library_spectral(int axis)
+{
+    static const features_kind_t kinds[] = { FEATURES_SPECTRAL_ENTROPY, FEATURES_SPECTRAL_HISTOGRAM };
+    check_library(axis, kinds, 2, NSAMPLES, 0, 0);
+}
+
+static void check_library_period(int axis)
+{
+    static const features_kind_t kinds[] = {
+        FEATURES_SPECTRAL_ENTROPY, FEATURES_PERIOD, FEATURES_PERIOD_STRENGTH
+    };
+    check_library(axis, kinds, 3, NSAMPLES, 0, 0);
+}
+
+static void check_library_spectral_shape(int axis)
+{
+    static const features_kind_t kinds[] = {
+        FEATURES_SPECTRAL_HISTOGRAM, FEATURES_SPECTRAL_CENTROID, FEATURES_SPECTRAL_SPREAD,
+        FEATURES_SPECTRAL_ROLLOFF, FEATURES_SPECTRAL_FLATNESS, FEATURES_DOMINANT_FREQUENCY,
+        FEATURES_SPECTRAL_BAND_RATIO
+    };
+    check_library(axis, kinds, 7, NSAMPLES, 0, 0);
+}
+
+static void check_library_spectral_peaks(int axis)
+{
+    static const features_kind_t kinds[] = { FEATURES_SPECTRAL_MAXIMUM_BIN, FEATURES_SPECTRAL_PEAKS };
+    check_library(axis, kinds, 2, NSAMPLES, 0, 0);
+}
+
+// The same with a small cache
+#define CHECK_CACHE_SIZE 8
+
+static void check_library_cached(int axis)
+{
+    static const features_kind_t kinds[] = {
+        FEATURES_MEAN, FEATURES_ENERGY, FEATURES_STD, FEATURES_SPECTRAL_ENTROPY, FEATURES_SPECTRAL_HISTOGRAM
+    };
+    check_library(axis, kinds, 5, NSAMPLES, 0, CHECK_CACHE_SIZE);
+}
+
+static void check_library_cached_stream(int axis)
+{
+    static const features_kind_t kinds[] = {
+        FEATURES_MEAN, FEATURES_ENERGY, FEATURES_STD, FEATURES_SPECTRAL_ENTROPY, FEATURES_SPECTRAL_HISTOGRAM
+    };
+    check_library(axis, kinds, 5, NSAMPLES, 37, CHECK_CACHE_SIZE);
+}
+
+static void check_library_cached_quantiles(int axis)
+{
+    static const features_kind_t kinds[] = {
+        FEATURES_MEDIAN, FEATURES_Q25, FEATURES_Q75, FEATURES_MIN, FEATURES_MAX
+    };
+    check_library(axis, kinds, 5, NSAMPLES - 1, 0, CHECK_CACHE_SIZE);
+}
+
+// The timestamps of `data` split it in three segments: a gap of lost samples,
+// and a restart of the device, after which the timestamps start from zero again.
+// Elsewhere they have some jitter, less than the largest allowed difference.
+#define CHECK_SAMPLE_PERIOD 10
+#define CHECK_GAP_START     (NSAMPLES / 3 + 5)
+#define CHECK_RESTART       (2 * NSAMPLES / 3 + 11)
+
+static const unsigned check_segments[] = { 0, CHECK_GAP_START, CHECK_RESTART, NSAMPLES };
+
+static uint64_t check_timestamp(unsigned i)
+{
+    if (i >= CHECK_RESTART) {
+        return (i - CHECK_RESTART) * CHECK_SAMPLE_PERIOD;
+    }
+    return i * CHECK_SAMPLE_PERIOD + i % 3 + (i >= CHECK_GAP_START ? 50 * CHECK_SAMPLE_PERIOD : 0);
+}
+
+static const uint64_t *check_timestamps(void)
+{
+    static uint64_t timestamps[CHECK_NSAMPLES];
+    unsigned i;
+    for (i = 0; i < NSAMPLES; ++i) {
+        timestamps[i] = check_timestamp(i);
+    }
+    return timestamps;
+}
+
+// Run the features through the library on each segment separately
+static void check_library_segments(int axis, const features_kind_t kinds[], int num_kinds)
+{
+    static float out[CHECK_LIBRARY_MAX_VALUES];
+    const features_sample_t *samples = (const features_sample_t *)data;
+    features_context_t *ctx = features_create();
+    int width;
+    int i, k, s;
+
+    for (k = 0; k < num_kinds; ++k) {
+        features_plan_add(ctx, kinds[k], axis);
+    }
+    width = features_plan_width(ctx);
+
+    for (s = 0; s < 3; ++s) {
+        int rows = features_process_batch(ctx, &samples[check_segments[s]],
+                                          check_segments[s + 1] - check_segments[s],
+                                          out, CHECK_LIBRARY_MAX_VALUES / width);
+        for (i = 0; i < rows; ++i) {
+            for (k = 0; k < width; ++k) {
+                OUTPUT_F(out[i * width + k], result_f.v[axis]);
+            }
+            LOG("\n");
+        }
+    }
+    features_destroy(ctx);
+}
+
+static const features_kind_t check_timed_kinds[] = {
+    FEATURES_MEAN, FEATURES_ENERGY, FEATURES_STD, FEATURES_SPECTRAL_ENTROPY,
+    FEATURES_SKEWNESS, FEATURES_KURTOSIS
+};
+
+#define CHECK_TIMED_KINDS (sizeof(check_timed_kinds) / sizeof(*check_timed_kinds))
+
+static void check_library_segments_reference(int axis)
+{
+    check_library_segments(axis, check_timed_kinds, CHECK_TIMED_KINDS);
+}
+
+// All of the samples, with their timestamps, streamed in chunks;
+// the rows with wrong timestamps are output as NaN
+static void check_library_timed(int axis)
+{
+    static float out[CHECK_LIBRARY_MAX_VALUES];
+    static uint64_t row_times[CHECK_LIBRARY_MAX_VALUES];
+    const features_sample_t *samples = (const features_sample_t *)data;
+    const uint64_t *timestamps = check_timestamps();
+    features_context_t *ctx = features_create();
+    int width, rows = 0, segment_row = 0;
+    unsigned start;
+    int i, k, s = 0;
+
+    for (k = 0; k < (int)CHECK_TIMED_KINDS; ++k) {
+        features_plan_add(ctx, check_timed_kinds[k], axis);
+    }
+    features_set_max_gap(ctx, 2 * CHECK_SAMPLE_PERIOD);
+    width = features_plan_width(ctx);
+
+    for (start = 0; start < NSAMPLES; start += 37) {
+        int count = min(37u, NSAMPLES - start);
+        int max_windows = (CHECK_LIBRARY_MAX_VALUES - rows * width) / width;
+        rows += features_process_timed(ctx, &samples[start], &timestamps[start], count,
+                                       &out[rows * width], &row_times[rows], max_windows);
+    }
+
+    for (i = 0; i < rows; ++i) {
+        // the last sample of the window of the segment
+        unsigned last = check_segments[s] + segment_row * PERIODIC_COMPUTATION_WINDOW_SIZE
+            + features_window_size() - 1;
+        if (last >= check_segments[s + 1]) {
+            s++;
+            segment_row = 0;
+            last = check_segments[s] + features_window_size() - 1;
+        }
+        segment_row++;
+        for (k = 0; k < width; ++k) {
+            OUTPUT_F(row_times[i] == timestamps[last] ? out[i * width + k] : NAN, result_f.v[axis]);
+        }
+        LOG("\n");
+    }
+    features_destroy(ctx);
+}
+
+// Several streams with the same samples, pushed in chunks of different sizes
+#define CHECK_STREAMS 5
+
+static void check_library_streams_push(int axis, bool timed,
+                                       const features_kind_t kinds[], int num_kinds)
+{
+    static float rows[CHECK_STREAMS][CHECK_LIBRARY_MAX_VALUES];
+    static float out[CHECK_LIBRARY_MAX_VALUES];
+    static int ids[CHECK_LIBRARY_MAX_VALUES];
+    const features_sample_t *samples = (const features_sample_t *)data;
+    const uint64_t *timestamps = check_timestamps();
+    features_context_t *ctx = features_create();
+    features_streams_t *streams;
+    unsigned pushed[CHECK_STREAMS] = {0};
+    int num_rows[CHECK_STREAMS] = {0};
+    int width, done = 0;
+    int i, k, s;
+
+    for (k = 0; k < num_kinds; ++k) {
+        features_plan_add(ctx, kinds[k], axis);
+    }
+    features_set_max_gap(ctx, 2 * CHECK_SAMPLE_PERIOD);
+    // the streams without timestamps have a cache
+    features_set_cache_size(ctx, timed ? 0 : CHECK_CACHE_SIZE);
+    width = features_plan_width(ctx);
+    streams = features_streams_create(ctx, CHECK_STREAMS);
+
+    while (!done) {
+        done = 1;
+        for (s = 0; s < CHECK_STREAMS; ++s) {
+            int chunk = min(7 + 13 * s, (int)(NSAMPLES - pushed[s]));
+            if (chunk > 0) {
+                pushed[s] += timed
+                    ? features_streams_push_timed(streams, s, &samples[pushed[s]],
+                                                  &timestamps[pushed[s]], chunk)
+                    : features_streams_push(streams, s, &samples[pushed[s]], chunk);
+                done = 0;
+            }
+        }
+        // extract a few windows at a time
+        while (features_streams_num_ready(streams) > 0) {
+            int n = features_streams_extract(streams, out, ids, 3);
+            for (i = 0; i < n; ++i) {
+                s = ids[i];
+                memcpy(&rows[s][num_rows[s]++ * width], &out[i * width], width * sizeof(float));
+            }
+        }
+    }
+
+    for (i = 0; i < num_rows[0]; ++i) {
+        for (k = 0; k < width; ++k) {
+            float x = rows[0][i * width + k];
+            for (s = 1; s < CHECK_STREAMS; ++s) {
+                if (num_rows[s] != num_rows[0] || rows[s][i * width + k] != x) {
+                    x = NAN;
+                }
+            }
+            OUTPUT_F(x, result_f.v[axis]);
+        }
+        LOG("\n");
+    }
+    features_streams_destroy(streams);
+    features_destroy(ctx);
+}
+
+static void check_library_streams(int axis)
+{
+    check_library_streams_push(axis, false, check_timed_kinds, CHECK_TIMED_KINDS);
+}
+
+static void check_library_streams_timed(int axis)
+{
+    check_library_streams_push(axis, true, check_timed_kinds, CHECK_TIMED_KINDS);
+}
+
+static void check_library_streams_crossings_peaks(int axis)
+{
+    static const features_kind_t kinds[] = {
+        FEATURES_ZERO_CROSSINGS, FEATURES_MEAN_CROSSINGS, FEATURES_PEAKS, FEATURES_PEAK_INTERVAL
+    };
+    check_library_streams_push(axis, false, kinds, 4);
+}
+
+static void check_library_spectral_maximum(int axis)
+{
+    static float out[CHECK_LIBRARY_MAX_VALUES];
+    features_context_t *ctx = features_create();
+    int i, rows;
+
+    features_plan_add(ctx, FEATURES_SPECTRAL_MAXIMUM, axis);
+    rows = features_process_batch(ctx, (const features_sample_t *)data, NSAMPLES,
+                                  out, CHECK_LIBRARY_MAX_VALUES);
+    for (i = 0; i < rows; ++i) {
+        // the feature function outputs nothing if there is no maximum
+        if (out[i] != 0) {
+            OUTPUT_F(out[i], result_f.v[axis]);
+            LOG("\n");
+        }
+    }
+    features_destroy(ctx);
+}
+
+// -----------------------------------------------------------
+
+#define CHECK_MAX_REFERENCES 6
+
+typedef void (*check_function_t)(int axis);
+
+typedef struct {
+    const char *name;
+    // the outputs of these are concatenated for each window
+    check_function_t reference[CHECK_MAX_REFERENCES];
+    check_function_t candidate;
+    // relative to the largest absolute value of the reference output
+    double tolerance;
+} check_t;
+
+#define EXACT 0.0
+
+static const check_t checks[] = {
+    // time domain features and their combinations
+    { "mean+std", { feature_mean, feature_std }, feature_std_mean, EXACT },
+    { "mean+energy", { feature_mean, feature_energy }, feature_energy_mean, EXACT },
+    { "energy+std", { feature_energy, feature_std }, feature_std_energy, EXACT },
+    { "mean+energy+std", { feature_mean, feature_energy, feature_std }, feature_std_energy_mean, EXACT },
+    { "mean+energy+std lanes", { feature_std_energy_mean }, feature_std_energy_mean_lanes, EXACT },
+    { "correlation lanes", { feature_correlation }, feature_correlation_lanes, EXACT },
+    { "entropy", { check_entropy_log2 }, feature_entropy, 1e-5 },
+    { "zero_crossings", { check_zero_crossings_loops }, feature_zero_crossings, EXACT },
+    { "mean_crossings", { check_mean_crossings_loops }, feature_mean_crossings, EXACT },
+    { "peaks", { check_peaks_loops }, feature_peaks, 1e-6 },
+    { "crossings+peaks lanes", { feature_zero_crossings, feature_mean_crossings, feature_peaks },
+      feature_crossings_peaks_lanes, EXACT },
+    // the error of the fast arc tangent, and of the float sums
+    { "orientation", { check_orientation_window_atan2 }, feature_orientation, 1e-4 },
+    { "skewness", { check_skewness_two_pass }, feature_skewness, 1e-5 },
+    { "kurtosis", { check_kurtosis_two_pass }, feature_kurtosis, 1e-5 },
+    { "mean+std+skewness+kurtosis", { feature_mean, feature_std, feature_skewness, feature_kurtosis },
+      feature_std_skewness_kurtosis_mean, EXACT },
+    { "skewness+kurtosis sliding", { feature_std_skewness_kurtosis_mean },
+      feature_std_skewness_kurtosis_mean_sliding, EXACT },
+    { "energy isqrt", { feature_energy }, check_energy_q8, 1e-3 },
+    { "std isqrt", { feature_std }, check_std_q8, 1e-3 },
+    { "correlation irsqrt", { feature_correlation }, check_correlation_q15, 1e-4 },
+    // with INTEGER_SQRT, the error of the Q15 version
+    { "correlation two pass", { check_correlation_two_pass }, feature_correlation, 1e-4 },
+    { "correlation matrix", { check_correlation_matrix_pairs }, feature_correlation_matrix, EXACT },
+    { "correlation matrix lanes", { feature_correlation_matrix }, feature_correlation_matrix_lanes, EXACT },
+    { "correlation matrix sliding", { feature_correlation_matrix }, feature_correlation_matrix_sliding,
+      EXACT },
+
+    // sorting based features
+    { "min+max", { feature_min, feature_max }, feature_min_max, EXACT },
+    { "min+max lanes", { feature_min_max }, feature_min_max_lanes, EXACT },
+    { "median", { feature_sort_median }, feature_median, EXACT },
+    { "iqr", { feature_sort_iqr }, feature_iqr, EXACT },
+    { "median+iqr", { feature_sort_median, feature_sort_iqr }, feature_median_iqr, EXACT },
+    { "median+iqr+min+max", { feature_sort_median, feature_sort_iqr, feature_min, feature_max },
+      feature_median_iqr_min_max, EXACT },
+    { "quantiles", { feature_sort_median, feature_q25, feature_q75, feature_min, feature_max },
+      feature_quantiles, EXACT },
+    { "quantiles_rank", { feature_sort_median, feature_q25, feature_q75, feature_min, feature_max },
+      feature_quantiles_rank, EXACT },
+    { "quantiles_histogram", { feature_sort_median, feature_q25, feature_q75, feature_min, feature_max },
+      feature_quantiles_histogram, EXACT },
+
+    // frequency domain features
+    { "spectral_density fftr/fft", { check_spectral_density_fftr }, feature_spectral_density_f, 1e-5 },
+    // with detrending, the DC is removed after the FFT, so the error of the float sum remains
+    { "spectral_density dft/fft", { check_spectral_density_dft }, feature_spectral_density_f, 1e-4 },
+    { "spectral_density fft lanes", { feature_spectral_density_f }, feature_spectral_density_lanes_f, EXACT },
+    { "spectral_histogram fftr/fft", { check_spectral_histogram_fftr }, feature_spectral_histogram_f, 1e-5 },
+    // the error of the approximations of log2, relative to the largest entropy
+    { "spectral_entropy fast", { feature_spectral_entropy_f }, feature_spectral_entropy_fast_f, 1e-4 },
+    { "spectral_entropy fixed point", { check_spectral_entropy_intfft }, check_spectral_entropy_i, 1e-4 },
+#if SPECTRAL_WINDOW == SPECTRAL_WINDOW_RECTANGULAR && FREQUENCY_WINDOW_SIZE <= 128
+    // the integer versions against the float ones, on the windows with enough signal
+    { "spectral_density i/f", { check_spectral_density_signal_f }, check_spectral_density_signal_i, 0.15 },
+    { "spectral_histogram i/f", { check_spectral_histogram_signal_f }, check_spectral_histogram_signal_i,
+      0.1 },
+    { "spectral_entropy i/f", { check_spectral_entropy_signal_f }, check_spectral_entropy_signal_i, 0.15 },
+#endif
+    { "spectral_maxima", { check_spectral_maxima_f }, feature_spectral_maxima_f, EXACT },
+    { "spectral_maxima fixed point", { check_spectral_maxima_i }, feature_spectral_maxima_i, EXACT },
+    { "spectral_top_peaks", { check_spectral_top_peaks }, feature_spectral_top_peaks_f, EXACT },
+    { "spectral_top_peaks argmax", { check_spectral_argmax }, check_spectral_top_peak, EXACT },
+    { "spectral_top_peaks staircase", { check_spectral_staircase_peaks_select },
+      check_spectral_staircase_peaks, EXACT },
+    { "spectral_shape", { check_spectral_shape_f_reference }, feature_spectral_shape_f, 1e-4 },
+    { "spectral_shape fixed point", { check_spectral_shape_i_reference }, check_spectral_shape_i, 1e-3 },
+    { "spectral_autocorrelation", { check_spectral_autocorrelation_direct },
+      feature_spectral_autocorrelation_f, 1e-4 },
+
+    // filters
+    { "median_filter3", { check_median_filter3_sort }, check_median_filter3_network, EXACT },
+    { "median_filter5", { check_median_filter5_sort }, filter_median5, EXACT },
+    { "median_filter9", { check_median_filter9_sort }, filter_median9, EXACT },
+    { "median_filter9_histogram", { check_median_filter9_sort }, filter_median9_histogram, EXACT },
+    { "median_filter15", { check_median_filter15_sort }, filter_median15, EXACT },
+
+    // transforms
+    { "l1norm", { transform_l1norm }, transform_l1norm_v, EXACT },
+    { "magnitude_sq", { transform_magnitude_sq }, transform_magnitude_sq_v, EXACT },
+    { "magnitude", { transform_magnitude }, transform_magnitude_v, EXACT },
+    { "magnitude isqrt", { transform_magnitude }, check_magnitude_q8, 1e-4 },
+    { "jerk", { transform_jerk }, transform_jerk_v, EXACT },
+    { "jerk+l1norm", { transform_jerk_l1norm }, transform_jerk_l1norm_v, EXACT },
+    { "jerk+magnitude_sq", { transform_jerk_magnitude_sq }, transform_jerk_magnitude_sq_v, EXACT },
+    { "jerk+magnitude", { transform_jerk_magnitude }, transform_jerk_magnitude_v, EXACT },
+    { "orientation atan2", { check_orientation_atan2 }, transform_orientation, 2e-5 },
+    { "orientation block", { transform_orientation }, transform_orientation_v, EXACT },
+    { "orientation cordic", { check_orientation_atan2 }, check_orientation_q13, 1e-3 },
+    // the sums are in float and in a different order; the std of an almost constant
+    // magnitude loses the most precision
+    { "pipeline", { feature_pipeline_jerk_magnitude_passes }, feature_pipeline_jerk_magnitude, 1e-3 },
+
+#if TIME_WINDOW_SIZE == FREQUENCY_WINDOW_SIZE
+    // the library; its windows are as long as the longer of the two,
+    // so it only has the same windows as the feature functions if they are equal
+    { "lib mean+energy+std", { feature_mean, feature_energy, feature_std }, check_library_moments, EXACT },
+    { "lib mean+energy+std stream", { feature_mean, feature_energy, feature_std },
+      check_library_moments_stream, EXACT },
+    { "lib mean+std+skewness+kurtosis", { feature_mean, feature_std, feature_skewness, feature_kurtosis },
+      check_library_higher_moments, EXACT },
+    { "lib crossings+peaks", { feature_zero_crossings, feature_mean_crossings, feature_peaks },
+      check_library_crossings_peaks, EXACT },
+    { "lib orientation", { feature_orientation }, check_library_orientation, EXACT },
+    { "lib sma+entropy+correlation", { feature_sma, feature_entropy, feature_correlation },
+      check_library_other, EXACT },
+    { "lib quantiles", { feature_median, feature_q25, feature_q75, feature_min, feature_max },
+      check_library_quantiles, EXACT },
+    { "lib iqr", { feature_iqr }, check_library_iqr, EXACT },
+    { "lib spectral", { feature_spectral_entropy_f, feature_spectral_histogram_f },
+      check_library_spectral, EXACT },
+    { "lib period", { feature_spectral_entropy_f, feature_spectral_autocorrelation_f },
+      check_library_period, EXACT },
+    { "lib spectral shape", { feature_spectral_histogram_f, feature_spectral_shape_f },
+      check_library_spectral_shape, EXACT },
+    { "lib spectral peaks", { check_spectral_maximum_bin, feature_spectral_top_peaks_f },
+      check_library_spectral_peaks, EXACT },
+    { "lib spectral_maximum", { feature_spectral_maxima_f }, check_library_spectral_maximum, EXACT },
+    { "lib streams", { feature_mean, feature_energy, feature_std, feature_spectral_entropy_f,
+                       feature_skewness, feature_kurtosis },
+      check_library_streams, EXACT },
+    { "lib streams crossings+peaks", { feature_zero_crossings, feature_mean_crossings, feature_peaks },
+      check_library_streams_crossings_peaks, EXACT },
+    { "lib cached", { feature_mean, feature_energy, feature_std, feature_spectral_entropy_f,
+                      feature_spectral_histogram_f }, check_library_cached, EXACT },
+    { "lib cached stream", { feature_mean, feature_energy, feature_std, feature_spectral_entropy_f,
+                             feature_spectral_histogram_f }, check_library_cached_stream, EXACT },
+    { "lib cached quantiles", { feature_median, feature_q25, feature_q75, feature_min, feature_max },
+      check_library_cached_quantiles, EXACT },
+    // the windows do not cross the gaps in the timestamps
+    { "lib timed", { check_library_segments_reference }, check_library_timed, EXACT },
+    { "lib streams timed", { check_library_segments_reference }, check_library_streams_timed, EXACT },
+#endif
+};
+
+#define NUM_CHECKS (sizeof(checks) / sizeof(*checks))
+
+typedef struct {
+    double max_error;
+    unsigned long num_values;
+    unsigned num_failed_inputs;
+    const char *first_failed_input;
+    double reference_usec;
+    double candidate_usec;
+} check_result_t;
+
+static check_result_t check_results[NUM_CHECKS];
+
+// -----------------------------------------------------------
+
+static double check_time_usec(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+static double check_run(check_function_t f, const char *name, int axis)
+{
+    double start;
+    output_sink_begin(name, axis);
+    start = check_time_usec();
+    f(axis);
+    return check_time_usec() - start;
+}
+
+// Collect the outputs of `n` consecutive columns, with their rows interleaved
+static unsigned check_collect(int first, int n, double out[], unsigned max_values, bool *ok)
+{
+    const output_sink_column_t *c = &output_sink_columns[first];
+    unsigned count = 0;
+    unsigned row, k;
+    int i;
+
+    if (n == 1) {
+        // the rows can be of different length, e.g. the first one of `filter_median`
+        count = min(c->num_values, max_values);
+        memcpy(out, &output_sink_cells[c->offset], count * sizeof(double));
+        return count;
+    }
+
+    for (i = 1; i < n; ++i) {
+        if (c[i].num_rows != c[0].num_rows
+            || c[i].num_values != c[i].num_rows * c[i].values_per_row) {
+            *ok = false;
+            return 0;
+        }
+    }
+    for (row = 0; row < c[0].num_rows; ++row) {
+        for (i = 0; i < n; ++i) {
+            const double *values = &output_sink_cells[c[i].offset + row * c[i].values_per_row];
+            for (k = 0; k < c[i].values_per_row && count < max_values; ++k) {
+                out[count++] = values[k];
+            }
+        }
+    }
+    return count;
+}
+
+// Compare the outputs; returns the largest error relative to the largest reference value
+static double check_compare(const double expected[], const double actual[], unsigned n)
+{
+    double scale = 1.0;
+    double max_error = 0;
+    unsigned i;
+
+    for (i = 0; i < n; ++i) {
+        if (isfinite(expected[i])) {
+            scale = max(scale, fabs(expected[i]));
+        }
+    }
+    for (i = 0; i < n; ++i) {
+        double error;
+        if (isnan(expected[i]) || isnan(actual[i])) {
+            error = isnan(expected[i]) && isnan(actual[i]) ? 0 : INFINITY;
+        } else if (expected[i] == actual[i]) {
+            error = 0;
+        } else {
+            error = fabs(expected[i] - actual[i]) / scale;
+        }
+        max_error = max(max_error, error);
+    }
+    return max_error;
+}
+
+static void check_input(const char *input_name)
+{
+    static double expected[OUTPUT_SINK_MAX_CELLS / 2];
+    static double actual[OUTPUT_SINK_MAX_CELLS / 2];
+    int c, axis, r;
+
+    for (c = 0; c < NUM_CHECKS; ++c) {
+        const check_t *check = &checks[c];
+        check_result_t *result = &check_results[c];
+        bool ok = true;
+
+        for (axis = 0; axis < NUM_AXIS; ++axis) {
+            int num_references = 0;
+            unsigned num_expected, num_actual;
+            double error;
+
+            output_sink_reset();
+            for (r = 0; r < CHECK_MAX_REFERENCES && check->reference[r]; ++r) {
+                result->reference_usec += check_run(check->reference[r], "reference", axis);
+                num_references++;
+            }
+            result->candidate_usec += check_run(check->candidate, "candidate", axis);
+
+            num_expected = check_collect(0, num_references, expected,
+                                         sizeof(expected) / sizeof(*expected), &ok);
+            num_actual = check_collect(num_references, 1, actual,
+                                       sizeof(actual) / sizeof(*actual), &ok);
+            if (output_sink_overflow || num_expected != num_actual) {
+                ok = false;
+                continue;
+            }
+
+            error = check_compare(expected, actual, num_expected);
+            result->max_error = max(result->max_error, error);
+            result->num_values += num_expected;
+            if (!(error <= check->tolerance)) {
+                ok = false;
+            }
+        }
+
+        if (!ok) {
+            if (result->num_failed_inputs++ == 0) {
+                result->first_failed_input = input_name;
+            }
+        }
+    }
+}
+
+// -----------------------------------------------------------
+
+static int check_all(void)
+{
+    int i, j, axis;
+    int num_inputs = 0;
+    int num_failed = 0;
+
+    tables_init();
+
+    // the recordings, in pieces
+    for (i = 0; i < sizeof(check_recordings) / sizeof(*check_recordings); ++i) {
+        const check_recording_t *rec = &check_recordings[i];
+        unsigned start;
+        for (start = 0; start + CHECK_NSAMPLES <= rec->num_samples; start += CHECK_NSAMPLES) {
+            memcpy(data, &rec->samples[start], sizeof(data));
+            check_input(rec->name);
+            num_inputs++;
+        }
+    }
+
+    // the synthetic inputs
+    for (i = 0; i < sizeof(check_synthetic) / sizeof(*check_synthetic); ++i) {
+        check_random_state = 2463534242u;
+        for (j = 0; j < CHECK_NSAMPLES; ++j) {
+            for (axis = 0; axis < NUM_AXIS; ++axis) {
+                data[j].v[axis] = check_synthetic[i].f(j, axis);
+            }
+        }
+        check_input(check_synthetic[i].name);
+        num_inputs++;
+    }
+
+    printk("%d inputs of %d samples\n\n", num_inputs, CHECK_NSAMPLES);
+    printk("%-28s %10s %12s %10s %10s %8s  %s\n",
+           "check", "values", "max error", "ref usec", "usec", "speedup", "result");
+    for (i = 0; i < NUM_CHECKS; ++i) {
+        const check_result_t *result = &check_results[i];
+        bool ok = result->num_failed_inputs == 0;
+        printk("%-28s %10lu %12.3g %10.0f %10.0f %7.2fx  %s",
+               checks[i].name, result->num_values, result->max_error,
+               result->reference_usec, result->candidate_usec,
+               result->reference_usec / result->candidate_usec,
+               ok ? "ok" : "FAILED");
+        if (!ok) {
+            printk(" (%u inputs, first: %s)", result->num_failed_inputs, result->first_failed_input);
+            num_failed++;
+        }
+        printk("\n");
+    }
+
+    printk("\n%d of %d checks failed\n", num_failed, (int)NUM_CHECKS);
+    return num_failed ? 1 : 0;
+}
+
+// -----------------------------------------------------------
+
+int main(void)
+{
+    return check_all();
+}
+
+// -----------------------------------------------------------
@@ -0,0 +1,233 @@
+/*
+ * Copyright (c) 2019, Institute of Electronics and Computer Science (EDI)
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * Author: Atis Elsts
+ */
+
+/*
+ * File: feature-extraction.h
+ * The public interface of the feature extraction library (libfeatures.a / libfeatures.so).
+ *
+ * A context holds a feature plan: the list of features to compute, each on one axis.
+ * The samples are split in windows of `features_window_size()` samples,
+ * starting every `features_hop_size()` samples, and each window produces one row
+ * of `features_plan_width()` floats. The offset of each feature in the row
+ * is returned when it is added to the plan.
+ *
+ * `features_process_batch()` processes a complete recording;
+ * `features_process_stream()` accepts the samples in arbitrary chunks,
+ * and produces the same rows as the batch version would for their concatenation.
+ *
+ * The samples can also be passed with timestamps, in any unit: then the windows
+ * do not cross the gaps between them (see `features_set_max_gap()`), e.g. where
+ * packets were lost, or where the timestamps go back when a device restarts.
+ * The stream restarts after a gap, and the windows around it are skipped.
+ *
+ * Optionally, the rows of recent windows are cached (`features_set_cache_size()`),
+ * and reused for the windows with the same samples, e.g. of a device at rest.
+ *
+ * The values are the same as the feature functions of this repository output.
+ * For many concurrent streams (devices), `features_streams_t` keeps the state
+ * of each stream in a single preallocated arena, and extracts the features of
+ * the windows of all streams that are ready at once.
+ *
+ * Each context must only be used by one thread at a time;
+ * different contexts can be used concurrently.
+ * The functions return -1 on errors.
+ */
+
+#ifndef FEATURE_EXTRACTION_H
+#define FEATURE_EXTRACTION_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#if defined(__GNUC__)
+#define FEATURES_API __attribute__((visibility("default")))
+#else
+#define FEATURES_API
+#endif
+
+// The accelerometer samples, same as `accel_t`
+typedef struct {
+    int8_t v[3];
+} features_sample_t;
+
+typedef enum {
+    // The values are part of the ABI of the library: the new kinds are added at the end,
+    // whatever their domain, and the existing ones are never renumbered.
+
+    // time domain features, TIME_WINDOW_SIZE samples
+    FEATURES_MEAN = 0,
+    FEATURES_ENERGY = 1,
+    FEATURES_STD = 2,
+    FEATURES_MIN = 3,
+    FEATURES_MAX = 4,
+    FEATURES_MEDIAN = 5,
+    FEATURES_Q25 = 6,
+    FEATURES_Q75 = 7,
+    FEATURES_IQR = 8,
+    FEATURES_SMA = 9,
+    FEATURES_ENTROPY = 10,
+    // the correlation of the axis and the next axis
+    FEATURES_CORRELATION = 11,
+    // frequency domain features, FREQUENCY_WINDOW_SIZE samples
+    FEATURES_SPECTRAL_ENTROPY = 12,
+    // zero if there are no nonzero frequencies
+    FEATURES_SPECTRAL_MAXIMUM = 13,
+    // FEATURES_SPECTRAL_HISTOGRAM_BINS values
+    FEATURES_SPECTRAL_HISTOGRAM = 14,
+    // time domain: the skewness and the excess kurtosis; zero for a constant window
+    FEATURES_SKEWNESS = 15,
+    FEATURES_KURTOSIS = 16,
+    // time domain: the number of crossings of zero and of the (integer) mean
+    FEATURES_ZERO_CROSSINGS = 17,
+    FEATURES_MEAN_CROSSINGS = 18,
+    // time domain: the number of local maxima above the mean, and the mean interval
+    // between them in samples
+    FEATURES_PEAKS = 19,
+    FEATURES_PEAK_INTERVAL = 20,
+    // frequency domain: the dominant period of the autocorrelation in samples, and its
+    // strength from -1 to 1; zero if there is none
+    FEATURES_PERIOD = 21,
+    FEATURES_PERIOD_STRENGTH = 22,
+    // frequency domain: the shape of the power spectrum without the DC bin, the frequencies
+    // in FFT bins; zero if there is no power
+    FEATURES_SPECTRAL_CENTROID = 23,
+    FEATURES_SPECTRAL_SPREAD = 24,
+    FEATURES_SPECTRAL_ROLLOFF = 25,
+    FEATURES_SPECTRAL_FLATNESS = 26,
+    FEATURES_DOMINANT_FREQUENCY = 27,
+    // frequency domain: the fraction of the power up to 3 Hz
+    FEATURES_SPECTRAL_BAND_RATIO = 28,
+    // frequency domain: the bin of the maximal nonzero frequency of FEATURES_SPECTRAL_MAXIMUM
+    FEATURES_SPECTRAL_MAXIMUM_BIN = 29,
+    // frequency domain: the bin and the power of each of the FEATURES_SPECTRAL_PEAKS_COUNT
+    // highest peaks of the power spectrum, highest first, so the first bin is the argmax
+    // without the DC; zeros if there are fewer
+    FEATURES_SPECTRAL_PEAKS = 30,
+    // time domain: the mean pitch, roll and tilt of the device in radians, from the direction
+    // of gravity; the same for each axis
+    FEATURES_PITCH = 31,
+    FEATURES_ROLL = 32,
+    FEATURES_TILT = 33,
+    FEATURES_NUM_KINDS
+} features_kind_t;
+
+#define FEATURES_SPECTRAL_HISTOGRAM_BINS 9
+#define FEATURES_SPECTRAL_PEAKS_COUNT 3
+
+typedef struct features_context features_context_t;
+
+// Returns NULL if out of memory
+FEATURES_API features_context_t *features_create(void);
+FEATURES_API void features_destroy(features_context_t *ctx);
+
+// Add a feature to the plan; returns its offset in the rows
+FEATURES_API int features_plan_add(features_context_t *ctx, features_kind_t kind, int axis);
+// The number of floats in a row
+FEATURES_API int features_plan_width(const features_context_t *ctx);
+
+FEATURES_API int features_window_size(void);
+FEATURES_API int features_hop_size(void);
+// The maximal number of rows produced from `n` samples, by either of the functions
+FEATURES_API int features_max_windows(int n);
+
+// Compute the rows for `n` samples into `out` (room for `max_windows` rows);
+// returns the number of rows
+FEATURES_API int features_process_batch(features_context_t *ctx,
+                                        const features_sample_t samples[], int n,
+                                        float out[], int max_windows);
+
+// Same, but continues from the samples passed before; nothing is consumed
+// if the rows do not fit in `out`
+FEATURES_API int features_process_stream(features_context_t *ctx,
+                                         const features_sample_t samples[], int n,
+                                         float out[], int max_windows);
+
+// Forget the samples passed to `features_process_stream()`; keeps the plan
+FEATURES_API void features_reset(features_context_t *ctx);
+
+// The largest difference of consecutive timestamps that is not a gap;
+// 0 (the default) means no limit, and only the timestamps that go back are gaps.
+// Also used by the streams created from the context.
+FEATURES_API int features_set_max_gap(features_context_t *ctx, uint64_t max_gap);
+
+// Keep the rows of up to `num_entries` recent windows (rounded up to a power of two),
+// and reuse them for the windows with the same samples; 0 (the default) disables the cache.
+// The streams created from the context afterwards have their own cache of this size.
+FEATURES_API int features_set_cache_size(features_context_t *ctx, int num_entries);
+
+// Same as `features_process_stream()`, with the timestamp of each sample;
+// the stream restarts at the gaps. If `row_times` is not NULL, the timestamp
+// of the last sample of each window is stored in it.
+FEATURES_API int features_process_timed(features_context_t *ctx,
+                                        const features_sample_t samples[],
+                                        const uint64_t timestamps[], int n,
+                                        float out[], uint64_t row_times[], int max_windows);
+
+// -----------------------------------------------------------
+
+typedef struct features_streams features_streams_t;
+
+// Allocate the state of `num_streams` streams, numbered from 0.
+// The plan is taken from `ctx`, which must not be changed or destroyed while in use.
+FEATURES_API features_streams_t *features_streams_create(const features_context_t *ctx,
+                                                        int num_streams);
+FEATURES_API void features_streams_destroy(features_streams_t *streams);
+
+// Append samples to a stream; returns the number of samples consumed.
+// A stream takes no more samples while it has a window ready:
+// call `features_streams_extract()` and push the rest then.
+FEATURES_API int features_streams_push(features_streams_t *streams, int stream,
+                                       const features_sample_t samples[], int n);
+
+// Same, with the timestamp of each sample; the stream restarts at the gaps
+FEATURES_API int features_streams_push_timed(features_streams_t *streams, int stream,
+                                             const features_sample_t samples[],
+                                             const uint64_t timestamps[], int n);
+
+// The number of streams with a window ready
+FEATURES_API int features_streams_num_ready(const features_streams_t *streams);
+
+// Compute the rows of the ready windows, in the order in which they became ready,
+// into `out` (room for `max_windows` rows), and their streams into `stream_ids`;
+// returns the number of rows. The windows that do not fit stay ready.
+FEATURES_API int features_streams_extract(features_streams_t *streams,
+                                          float out[], int stream_ids[], int max_windows);
+
+// Forget the samples of a stream, e.g. when the device reconnects
+FEATURES_API void features_streams_reset(features_streams_t *streams, int stream);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // FEATURE_EXTRACTION_H
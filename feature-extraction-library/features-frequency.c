@@ -41,6 +41,9 @@
 // Floating point FFT
 #include "fft.c"
 
+// Loading of the windows and the float spectral features
+#include "spectral.h"
+
 //
 // The FFT is not post-processed (reordered or normalized).
 // Therefore the structure of the FFT result is this:
@@ -55,12 +58,6 @@
 
 // ------------------------------------------
 
-// The following must hold: (#bins - 1) * (2 * divider) == FREQUENCY_WINDOW_SIZE
-#define NUM_FREQUENCY_HISTOGRAM_BINS 9
-#define FREQUENCY_HISTOGRAM_DIVIDER (FREQUENCY_WINDOW_SIZE / 16)
-
-// ------------------------------------------
-
 typedef void spectral_feature_function_f_t(float re[], float im[], int axis);
 typedef void spectral_feature_function_i_t(int16_t re[], int16_t im[], int axis);
 
@@ -76,32 +73,44 @@ float fabsf(float x)
 
 void spectral_feature_maxima_f(float re[], float im[], int axis)
 {
-    int j;
-    // search for the maximal nonzero frequency, starting from the highest (offset N/2 + 1)
-    // TODO: what to use as the epsilon here?
-    float epsilon = 0.1;
-    for (j = FREQUENCY_WINDOW_SIZE / 2 + 1; j >= 0; --j) {
-        float msq = re[j] * re[j] + im[j] * im[j];
-        if (fabsf(msq) > epsilon) {
-            OUTPUT_F(msq, result_f.v[axis]);
-            LOG("\n");
-            break;
-        }
+    float power[SPECTRAL_NUM_BINS];
+    float msq;
+
+    spectral_power_f(re, im, power);
+    if (spectral_maximum_f(power, &msq)) {
+        OUTPUT_F(msq, result_f.v[axis]);
+        LOG("\n");
     }
 }
 
 void spectral_feature_maxima_i(int16_t re[], int16_t im[], int axis)
 {
-    int j;
-    // search for the maximal nonzero frequency, starting from the highest (offset N/2 + 1)
-    for (j = FREQUENCY_WINDOW_SIZE / 2 + 1; j >= 0; --j) {
-        uint32_t msq = (uint32_t)re[j] * re[j] + im[j] * im[j];
-        if (msq != 0) {
-            OUTPUT_I(msq, result_i.v[axis]);
-            LOG("\n");
-            break;
-        }
+    uint32_t power[SPECTRAL_NUM_BINS];
+    int last;
+
+    spectral_power_i(re, im, power);
+    last = spectral_last_above_i(power, SPECTRAL_MAXIMUM_EPSILON_I);
+    if (last >= 0) {
+        OUTPUT_I(power[last], result_i.v[axis]);
+        LOG("\n");
+    }
+}
+
+// The bins and the powers of the highest peaks, highest first
+void spectral_feature_top_peaks_f(float re[], float im[], int axis)
+{
+    float power[SPECTRAL_NUM_BINS];
+    int bins[SPECTRAL_TOP_PEAKS];
+    float powers[SPECTRAL_TOP_PEAKS];
+    int i;
+
+    spectral_power_f(re, im, power);
+    spectral_top_peaks_f(power, bins, powers);
+    for (i = 0; i < SPECTRAL_TOP_PEAKS; ++i) {
+        OUTPUT_I(bins[i], result_i.v[axis]);
+        OUTPUT_F(powers[i], result_f.v[axis]);
     }
+    LOG("\n");
 }
 
 void spectral_feature_density_f(float re[], float im[], int axis)
@@ -124,26 +133,22 @@ void spectral_feature_density_i(int16_t re[], int16_t im[], int axis)
     }
 }
 
-// XXX: not sure this is the correct definition of entropy of a complex signal
 void spectral_feature_entropy_f(float re[], float im[], int axis)
 {
-    int j;
-    float entropy = 0;
-    float squared_sum = 0;
-    float msq[FREQUENCY_WINDOW_SIZE];
-    float normalization_coefficient = 1.0 / (FREQUENCY_WINDOW_SIZE * FREQUENCY_WINDOW_SIZE);
-    for (j = 0; j < FREQUENCY_WINDOW_SIZE; ++j) {
-        msq[j] = normalization_coefficient * (re[j] * re[j] + im[j] * im[j]); // calculate the squared module |x|^2
-        squared_sum += msq[j];
-    }
-    for (j = 0; j < FREQUENCY_WINDOW_SIZE; ++j) {
-        float q = msq[j] / squared_sum;
-        if (q) {
-            entropy += q * log2f(q);
-        }
-    }
-    entropy = -entropy;
-    OUTPUT_F(entropy, result_f.v[axis]);
+    OUTPUT_F(spectral_entropy_f(re, im), result_f.v[axis]);
+    LOG("\n");
+}
+
+void spectral_feature_entropy_fast_f(float re[], float im[], int axis)
+{
+    OUTPUT_F(spectral_entropy_fast_f(re, im), result_f.v[axis]);
+    LOG("\n");
+}
+
+// In units of 2^-16 bits
+void spectral_feature_entropy_i(int16_t re[], int16_t im[], int axis)
+{
+    OUTPUT_I(spectral_entropy_q16(re, im), result_i.v[axis]);
     LOG("\n");
 }
 
@@ -171,17 +176,9 @@ void spectral_feature_histogram_i(int16_t re[], int16_t im[], int axis)
 void spectral_feature_histogram_f(float re[], float im[], int axis)
 {
     int i;
-    float msq;
-    float bins[NUM_FREQUENCY_HISTOGRAM_BINS] = {0};
+    float bins[NUM_FREQUENCY_HISTOGRAM_BINS];
 
-    msq = re[0] * re[0] + im[0] * im[0];
-    bins[0] = msq;
-
-    for (i = 1; i < FREQUENCY_WINDOW_SIZE / 2 + 1; ++i) {
-        uint8_t ui = (i - 1) / FREQUENCY_HISTOGRAM_DIVIDER + 1;
-        msq = re[i] * re[i] + im[i] * im[i];
-        bins[ui] += msq;
-    }
+    spectral_histogram_f(re, im, bins);
 
     for (i = 0; i < NUM_FREQUENCY_HISTOGRAM_BINS; ++i) {
         OUTPUT_F(bins[i], result_f.v[axis]);
@@ -189,44 +186,91 @@ void spectral_feature_histogram_f(float re[], float im[], int axis)
     LOG("\n");
 }
 
+// Centroid, spread, rolloff, flatness, dominant frequency, and band ratio,
+// from one power spectrum; the frequencies in bins
+void spectral_feature_shape_f(float re[], float im[], int axis)
+{
+    float power[SPECTRAL_NUM_BINS];
+
+    spectral_power_f(re, im, power);
+    OUTPUT_F(spectral_centroid_f(power), result_f.v[axis]);
+    OUTPUT_F(spectral_spread_f(power), result_f.v[axis]);
+    OUTPUT_F(spectral_rolloff_f(power), result_f.v[axis]);
+    OUTPUT_F(spectral_flatness_f(power), result_f.v[axis]);
+    OUTPUT_F(spectral_dominant_f(power), result_f.v[axis]);
+    OUTPUT_F(spectral_band_ratio_f(power), result_f.v[axis]);
+    LOG("\n");
+}
+
+// The same in fixed point: centroid and spread in units of 2^-8 bins,
+// the flatness as -log2 in Q16, and the band ratio in Q15
+void spectral_feature_shape_i(int16_t re[], int16_t im[], int axis)
+{
+    uint32_t power[SPECTRAL_NUM_BINS];
+
+    spectral_power_i(re, im, power);
+    OUTPUT_I(spectral_centroid_q8(power), result_i.v[axis]);
+    OUTPUT_I(spectral_spread_q8(power), result_i.v[axis]);
+    OUTPUT_I(spectral_rolloff_i(power), result_i.v[axis]);
+    OUTPUT_I(spectral_flatness_log2_q16(power), result_i.v[axis]);
+    OUTPUT_I(spectral_dominant_i(power), result_i.v[axis]);
+    OUTPUT_I(spectral_band_ratio_q15(power), result_i.v[axis]);
+    LOG("\n");
+}
+
+// The dominant period in samples and its strength; zero if there is none
+void spectral_feature_autocorrelation_f(float re[], float im[], int axis)
+{
+    float r[FREQUENCY_WINDOW_SIZE];
+    int lag = 0;
+    float strength = 0;
+
+    spectral_autocorrelation_f(re, im, r);
+    spectral_period_f(r, &lag, &strength);
+    OUTPUT_I(lag, result_i.v[axis]);
+    OUTPUT_F(strength, result_f.v[axis]);
+    LOG("\n");
+}
+
 // ------------------------------------------
 
 void feature_spectral_f(spectral_feature_function_f_t f, int axis)
 {
-    int i, j;
+    int i;
     float re[FREQUENCY_WINDOW_SIZE];
     float im[FREQUENCY_WINDOW_SIZE];
 
     LOG("axis=%d\n", axis);
 
+    spectral_window_init();
+
     for (i = 0; i <= NSAMPLES - FREQUENCY_WINDOW_SIZE;
          i += PERIODIC_COMPUTATION_WINDOW_SIZE) {
 
-        for (j = 0; j < FREQUENCY_WINDOW_SIZE; ++j) {
-            re[j] = data[i + j].v[axis];
-        }
+        int32_t sum = spectral_load_f(re, &data[i], axis);
         memset(im, 0, sizeof(im));
 
         // own FFT implementation
         fft(re, im, FREQUENCY_WINDOW_SIZE);
+        spectral_detrend_f(re, sum);
         f(re, im, axis);       
     }
 }
 
 void feature_spectral_i(spectral_feature_function_i_t f, int axis)
 {
-    int i, j;
+    int i;
     int16_t re[FREQUENCY_WINDOW_SIZE];
     int16_t im[FREQUENCY_WINDOW_SIZE];
 
     LOG("axis=%d\n", axis);
 
+    spectral_window_init();
+
     for (i = 0; i <= NSAMPLES - FREQUENCY_WINDOW_SIZE;
          i += PERIODIC_COMPUTATION_WINDOW_SIZE) {
 
-        for (j = 0; j < FREQUENCY_WINDOW_SIZE; ++j) {
-            re[j] = data[i + j].v[axis];
-        }
+        spectral_load_i(re, &data[i], axis);
         memset(im, 0, sizeof(im));
 
         intfft(re, im, FREQUENCY_WINDOW_SIZE);
@@ -251,6 +295,13 @@ void feature_spectral_maxima_f(int axis)
 
 // ------------------------------------------
 
+void feature_spectral_top_peaks_f(int axis)
+{
+    feature_spectral_f(spectral_feature_top_peaks_f, axis);
+}
+
+// ------------------------------------------
+
 void feature_spectral_density_i(int axis)
 {
     feature_spectral_i(spectral_feature_density_i, axis);
@@ -265,40 +316,101 @@ void feature_spectral_density_f(int axis)
 
 // ------------------------------------------
 
+// The same, with the FFT of WINDOW_LANES windows done at once
+void feature_spectral_density_lanes_f(int axis)
+{
+    const int num_windows = (NSAMPLES - FREQUENCY_WINDOW_SIZE) / PERIODIC_COMPUTATION_WINDOW_SIZE + 1;
+    int i, l;
+    static float lanes_re[FREQUENCY_WINDOW_SIZE][WINDOW_LANES];
+    static float lanes_im[FREQUENCY_WINDOW_SIZE][WINDOW_LANES];
+    int32_t sum[WINDOW_LANES];
+    float re[FREQUENCY_WINDOW_SIZE];
+    float im[FREQUENCY_WINDOW_SIZE];
+
+    LOG("axis=%d\n", axis);
+
+    spectral_window_init();
+
+    for (i = 0; i < num_windows; i += WINDOW_LANES) {
+        int n = min(WINDOW_LANES, num_windows - i);
+
+        spectral_load_lanes_f(lanes_re, sum, &data[i * PERIODIC_COMPUTATION_WINDOW_SIZE],
+                              PERIODIC_COMPUTATION_WINDOW_SIZE, n, axis);
+        memset(lanes_im, 0, sizeof(lanes_im));
+
+        fft_lanes(lanes_re, lanes_im);
+
+        for (l = 0; l < n; ++l) {
+            spectral_unload_lane_f(re, im, lanes_re, lanes_im, l);
+            spectral_detrend_f(re, sum[l]);
+            spectral_feature_density_f(re, im, axis);
+        }
+    }
+}
+
+// ------------------------------------------
+
 void feature_spectral_entropy_f(int axis)
 {
     feature_spectral_f(spectral_feature_entropy_f, axis);
 }
 
+void feature_spectral_entropy_fast_f(int axis)
+{
+    feature_spectral_f(spectral_feature_entropy_fast_f, axis);
+}
+
+void feature_spectral_entropy_i(int axis)
+{
+    feature_spectral_i(spectral_feature_entropy_i, axis);
+}
+
+// ------------------------------------------
+
+void feature_spectral_shape_f(int axis)
+{
+    feature_spectral_f(spectral_feature_shape_f, axis);
+}
+
+void feature_spectral_shape_i(int axis)
+{
+    feature_spectral_i(spectral_feature_shape_i, axis);
+}
+
+// ------------------------------------------
+
+void feature_spectral_autocorrelation_f(int axis)
+{
+    feature_spectral_f(spectral_feature_autocorrelation_f, axis);
+}
+
 // ------------------------------------------
 
 void feature_spectral_ma_f(int axis)
 {
-    int i, j;
-    float re[FREQUENCY_WINDOW_SIZE][3];
-    float im[FREQUENCY_WINDOW_SIZE][3];
+    int i, j, a;
+    float re[NUM_AXIS][FREQUENCY_WINDOW_SIZE];
+    float im[NUM_AXIS][FREQUENCY_WINDOW_SIZE];
 
     /* ignore the `axis` argument */
 
+    spectral_window_init();
+
     for (i = 0; i <= NSAMPLES - FREQUENCY_WINDOW_SIZE;
          i += PERIODIC_COMPUTATION_WINDOW_SIZE) {
 
-        for (j = 0; j < FREQUENCY_WINDOW_SIZE; ++j) {
-            re[j][0] = data[i + j].v[0];
-            re[j][1] = data[i + j].v[1];
-            re[j][2] = data[i + j].v[2];
-        }
         memset(im, 0, sizeof(im));
-
-        fft(re[0], im[0], FREQUENCY_WINDOW_SIZE);
-        fft(re[1], im[1], FREQUENCY_WINDOW_SIZE);
-        fft(re[2], im[2], FREQUENCY_WINDOW_SIZE);
+        for (a = 0; a < NUM_AXIS; ++a) {
+            int32_t axis_sum = spectral_load_f(re[a], &data[i], a);
+            fft(re[a], im[a], FREQUENCY_WINDOW_SIZE);
+            spectral_detrend_f(re[a], axis_sum);
+        }
 
         float sum = 0;
         for (j = 0; j <= FREQUENCY_WINDOW_SIZE / 2; ++j) {
-            float amsq = re[j][0] * re[j][0] + im[j][0] * im[j][0];
-            float bmsq = re[j][1] * re[j][1] + im[j][1] * im[j][1];
-            float cmsq = re[j][2] * re[j][2] + im[j][2] * im[j][2];
+            float amsq = re[0][j] * re[0][j] + im[0][j] * im[0][j];
+            float bmsq = re[1][j] * re[1][j] + im[1][j] * im[1][j];
+            float cmsq = re[2][j] * re[2][j] + im[2][j] * im[2][j];
             float msq = sqrtf(amsq + bmsq + cmsq);
             if(j != 0 && j != FREQUENCY_WINDOW_SIZE / 2) {
                 // account both for the negative and positive frequency
@@ -316,32 +428,29 @@ void feature_spectral_ma_f(int axis)
 
 void feature_spectral_ma_squared_i(int axis)
 {
-    int i, j;
-    int16_t re[FREQUENCY_WINDOW_SIZE][3];
-    int16_t im[FREQUENCY_WINDOW_SIZE][3];
+    int i, j, a;
+    int16_t re[NUM_AXIS][FREQUENCY_WINDOW_SIZE];
+    int16_t im[NUM_AXIS][FREQUENCY_WINDOW_SIZE];
 
     /* ignore the `axis` argument */
 
+    spectral_window_init();
+
     for (i = 0; i <= NSAMPLES - FREQUENCY_WINDOW_SIZE;
          i += PERIODIC_COMPUTATION_WINDOW_SIZE) {
 
-        for (j = 0; j < FREQUENCY_WINDOW_SIZE; ++j) {
-            re[j][0] = data[i + j].v[0];
-            re[j][1] = data[i + j].v[1];
-            re[j][2] = data[i + j].v[2];
-        }
         memset(im, 0, sizeof(im));
-
-        intfft(re[0], im[0], FREQUENCY_WINDOW_SIZE);
-        intfft(re[1], im[1], FREQUENCY_WINDOW_SIZE);
-        intfft(re[2], im[2], FREQUENCY_WINDOW_SIZE);
+        for (a = 0; a < NUM_AXIS; ++a) {
+            spectral_load_i(re[a], &data[i], a);
+            intfft(re[a], im[a], FREQUENCY_WINDOW_SIZE);
+        }
 
         uint64_t sum = 0;
         for (j = 0; j <= FREQUENCY_WINDOW_SIZE / 2; ++j) {
             // XXX: this could also be done using 32-bit arithmetic I guess?
-            uint64_t amsq = (uint64_t)re[j][0] * re[j][0] + im[j][0] * im[j][0];
-            uint64_t bmsq = (uint64_t)re[j][1] * re[j][1] + im[j][1] * im[j][1];
-            uint64_t cmsq = (uint64_t)re[j][2] * re[j][2] + im[j][2] * im[j][2];
+            uint64_t amsq = (uint64_t)re[0][j] * re[0][j] + im[0][j] * im[0][j];
+            uint64_t bmsq = (uint64_t)re[1][j] * re[1][j] + im[1][j] * im[1][j];
+            uint64_t cmsq = (uint64_t)re[2][j] * re[2][j] + im[2][j] * im[2][j];
             uint64_t msq = amsq + bmsq + cmsq;
             if(j != 0 && j != FREQUENCY_WINDOW_SIZE / 2) {
                 // account both for the negative and positive frequency
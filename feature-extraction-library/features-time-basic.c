@@ -33,6 +33,9 @@
  * Time domain features: empty loop, mean, energy, std, correlation, SMA
  */
 
+#include "window-features.h"
+#include "window-lanes.h"
+
 // -----------------------------------------------------------
 
 void feature_nop(int axis)
@@ -64,16 +67,12 @@ void feature_nop_nop(int axis)
 
 void feature_mean(int axis)
 {
-    int i, j;
+    int i;
     LOG("axis=%d\n", axis);
     for (i = 0; i <= NSAMPLES - TIME_WINDOW_SIZE; i += PERIODIC_COMPUTATION_WINDOW_SIZE) {
-        int32_t sum = 0;
-        for (j = 0; j < TIME_WINDOW_SIZE; ++j) {
-            sum += data[i + j].v[axis];
-        }
-
-        int32_t avg = sum / TIME_WINDOW_SIZE;
-        OUTPUT_I(avg, result_i.v[axis]);
+        window_moments_t m;
+        window_moments(&data[i], axis, &m);
+        OUTPUT_I(m.avg, result_i.v[axis]);
         LOG("\n");
     }
 }
@@ -81,55 +80,37 @@ void feature_mean(int axis)
 // this is also known as root mean square
 void feature_energy(int axis)
 {
-    int i, j;
+    int i;
     LOG("axis=%d\n", axis);
     for (i = 0; i <= NSAMPLES - TIME_WINDOW_SIZE; i += PERIODIC_COMPUTATION_WINDOW_SIZE) {
-        uint32_t sqsum = 0;
-        for (j = 0; j < TIME_WINDOW_SIZE; ++j) {
-            sqsum += (int)data[i + j].v[axis] * data[i + j].v[axis];
-        }
-
-        int32_t squared_avg = sqsum / TIME_WINDOW_SIZE;
-        OUTPUT_F(sqrtf(squared_avg), result_f.v[axis]);
+        window_moments_t m;
+        window_moments(&data[i], axis, &m);
+        OUTPUT_F(window_energy(&m), result_f.v[axis]);
         LOG("\n");
     }
 }
 
 void feature_energy_mean(int axis)
 {
-    int i, j;
+    int i;
     LOG("axis=%d\n", axis);
     for (i = 0; i <= NSAMPLES - TIME_WINDOW_SIZE; i += PERIODIC_COMPUTATION_WINDOW_SIZE) {
-        int32_t sum = 0;
-        uint32_t sqsum = 0;
-        for (j = 0; j < TIME_WINDOW_SIZE; ++j) {
-            sum += data[i + j].v[axis];
-            sqsum += (int)data[i + j].v[axis] * data[i + j].v[axis];
-        }
-
-        int32_t avg = sum / TIME_WINDOW_SIZE;
-        int32_t squared_avg = sqsum / TIME_WINDOW_SIZE;
-        OUTPUT_I(avg, result_i.v[axis]);
-        OUTPUT_F(sqrtf(squared_avg), result_f.v[axis]);
+        window_moments_t m;
+        window_moments(&data[i], axis, &m);
+        OUTPUT_I(m.avg, result_i.v[axis]);
+        OUTPUT_F(window_energy(&m), result_f.v[axis]);
         LOG("\n");
     }
 }
 
 void feature_std(int axis)
 {
-    int i, j;
+    int i;
     LOG("axis=%d\n", axis);
     for (i = 0; i <= NSAMPLES - TIME_WINDOW_SIZE; i += PERIODIC_COMPUTATION_WINDOW_SIZE) {
-        int32_t sum = 0;
-        uint32_t sqsum = 0;
-        for (j = 0; j < TIME_WINDOW_SIZE; ++j) {
-            sum += data[i + j].v[axis];
-            sqsum += (int)data[i + j].v[axis] * data[i + j].v[axis];
-        }
-
-        int32_t avg = sum / TIME_WINDOW_SIZE;
-        int32_t squared_avg = sqsum / TIME_WINDOW_SIZE;
-        OUTPUT_F(sqrtf(squared_avg - avg * avg), result_f.v[axis]);
+        window_moments_t m;
+        window_moments(&data[i], axis, &m);
+        OUTPUT_F(window_std(&m), result_f.v[axis]);
         LOG("\n");
     }
 }
@@ -137,140 +118,183 @@ void feature_std(int axis)
 
 void feature_std_mean(int axis)
 {
-    int i, j;
+    int i;
     LOG("axis=%d\n", axis);
     for (i = 0; i <= NSAMPLES - TIME_WINDOW_SIZE; i += PERIODIC_COMPUTATION_WINDOW_SIZE) {
-        int32_t sum = 0;
-        uint32_t sqsum = 0;
-        for (j = 0; j < TIME_WINDOW_SIZE; ++j) {
-            sum += data[i + j].v[axis];
-            sqsum += (int)data[i + j].v[axis] * data[i + j].v[axis];
-        }
-
-        int32_t avg = sum / TIME_WINDOW_SIZE;
-        int32_t squared_avg = sqsum / TIME_WINDOW_SIZE;
-        OUTPUT_I(avg, result_i.v[axis]);
-        OUTPUT_F(sqrtf(squared_avg - avg * avg), result_f.v[axis]);
+        window_moments_t m;
+        window_moments(&data[i], axis, &m);
+        OUTPUT_I(m.avg, result_i.v[axis]);
+        OUTPUT_F(window_std(&m), result_f.v[axis]);
         LOG("\n");
     }
 }
 
 void feature_std_energy(int axis)
 {
-    int i, j;
+    int i;
     LOG("axis=%d\n", axis);
     for (i = 0; i <= NSAMPLES - TIME_WINDOW_SIZE; i += PERIODIC_COMPUTATION_WINDOW_SIZE) {
-        int32_t sum = 0;
-        uint32_t sqsum = 0;
-        for (j = 0; j < TIME_WINDOW_SIZE; ++j) {
-            sum += data[i + j].v[axis];
-            sqsum += (int)data[i + j].v[axis] * data[i + j].v[axis];
-        }
-
-        int32_t avg = sum / TIME_WINDOW_SIZE;
-        int32_t squared_avg = sqsum / TIME_WINDOW_SIZE;
-        OUTPUT_F(sqrtf(squared_avg), result_f.v[axis]);
-        OUTPUT_F(sqrtf(squared_avg - avg * avg), result_f.v[axis]);
+        window_moments_t m;
+        window_moments(&data[i], axis, &m);
+        OUTPUT_F(window_energy(&m), result_f.v[axis]);
+        OUTPUT_F(window_std(&m), result_f.v[axis]);
         LOG("\n");
     }
 }
 
 void feature_std_energy_mean(int axis)
 {
-    int i, j;
+    int i;
     LOG("axis=%d\n", axis);
     for (i = 0; i <= NSAMPLES - TIME_WINDOW_SIZE; i += PERIODIC_COMPUTATION_WINDOW_SIZE) {
-        int32_t sum = 0;
-        uint32_t sqsum = 0;
-        for (j = 0; j < TIME_WINDOW_SIZE; ++j) {
-            sum += data[i + j].v[axis];
-            sqsum += (int)data[i + j].v[axis] * data[i + j].v[axis];
-        }
-
-        int32_t avg = sum / TIME_WINDOW_SIZE;
-        int32_t squared_avg = sqsum / TIME_WINDOW_SIZE;
-        OUTPUT_I(avg, result_i.v[axis]);
-        OUTPUT_F(sqrtf(squared_avg), result_f.v[axis]);
-        OUTPUT_F(sqrtf(squared_avg - avg * avg), result_f.v[axis]);
+        window_moments_t m;
+        window_moments(&data[i], axis, &m);
+        OUTPUT_I(m.avg, result_i.v[axis]);
+        OUTPUT_F(window_energy(&m), result_f.v[axis]);
+        OUTPUT_F(window_std(&m), result_f.v[axis]);
         LOG("\n");
     }
 }
 
 // -----------------------------------------------------------
 
-void feature_correlation(int axis)
+// The higher moments, from the sums of the powers
+
+void feature_skewness(int axis)
 {
-    int i, j;
-    int axis1 = axis;
-    int axis2 = (axis + 1) % NUM_AXIS;
+    int i;
     LOG("axis=%d\n", axis);
     for (i = 0; i <= NSAMPLES - TIME_WINDOW_SIZE; i += PERIODIC_COMPUTATION_WINDOW_SIZE) {
-        int32_t sum1 = 0, sum2 = 0;
-        uint32_t sqsum1 = 0, sqsum2 = 0;
-        int32_t msum = 0;
-        for (j = 0; j < TIME_WINDOW_SIZE; ++j) {
-            sum1 += data[i + j].v[axis1];
-            sqsum1 += (int)data[i + j].v[axis1] * data[i + j].v[axis1];
+        window_powers_t p;
+        window_powers(&data[i], axis, TIME_WINDOW_SIZE, &p);
+        OUTPUT_F(window_skewness(&p), result_f.v[axis]);
+        LOG("\n");
+    }
+}
 
-            sum2 += data[i + j].v[axis2];
-            sqsum2 += (int)data[i + j].v[axis2] * data[i + j].v[axis2];
+void feature_kurtosis(int axis)
+{
+    int i;
+    LOG("axis=%d\n", axis);
+    for (i = 0; i <= NSAMPLES - TIME_WINDOW_SIZE; i += PERIODIC_COMPUTATION_WINDOW_SIZE) {
+        window_powers_t p;
+        window_powers(&data[i], axis, TIME_WINDOW_SIZE, &p);
+        OUTPUT_F(window_kurtosis(&p), result_f.v[axis]);
+        LOG("\n");
+    }
+}
 
-            msum += (int)data[i + j].v[axis1] * data[i + j].v[axis2];
-        }
+static inline void moments_output(const window_powers_t *p, int axis)
+{
+    window_moments_t m;
+    window_moments_from_sums(p->sum, p->sqsum, &m);
+    OUTPUT_I(m.avg, result_i.v[axis]);
+    OUTPUT_F(window_std(&m), result_f.v[axis]);
+    OUTPUT_F(window_skewness(p), result_f.v[axis]);
+    OUTPUT_F(window_kurtosis(p), result_f.v[axis]);
+    LOG("\n");
+}
 
-        int32_t avg1 = sum1 / TIME_WINDOW_SIZE;
-        int32_t squared_avg1 = sqsum1 / TIME_WINDOW_SIZE;
-        float std1 = sqrtf(squared_avg1 - avg1 * avg1);
+void feature_std_skewness_kurtosis_mean(int axis)
+{
+    int i;
+    LOG("axis=%d\n", axis);
+    for (i = 0; i <= NSAMPLES - TIME_WINDOW_SIZE; i += PERIODIC_COMPUTATION_WINDOW_SIZE) {
+        window_powers_t p;
+        window_powers(&data[i], axis, TIME_WINDOW_SIZE, &p);
+        moments_output(&p, axis);
+    }
+}
 
-        int32_t avg2 = sum2 / TIME_WINDOW_SIZE;
-        int32_t squared_avg2 = sqsum2 / TIME_WINDOW_SIZE;
-        float std2 = sqrtf(squared_avg2 - avg2 * avg2);
+// The windows consist of two hops, so each hop is summed once
+void feature_std_skewness_kurtosis_mean_sliding(int axis)
+{
+    int i;
+    window_powers_t hop[2];
+    LOG("axis=%d\n", axis);
+    if (NSAMPLES < TIME_WINDOW_SIZE) {
+        return;
+    }
+    window_powers(&data[0], axis, PERIODIC_COMPUTATION_WINDOW_SIZE, &hop[1]);
+    for (i = 0; i <= NSAMPLES - TIME_WINDOW_SIZE; i += PERIODIC_COMPUTATION_WINDOW_SIZE) {
+        window_powers_t p;
+        hop[0] = hop[1];
+        window_powers(&data[i + PERIODIC_COMPUTATION_WINDOW_SIZE], axis,
+                      PERIODIC_COMPUTATION_WINDOW_SIZE, &hop[1]);
+        window_powers_add(&p, &hop[0], &hop[1]);
+        moments_output(&p, axis);
+    }
+}
 
-        int32_t avgm = msum / TIME_WINDOW_SIZE;
+// -----------------------------------------------------------
 
-        float e = avgm - avg1 * avg2;
-        float corr = (std1 == 0 || std2 == 0) ? 0 : e / (std1 * std2);
+// The integer versions: energy and std in Q8
 
-        OUTPUT_F(corr, result_f.v[axis]);
+void feature_energy_i(int axis)
+{
+    int i;
+    LOG("axis=%d\n", axis);
+    for (i = 0; i <= NSAMPLES - TIME_WINDOW_SIZE; i += PERIODIC_COMPUTATION_WINDOW_SIZE) {
+        window_moments_t m;
+        window_moments(&data[i], axis, &m);
+        OUTPUT_I(window_energy_q8(&m), result_i.v[axis]);
+        LOG("\n");
+    }
+}
 
+void feature_std_i(int axis)
+{
+    int i;
+    LOG("axis=%d\n", axis);
+    for (i = 0; i <= NSAMPLES - TIME_WINDOW_SIZE; i += PERIODIC_COMPUTATION_WINDOW_SIZE) {
+        window_moments_t m;
+        window_moments(&data[i], axis, &m);
+        OUTPUT_I(window_std_q8(&m), result_i.v[axis]);
         LOG("\n");
     }
 }
 
 // -----------------------------------------------------------
 
-void feature_correlation_std(int axis)
+void feature_correlation(int axis)
 {
-    int i, j;
+    int i;
     int axis1 = axis;
     int axis2 = (axis + 1) % NUM_AXIS;
     LOG("axis=%d\n", axis);
     for (i = 0; i <= NSAMPLES - TIME_WINDOW_SIZE; i += PERIODIC_COMPUTATION_WINDOW_SIZE) {
-        int32_t sum1 = 0, sum2 = 0;
-        uint32_t sqsum1 = 0, sqsum2 = 0;
-        int32_t msum = 0;
-        for (j = 0; j < TIME_WINDOW_SIZE; ++j) {
-            sum1 += data[i + j].v[axis1];
-            sqsum1 += (int)data[i + j].v[axis1] * data[i + j].v[axis1];
-
-            sum2 += data[i + j].v[axis2];
-            sqsum2 += (int)data[i + j].v[axis2] * data[i + j].v[axis2];
+        float corr = window_correlation(&data[i], axis1, axis2, NULL, NULL);
 
-            msum += (int)data[i + j].v[axis1] * data[i + j].v[axis2];
-        }
+        OUTPUT_F(corr, result_f.v[axis]);
 
-        int32_t avg1 = sum1 / TIME_WINDOW_SIZE;
-        int32_t squared_avg1 = sqsum1 / TIME_WINDOW_SIZE;
-        float std1 = sqrtf(squared_avg1 - avg1 * avg1);
+        LOG("\n");
+    }
+}
 
-        int32_t avg2 = sum2 / TIME_WINDOW_SIZE;
-        int32_t squared_avg2 = sqsum2 / TIME_WINDOW_SIZE;
-        float std2 = sqrtf(squared_avg2 - avg2 * avg2);
+// in Q15
+void feature_correlation_i(int axis)
+{
+    int i;
+    int axis1 = axis;
+    int axis2 = (axis + 1) % NUM_AXIS;
+    LOG("axis=%d\n", axis);
+    for (i = 0; i <= NSAMPLES - TIME_WINDOW_SIZE; i += PERIODIC_COMPUTATION_WINDOW_SIZE) {
+        OUTPUT_I(window_correlation_q15(&data[i], axis1, axis2), result_i.v[axis]);
+        LOG("\n");
+    }
+}
 
-        int32_t avgm = msum / TIME_WINDOW_SIZE;
+// -----------------------------------------------------------
 
-        float e = avgm - avg1 * avg2;
-        float corr = (std1 == 0 || std2 == 0) ? 0 : e / (std1 * std2);
+void feature_correlation_std(int axis)
+{
+    int i;
+    int axis1 = axis;
+    int axis2 = (axis + 1) % NUM_AXIS;
+    LOG("axis=%d\n", axis);
+    for (i = 0; i <= NSAMPLES - TIME_WINDOW_SIZE; i += PERIODIC_COMPUTATION_WINDOW_SIZE) {
+        float std1;
+        float corr = window_correlation(&data[i], axis1, axis2, &std1, NULL);
 
         OUTPUT_F(corr, result_f.v[axis]);
         OUTPUT_F(std1, result_f.v[axis1]);
@@ -283,59 +307,177 @@ void feature_correlation_std(int axis)
 
 void feature_correlation_std_std(int axis)
 {
-    int i, j;
+    int i;
     int axis1 = axis;
     int axis2 = (axis + 1) % NUM_AXIS;
     LOG("axis=%d\n", axis);
     for (i = 0; i <= NSAMPLES - TIME_WINDOW_SIZE; i += PERIODIC_COMPUTATION_WINDOW_SIZE) {
-        int32_t sum1 = 0, sum2 = 0;
-        uint32_t sqsum1 = 0, sqsum2 = 0;
-        int32_t msum = 0;
-        for (j = 0; j < TIME_WINDOW_SIZE; ++j) {
-            sum1 += data[i + j].v[axis1];
-            sqsum1 += (int)data[i + j].v[axis1] * data[i + j].v[axis1];
+        float std1, std2;
+        float corr = window_correlation(&data[i], axis1, axis2, &std1, &std2);
 
-            sum2 += data[i + j].v[axis2];
-            sqsum2 += (int)data[i + j].v[axis2] * data[i + j].v[axis2];
+        OUTPUT_F(corr, result_f.v[axis]);
+        OUTPUT_F(std1, result_f.v[axis1]);
+        OUTPUT_F(std2, result_f.v[axis2]);
 
-            msum += (int)data[i + j].v[axis1] * data[i + j].v[axis2];
-        }
+        LOG("\n");
+    }
+}
 
-        int32_t avg1 = sum1 / TIME_WINDOW_SIZE;
-        int32_t squared_avg1 = sqsum1 / TIME_WINDOW_SIZE;
-        float std1 = sqrtf(squared_avg1 - avg1 * avg1);
+// -----------------------------------------------------------
 
-        int32_t avg2 = sum2 / TIME_WINDOW_SIZE;
-        int32_t squared_avg2 = sqsum2 / TIME_WINDOW_SIZE;
-        float std2 = sqrtf(squared_avg2 - avg2 * avg2);
+void feature_sma(int axis)
+{
+    int i;
+    LOG("axis=%d\n", axis);
+    for (i = 0; i <= NSAMPLES - TIME_WINDOW_SIZE; i += PERIODIC_COMPUTATION_WINDOW_SIZE) {
+        OUTPUT_I(window_sma(&data[i], axis), result_i.v[axis]);
+        LOG("\n");
+    }
+}
 
-        int32_t avgm = msum / TIME_WINDOW_SIZE;
+// -----------------------------------------------------------
+//
+// The same, for WINDOW_LANES windows at once (see window-lanes.h)
+//
 
-        float e = avgm - avg1 * avg2;
-        float corr = (std1 == 0 || std2 == 0) ? 0 : e / (std1 * std2);
+// the number of windows in the loops above
+#define NUM_TIME_WINDOWS ((NSAMPLES - TIME_WINDOW_SIZE) / PERIODIC_COMPUTATION_WINDOW_SIZE + 1)
 
-        OUTPUT_F(corr, result_f.v[axis]);
-        OUTPUT_F(std1, result_f.v[axis1]);
-        OUTPUT_F(std2, result_f.v[axis2]);
+void feature_std_energy_mean_lanes(int axis)
+{
+    int i, l;
+    LOG("axis=%d\n", axis);
+    for (i = 0; i < NUM_TIME_WINDOWS; i += WINDOW_LANES) {
+        window_lanes_t t;
+        window_sum_t sum[WINDOW_LANES];
+        window_sqsum_t sqsum[WINDOW_LANES];
+        int n = min(WINDOW_LANES, NUM_TIME_WINDOWS - i);
+
+        window_lanes_load(t, &data[i * PERIODIC_COMPUTATION_WINDOW_SIZE],
+                          PERIODIC_COMPUTATION_WINDOW_SIZE, n, axis);
+        window_lanes_sums(t, sum, sqsum);
+
+        for (l = 0; l < n; ++l) {
+            window_moments_t m;
+            window_moments_from_sums(sum[l], sqsum[l], &m);
+            OUTPUT_I(m.avg, result_i.v[axis]);
+            OUTPUT_F(window_energy(&m), result_f.v[axis]);
+            OUTPUT_F(window_std(&m), result_f.v[axis]);
+            LOG("\n");
+        }
+    }
+}
 
-        LOG("\n");
+void feature_correlation_lanes(int axis)
+{
+    int i, l;
+    int axis1 = axis;
+    int axis2 = (axis + 1) % NUM_AXIS;
+    LOG("axis=%d\n", axis);
+    for (i = 0; i < NUM_TIME_WINDOWS; i += WINDOW_LANES) {
+        window_lanes_t t1, t2;
+        window_sum_t sum1[WINDOW_LANES], sum2[WINDOW_LANES], msum[WINDOW_LANES];
+        window_sqsum_t sqsum1[WINDOW_LANES], sqsum2[WINDOW_LANES];
+        int n = min(WINDOW_LANES, NUM_TIME_WINDOWS - i);
+
+        window_lanes_load2(t1, t2, &data[i * PERIODIC_COMPUTATION_WINDOW_SIZE],
+                           PERIODIC_COMPUTATION_WINDOW_SIZE, n, axis1, axis2);
+        window_lanes_sums(t1, sum1, sqsum1);
+        window_lanes_sums(t2, sum2, sqsum2);
+        window_lanes_cross_sums(t1, t2, msum);
+
+        for (l = 0; l < n; ++l) {
+            float corr = window_correlation_from_sums(sum1[l], sqsum1[l], sum2[l], sqsum2[l],
+                                                      msum[l], NULL, NULL);
+            OUTPUT_F(corr, result_f.v[axis]);
+            LOG("\n");
+        }
     }
 }
 
 // -----------------------------------------------------------
+//
+// The correlation matrix: the mean and std of each axis, and the covariance
+// and correlation of each pair of axes (xy, yz, zx), from one pass over the window.
+// These output all axes whatever the `axis` is.
+//
 
-void feature_sma(int axis)
+static inline void correlation_matrix_output(const window_correlation_matrix_t *m)
 {
-    int i, j;
+    int a;
+    for (a = 0; a < NUM_AXIS; ++a) {
+        OUTPUT_I(m->avg[a], result_i.v[a]);
+        OUTPUT_F(m->std[a], result_f.v[a]);
+    }
+    for (a = 0; a < NUM_AXIS; ++a) {
+        OUTPUT_F(m->cov[a], result_f.v[a]);
+        OUTPUT_F(m->corr[a], result_f.v[a]);
+    }
+    LOG("\n");
+}
+
+void feature_correlation_matrix(int axis)
+{
+    int i;
     LOG("axis=%d\n", axis);
     for (i = 0; i <= NSAMPLES - TIME_WINDOW_SIZE; i += PERIODIC_COMPUTATION_WINDOW_SIZE) {
-        uint32_t abssum = 0;
-        for (j = 0; j < TIME_WINDOW_SIZE; ++j) {
-            abssum += abs(data[i + j].v[axis]);
+        window_correlation_matrix_t m;
+        window_correlation_matrix(&data[i], &m);
+        correlation_matrix_output(&m);
+    }
+}
+
+void feature_correlation_matrix_lanes(int axis)
+{
+    int i, l, a;
+    LOG("axis=%d\n", axis);
+    for (i = 0; i < NUM_TIME_WINDOWS; i += WINDOW_LANES) {
+        window_lanes_t t[NUM_AXIS];
+        window_sum_t sum[NUM_AXIS][WINDOW_LANES], msum[NUM_AXIS][WINDOW_LANES];
+        window_sqsum_t sqsum[NUM_AXIS][WINDOW_LANES];
+        int n = min(WINDOW_LANES, NUM_TIME_WINDOWS - i);
+
+        window_lanes_load3(t, &data[i * PERIODIC_COMPUTATION_WINDOW_SIZE],
+                           PERIODIC_COMPUTATION_WINDOW_SIZE, n);
+        for (a = 0; a < NUM_AXIS; ++a) {
+            window_lanes_sums(t[a], sum[a], sqsum[a]);
+            window_lanes_cross_sums(t[a], t[(a + 1) % NUM_AXIS], msum[a]);
         }
 
-        OUTPUT_I(abssum / TIME_WINDOW_SIZE, result_i.v[axis]);
-        LOG("\n");
+        for (l = 0; l < n; ++l) {
+            window_cross_sums_t s;
+            window_correlation_matrix_t m;
+            for (a = 0; a < NUM_AXIS; ++a) {
+                s.sum[a] = sum[a][l];
+                s.sqsum[a] = sqsum[a][l];
+                s.msum[a] = msum[a][l];
+            }
+            window_correlation_matrix_from_sums(&s, &m);
+            correlation_matrix_output(&m);
+        }
+    }
+}
+
+// The windows consist of two hops, so each hop is summed once
+// and the sums of a window are those of its two hops
+void feature_correlation_matrix_sliding(int axis)
+{
+    int i;
+    window_cross_sums_t hop[2];
+    LOG("axis=%d\n", axis);
+    if (NSAMPLES < TIME_WINDOW_SIZE) {
+        return;
+    }
+    window_cross_sums(&data[0], PERIODIC_COMPUTATION_WINDOW_SIZE, &hop[1]);
+    for (i = 0; i <= NSAMPLES - TIME_WINDOW_SIZE; i += PERIODIC_COMPUTATION_WINDOW_SIZE) {
+        window_cross_sums_t s;
+        window_correlation_matrix_t m;
+        hop[0] = hop[1];
+        window_cross_sums(&data[i + PERIODIC_COMPUTATION_WINDOW_SIZE],
+                          PERIODIC_COMPUTATION_WINDOW_SIZE, &hop[1]);
+        window_cross_sums_add(&s, &hop[0], &hop[1]);
+        window_correlation_matrix_from_sums(&s, &m);
+        correlation_matrix_output(&m);
     }
 }
 
@@ -33,18 +33,17 @@
  * Time domain features: sorting based
  */
 
+#include "window-features.h"
+#include "window-lanes.h"
+
 // -----------------------------------------------------------
 
 void feature_min(int axis)
 {
-    int i, j;
+    int i;
     LOG("axis=%d\n", axis);
     for (i = 0; i < NSAMPLES - TIME_WINDOW_SIZE; i += PERIODIC_COMPUTATION_WINDOW_SIZE) {
-        int minval = INT_MAX;
-        for (j = 0; j < TIME_WINDOW_SIZE; ++j) {
-            minval = min(minval, data[i + j].v[axis]);
-        }
-        OUTPUT_I(minval, result_i.v[axis]);
+        OUTPUT_I(window_min(&data[i], axis), result_i.v[axis]);
         LOG("\n");
     }
 }
@@ -53,14 +52,10 @@ void feature_min(int axis)
 
 void feature_max(int axis)
 {
-    int i, j;
+    int i;
     LOG("axis=%d\n", axis);
     for (i = 0; i < NSAMPLES - TIME_WINDOW_SIZE; i += PERIODIC_COMPUTATION_WINDOW_SIZE) {
-        int maxval = INT_MIN;
-        for (j = 0; j < TIME_WINDOW_SIZE; ++j) {
-            maxval = max(maxval, data[i + j].v[axis]);
-        }
-        OUTPUT_I(maxval, result_i.v[axis]);
+        OUTPUT_I(window_max(&data[i], axis), result_i.v[axis]);
         LOG("\n");
     }
 }
@@ -84,24 +79,42 @@ void feature_min_max(int axis)
     }
 }
 
+// The same, for WINDOW_LANES windows at once (see window-lanes.h)
+void feature_min_max_lanes(int axis)
+{
+    // the number of windows in the loop above
+    const int num_windows = (NSAMPLES - TIME_WINDOW_SIZE + PERIODIC_COMPUTATION_WINDOW_SIZE - 1)
+        / PERIODIC_COMPUTATION_WINDOW_SIZE;
+    int i, l;
+    LOG("axis=%d\n", axis);
+    for (i = 0; i < num_windows; i += WINDOW_LANES) {
+        window_lanes_t t;
+        int minval[WINDOW_LANES], maxval[WINDOW_LANES];
+        int n = min(WINDOW_LANES, num_windows - i);
+
+        window_lanes_load(t, &data[i * PERIODIC_COMPUTATION_WINDOW_SIZE],
+                          PERIODIC_COMPUTATION_WINDOW_SIZE, n, axis);
+        window_lanes_min_max(t, minval, maxval);
+
+        for (l = 0; l < n; ++l) {
+            OUTPUT_I(minval[l], result_i.v[axis]);
+            OUTPUT_I(maxval[l], result_i.v[axis]);
+            LOG("\n");
+        }
+    }
+}
+
 // -----------------------------------------------------------
 
 void feature_select_nth(int axis, int nth)
 {
-    int i, j;
+    int i;
     LOG("axis=%d\n", axis);
     for (i = 0; i < NSAMPLES - TIME_WINDOW_SIZE; i += PERIODIC_COMPUTATION_WINDOW_SIZE) {
         // put all data in bins and walk through the bins while the nth element is found
-        int8_t stats[256] = {0};
-        for (j = 0; j < TIME_WINDOW_SIZE; ++j) {
-            int v = data[i + j].v[axis] + 128;
-            stats[v]++;
-        }
-        for (j = 0; j < 256; ++j) {
-            if(stats[j] >= nth) break;
-            nth -= stats[j];
-        }        
-        OUTPUT_I(j - 128, result_i.v[axis]);
+        histogram_bin_t stats[256];
+        window_histogram(&data[i], axis, stats);
+        OUTPUT_I(window_histogram_select(stats, nth), result_i.v[axis]);
         LOG("\n");
     }
 }
@@ -131,7 +144,7 @@ void feature_iqr(int axis)
     LOG("axis=%d\n", axis);
     for (i = 0; i < NSAMPLES - TIME_WINDOW_SIZE; i += PERIODIC_COMPUTATION_WINDOW_SIZE) {
         // put all data in bins and walk through the bins while the nth element is found
-        int8_t stats[256] = {0};
+        histogram_bin_t stats[256] = {0};
         for (j = 0; j < TIME_WINDOW_SIZE; ++j) {
             int v = data[i + j].v[axis] + 128;
             stats[v]++;
@@ -168,7 +181,7 @@ void feature_median_iqr(int axis)
     LOG("axis=%d\n", axis);
     for (i = 0; i < NSAMPLES - TIME_WINDOW_SIZE; i += PERIODIC_COMPUTATION_WINDOW_SIZE) {
         // put all data in bins and walk through the bins while the nth element is found
-        int8_t stats[256] = {0};
+        histogram_bin_t stats[256] = {0};
         for (j = 0; j < TIME_WINDOW_SIZE; ++j) {
             int v = data[i + j].v[axis] + 128;
             stats[v]++;
@@ -211,7 +224,7 @@ void feature_median_iqr_min_max(int axis)
     LOG("axis=%d\n", axis);
     for (i = 0; i < NSAMPLES - TIME_WINDOW_SIZE; i += PERIODIC_COMPUTATION_WINDOW_SIZE) {
         // put all data in bins and walk through the bins while the nth element is found
-        int8_t stats[256] = {0};
+        histogram_bin_t stats[256] = {0};
         int minval = INT_MAX;
         int maxval = INT_MIN;       
         for (j = 0; j < TIME_WINDOW_SIZE; ++j) {
@@ -271,7 +284,8 @@ void feature_sort_median(int axis)
         }
         qsort(buffer, TIME_WINDOW_SIZE, 1, cmp);
 
-        int median = buffer[TIME_WINDOW_SIZE / 2];
+        // the same rank as `feature_median`: the (TIME_WINDOW_SIZE / 2)-th smallest
+        int median = buffer[TIME_WINDOW_SIZE / 2 - 1];
         OUTPUT_I(median, result_i.v[axis]);
         LOG("\n");
     }
@@ -288,10 +302,253 @@ void feature_sort_iqr(int axis)
         }
         qsort(buffer, TIME_WINDOW_SIZE, 1, cmp);
 
-        int iqr = buffer[3 * TIME_WINDOW_SIZE / 4] - buffer[TIME_WINDOW_SIZE / 4];
+        int iqr = buffer[3 * TIME_WINDOW_SIZE / 4 - 1] - buffer[TIME_WINDOW_SIZE / 4 - 1];
         OUTPUT_I(iqr, result_i.v[axis]);
         LOG("\n");
     }
 }
 
 // -----------------------------------------------------------
+
+//
+// Selection of all quantiles (min, q25, median, q75, max) at once.
+//
+// The histogram-based selection needs to clear and scan 256 bins per window.
+// For small windows that costs more than the window itself, so there
+// the window is sorted by computing the rank of each sample instead:
+//
+//   rank[i] = #{j : x[j] < x[i]} + #{j < i : x[j] == x[i]}
+//
+// The ranks form a permutation, so `sorted[rank[i]] = x[i]` sorts the window.
+// This is O(W^2) comparisons, but with no data-dependent branches:
+// the ranks of 16 or 32 samples are computed in parallel in SIMD lanes.
+//
+// The quantiles are selected in the same way as `feature_select_nth()` does,
+// i.e. the nth smallest value (counting from 1) for nth = W/4, W/2 and 3W/4.
+//
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define QUANTILES_LANES 32
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define QUANTILES_LANES 16
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#define QUANTILES_LANES 16
+#else
+#define QUANTILES_LANES 1
+#endif
+
+// the SIMD versions compare the sample indices as signed int8 values
+#if TIME_WINDOW_SIZE % QUANTILES_LANES != 0 || TIME_WINDOW_SIZE > 128
+#undef QUANTILES_LANES
+#define QUANTILES_LANES 1
+#endif
+
+//
+// Use the rank-based selection for windows up to this size.
+// On x86 the rank selection is faster than the histogram up to
+// 32 samples with SSE2 and up to 64 samples with AVX2.
+//
+#ifndef QUANTILES_RANK_MAX_WINDOW
+#define QUANTILES_RANK_MAX_WINDOW (QUANTILES_LANES > 1 ? 2 * QUANTILES_LANES : 16)
+#endif
+
+// the ranks are counted in bytes, like in the SIMD lanes, when they fit
+#if TIME_WINDOW_SIZE <= 256
+typedef uint8_t quantiles_rank_t;
+#else
+typedef uint16_t quantiles_rank_t;
+#endif
+
+typedef struct {
+    int min;
+    int q25;
+    int median;
+    int q75;
+    int max;
+} quantiles_t;
+
+static void quantiles_ranks(const int8_t x[], quantiles_rank_t rank[])
+{
+    int i, j;
+#if QUANTILES_LANES == 32
+    const __m256i lane_index = _mm256_setr_epi8(
+        0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15,
+        16, 17, 18, 19, 20, 21, 22, 23, 24, 25, 26, 27, 28, 29, 30, 31);
+    for (i = 0; i < TIME_WINDOW_SIZE; i += 32) {
+        __m256i xi = _mm256_loadu_si256((const __m256i *)&x[i]);
+        __m256i index = _mm256_add_epi8(lane_index, _mm256_set1_epi8(i));
+        __m256i acc = _mm256_setzero_si256();
+        for (j = 0; j < TIME_WINDOW_SIZE; ++j) {
+            __m256i xj = _mm256_set1_epi8(x[j]);
+            __m256i less = _mm256_cmpgt_epi8(xi, xj);
+            __m256i tie = _mm256_and_si256(_mm256_cmpeq_epi8(xi, xj),
+                                           _mm256_cmpgt_epi8(index, _mm256_set1_epi8(j)));
+            // the masks are -1 where true
+            acc = _mm256_sub_epi8(acc, _mm256_or_si256(less, tie));
+        }
+        _mm256_storeu_si256((__m256i *)&rank[i], acc);
+    }
+#elif QUANTILES_LANES == 16 && defined(__SSE2__)
+    const __m128i lane_index = _mm_setr_epi8(
+        0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+    for (i = 0; i < TIME_WINDOW_SIZE; i += 16) {
+        __m128i xi = _mm_loadu_si128((const __m128i *)&x[i]);
+        __m128i index = _mm_add_epi8(lane_index, _mm_set1_epi8(i));
+        __m128i acc = _mm_setzero_si128();
+        for (j = 0; j < TIME_WINDOW_SIZE; ++j) {
+            __m128i xj = _mm_set1_epi8(x[j]);
+            __m128i less = _mm_cmpgt_epi8(xi, xj);
+            __m128i tie = _mm_and_si128(_mm_cmpeq_epi8(xi, xj),
+                                        _mm_cmpgt_epi8(index, _mm_set1_epi8(j)));
+            // the masks are -1 where true
+            acc = _mm_sub_epi8(acc, _mm_or_si128(less, tie));
+        }
+        _mm_storeu_si128((__m128i *)&rank[i], acc);
+    }
+#elif QUANTILES_LANES == 16
+    static const uint8_t lane_index_values[16] = {
+        0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15};
+    const uint8x16_t lane_index = vld1q_u8(lane_index_values);
+    for (i = 0; i < TIME_WINDOW_SIZE; i += 16) {
+        int8x16_t xi = vld1q_s8(&x[i]);
+        uint8x16_t index = vaddq_u8(lane_index, vdupq_n_u8(i));
+        uint8x16_t acc = vdupq_n_u8(0);
+        for (j = 0; j < TIME_WINDOW_SIZE; ++j) {
+            int8x16_t xj = vdupq_n_s8(x[j]);
+            uint8x16_t less = vcgtq_s8(xi, xj);
+            uint8x16_t tie = vandq_u8(vceqq_s8(xi, xj), vcgtq_u8(index, vdupq_n_u8(j)));
+            // the masks are 0xff where true
+            acc = vsubq_u8(acc, vorrq_u8(less, tie));
+        }
+        vst1q_u8(&rank[i], acc);
+    }
+#else
+    for (i = 0; i < TIME_WINDOW_SIZE; ++i) {
+        int xi = x[i];
+        quantiles_rank_t r = 0;
+        for (j = 0; j < TIME_WINDOW_SIZE; ++j) {
+            r += (x[j] < xi) | ((x[j] == xi) & (j < i));
+        }
+        rank[i] = r;
+    }
+#endif
+}
+
+void quantiles_select_rank(const int8_t x[], quantiles_t *q)
+{
+    int i;
+    quantiles_rank_t rank[TIME_WINDOW_SIZE];
+    int8_t sorted[TIME_WINDOW_SIZE];
+
+    quantiles_ranks(x, rank);
+    for (i = 0; i < TIME_WINDOW_SIZE; ++i) {
+        sorted[rank[i]] = x[i];
+    }
+
+    q->min = sorted[0];
+    q->q25 = sorted[TIME_WINDOW_SIZE / 4 - 1];
+    q->median = sorted[TIME_WINDOW_SIZE / 2 - 1];
+    q->q75 = sorted[TIME_WINDOW_SIZE * 3 / 4 - 1];
+    q->max = sorted[TIME_WINDOW_SIZE - 1];
+}
+
+void quantiles_select_histogram(const int8_t x[], quantiles_t *q)
+{
+    int j, c;
+    histogram_bin_t stats[256] = {0};
+
+    for (j = 0; j < TIME_WINDOW_SIZE; ++j) {
+        stats[x[j] + 128]++;
+    }
+
+    // walk through the bins while all quantiles are found
+    for (j = 0; !stats[j]; ++j);
+    q->min = j - 128;
+    for (c = 0; c + stats[j] < TIME_WINDOW_SIZE / 4; ++j) {
+        c += stats[j];
+    }
+    q->q25 = j - 128;
+    for (; c + stats[j] < TIME_WINDOW_SIZE / 2; ++j) {
+        c += stats[j];
+    }
+    q->median = j - 128;
+    for (; c + stats[j] < TIME_WINDOW_SIZE * 3 / 4; ++j) {
+        c += stats[j];
+    }
+    q->q75 = j - 128;
+    for (j = 255; !stats[j]; --j);
+    q->max = j - 128;
+}
+
+static inline void quantiles_select(const int8_t x[], quantiles_t *q)
+{
+#if TIME_WINDOW_SIZE <= QUANTILES_RANK_MAX_WINDOW
+    quantiles_select_rank(x, q);
+#else
+    quantiles_select_histogram(x, q);
+#endif
+}
+
+// -----------------------------------------------------------
+
+static inline void quantiles_load(int8_t x[], const accel_t *window, int axis)
+{
+    int j;
+    for (j = 0; j < TIME_WINDOW_SIZE; ++j) {
+        x[j] = window[j].v[axis];
+    }
+}
+
+static inline void quantiles_output(const quantiles_t *q, int axis)
+{
+    OUTPUT_I(q->median, result_i.v[axis]);
+    OUTPUT_I(q->q25, result_i.v[axis]);
+    OUTPUT_I(q->q75, result_i.v[axis]);
+    OUTPUT_I(q->min, result_i.v[axis]);
+    OUTPUT_I(q->max, result_i.v[axis]);
+    LOG("\n");
+}
+
+void feature_quantiles(int axis)
+{
+    int i;
+    int8_t x[TIME_WINDOW_SIZE];
+    quantiles_t q;
+    LOG("axis=%d\n", axis);
+    for (i = 0; i < NSAMPLES - TIME_WINDOW_SIZE; i += PERIODIC_COMPUTATION_WINDOW_SIZE) {
+        quantiles_load(x, &data[i], axis);
+        quantiles_select(x, &q);
+        quantiles_output(&q, axis);
+    }
+}
+
+void feature_quantiles_rank(int axis)
+{
+    int i;
+    int8_t x[TIME_WINDOW_SIZE];
+    quantiles_t q;
+    LOG("axis=%d\n", axis);
+    for (i = 0; i < NSAMPLES - TIME_WINDOW_SIZE; i += PERIODIC_COMPUTATION_WINDOW_SIZE) {
+        quantiles_load(x, &data[i], axis);
+        quantiles_select_rank(x, &q);
+        quantiles_output(&q, axis);
+    }
+}
+
+void feature_quantiles_histogram(int axis)
+{
+    int i;
+    int8_t x[TIME_WINDOW_SIZE];
+    quantiles_t q;
+    LOG("axis=%d\n", axis);
+    for (i = 0; i < NSAMPLES - TIME_WINDOW_SIZE; i += PERIODIC_COMPUTATION_WINDOW_SIZE) {
+        quantiles_load(x, &data[i], axis);
+        quantiles_select_histogram(x, &q);
+        quantiles_output(&q, axis);
+    }
+}
+
+// -----------------------------------------------------------
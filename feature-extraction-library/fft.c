@@ -35,65 +35,30 @@
 
 #include "bitreverse.h"
 
-#if FREQUENCY_WINDOW_SIZE == 256
-#define FFT_NUM_BITS 8
-#elif FREQUENCY_WINDOW_SIZE == 128
-#define FFT_NUM_BITS 7
-#elif FREQUENCY_WINDOW_SIZE == 64
-#define FFT_NUM_BITS 6
-#elif FREQUENCY_WINDOW_SIZE == 32
-#define FFT_NUM_BITS 5
-#else
-#error Define FFT_NUM_BITS for your FFT window size!
-#endif
-
-
-#define FFT_TABLE_SIZE 256
-#if FREQUENCY_WINDOW_SIZE > FFT_TABLE_SIZE
-#error Only FFT up to 256 elements supported!
-#endif
-
-#define FFT_TABLE_BITS 8 // equal to log2(FFT_TABLE_SIZE)
-
 //
-// Lookup table of sine values from 0 to `pi`.
-// Note: using symmetry, could optimize this to 1/2 times the size
+// Lookup table of sine values from 0 to `pi`, generated for FREQUENCY_WINDOW_SIZE (see tables.h).
+// With FFT_QUARTER_WAVE_TABLE, only the values from 0 to `pi/2` are stored,
+// and the rest are obtained from the symmetry of the sine wave.
 //
-const float sin_table[FFT_TABLE_SIZE] =
+#if FFT_QUARTER_WAVE_TABLE
+
+static inline float tsin(int i)
 {
-    0.000000, 0.012272, 0.024541, 0.036807, 0.049068, 0.061321, 0.073565, 0.085797,
-    0.098017, 0.110222, 0.122411, 0.134581, 0.146730, 0.158858, 0.170962, 0.183040,
-    0.195090, 0.207111, 0.219101, 0.231058, 0.242980, 0.254866, 0.266713, 0.278520,
-    0.290285, 0.302006, 0.313682, 0.325310, 0.336890, 0.348419, 0.359895, 0.371317,
-    0.382683, 0.393992, 0.405241, 0.416430, 0.427555, 0.438616, 0.449611, 0.460539,
-    0.471397, 0.482184, 0.492898, 0.503538, 0.514103, 0.524590, 0.534998, 0.545325,
-    0.555570, 0.565732, 0.575808, 0.585798, 0.595699, 0.605511, 0.615232, 0.624860,
-    0.634393, 0.643832, 0.653173, 0.662416, 0.671559, 0.680601, 0.689541, 0.698376,
-    0.707107, 0.715731, 0.724247, 0.732654, 0.740951, 0.749136, 0.757209, 0.765167,
-    0.773010, 0.780737, 0.788346, 0.795837, 0.803208, 0.810457, 0.817585, 0.824589,
-    0.831470, 0.838225, 0.844854, 0.851355, 0.857729, 0.863973, 0.870087, 0.876070,
-    0.881921, 0.887640, 0.893224, 0.898674, 0.903989, 0.909168, 0.914210, 0.919114,
-    0.923880, 0.928506, 0.932993, 0.937339, 0.941544, 0.945607, 0.949528, 0.953306,
-    0.956940, 0.960431, 0.963776, 0.966976, 0.970031, 0.972940, 0.975702, 0.978317,
-    0.980785, 0.983105, 0.985278, 0.987301, 0.989177, 0.990903, 0.992480, 0.993907,
-    0.995185, 0.996313, 0.997290, 0.998118, 0.998795, 0.999322, 0.999699, 0.999925,
-    1.000000, 0.999925, 0.999699, 0.999322, 0.998795, 0.998118, 0.997290, 0.996313,
-    0.995185, 0.993907, 0.992480, 0.990903, 0.989177, 0.987301, 0.985278, 0.983105,
-    0.980785, 0.978317, 0.975702, 0.972940, 0.970031, 0.966976, 0.963776, 0.960431,
-    0.956940, 0.953306, 0.949528, 0.945607, 0.941544, 0.937339, 0.932993, 0.928506,
-    0.923880, 0.919114, 0.914210, 0.909168, 0.903989, 0.898674, 0.893224, 0.887640,
-    0.881921, 0.876070, 0.870087, 0.863973, 0.857729, 0.851355, 0.844854, 0.838225,
-    0.831470, 0.824589, 0.817585, 0.810457, 0.803208, 0.795837, 0.788346, 0.780737,
-    0.773010, 0.765167, 0.757209, 0.749136, 0.740951, 0.732654, 0.724247, 0.715731,
-    0.707107, 0.698376, 0.689541, 0.680601, 0.671559, 0.662416, 0.653173, 0.643832,
-    0.634393, 0.624859, 0.615232, 0.605511, 0.595699, 0.585798, 0.575808, 0.565732,
-    0.555570, 0.545325, 0.534998, 0.524590, 0.514103, 0.503538, 0.492898, 0.482184,
-    0.471397, 0.460539, 0.449611, 0.438616, 0.427555, 0.416429, 0.405241, 0.393992,
-    0.382683, 0.371317, 0.359895, 0.348419, 0.336890, 0.325310, 0.313682, 0.302006,
-    0.290285, 0.278520, 0.266713, 0.254866, 0.242980, 0.231058, 0.219101, 0.207111,
-    0.195090, 0.183040, 0.170962, 0.158858, 0.146731, 0.134581, 0.122411, 0.110222,
-    0.098017, 0.085797, 0.073564, 0.061321, 0.049068, 0.036807, 0.024541, 0.012271,
-};
+    if (i > FFT_TABLE_SIZE / 2) {
+        return sin_table[FFT_TABLE_SIZE - i];
+    }
+    return sin_table[i];
+}
+
+static inline float tcos(int i)
+{
+    if (i > FFT_TABLE_SIZE / 2) {
+        return -sin_table[i - FFT_TABLE_SIZE / 2];
+    }
+    return sin_table[FFT_TABLE_SIZE / 2 - i];
+}
+
+#else // FFT_QUARTER_WAVE_TABLE
 
 static inline float tsin(int i)
 {
@@ -108,6 +73,8 @@ static inline float tcos(int i)
     return sin_table[i + FFT_TABLE_SIZE / 2];
 }
 
+#endif // FFT_QUARTER_WAVE_TABLE
+
 //
 // Recursive FFT implementation: the recursive subroutine
 //
@@ -124,8 +91,8 @@ void fft_recursive(float xre[], float xim[], float yre[], float yim[], int step)
         float ure, uim;
         float vre, vim;
 
-        tre = tcos(i * (FFT_TABLE_SIZE / FREQUENCY_WINDOW_SIZE));
-        tim = -tsin(i * (FFT_TABLE_SIZE / FREQUENCY_WINDOW_SIZE));
+        tre = tcos(i * FFT_TABLE_SIZE / FREQUENCY_WINDOW_SIZE);
+        tim = -tsin(i * FFT_TABLE_SIZE / FREQUENCY_WINDOW_SIZE);
 
         ure = yre[i + step];
         uim = yim[i + step];
@@ -217,3 +184,85 @@ void fft(float xre[], float xim[], int n)
         }
     }
 }
+
+//
+// Inverse FFT, with the 1/n normalization, so `ifft()` after `fft()` gives back the input.
+// Swapping the real and imaginary parts conjugates the input and the output
+// up to a factor of i, so it is the forward FFT with the arrays swapped.
+// assumes n == FREQUENCY_WINDOW_SIZE
+//
+void ifft(float xre[], float xim[], int n)
+{
+    int i;
+    const float scale = 1.0f / FREQUENCY_WINDOW_SIZE;
+
+    fft(xim, xre, n);
+    for (i = 0; i < FREQUENCY_WINDOW_SIZE; i++) {
+        xre[i] *= scale;
+        xim[i] *= scale;
+    }
+}
+
+//
+// A butterfly of `fft()` for WINDOW_LANES windows at once
+//
+static inline void fft_lanes_butterfly(float *restrict are, float *restrict aim,
+                                       float *restrict bre, float *restrict bim,
+                                       float wre, float wim)
+{
+    int l;
+    for (l = 0; l < WINDOW_LANES; ++l) {
+        float tre = wre * bre[l] - wim * bim[l];
+        float tim = wre * bim[l] + wim * bre[l];
+        float ure = are[l];
+        float uim = aim[l];
+
+        are[l] = ure + tre;
+        aim[l] = uim + tim;
+
+        bre[l] = ure - tre;
+        bim[l] = uim - tim;
+    }
+}
+
+//
+// The same FFT for WINDOW_LANES windows at once, with the element `i`
+// of the window `l` at `[i][l]`. Each window gets exactly the same operations
+// as in `fft()`, so the results are the same; the loops over the windows are vectorized.
+//
+void fft_lanes(float xre[][WINDOW_LANES], float xim[][WINDOW_LANES])
+{
+    int i, l, shift;
+
+    for (i = 0; i < FREQUENCY_WINDOW_SIZE; i++) {
+        uint16_t irev = bitrev(i);
+
+        if(i < irev) {
+            for (l = 0; l < WINDOW_LANES; ++l) {
+                float t;
+
+                t = xre[i][l];
+                xre[i][l] = xre[irev][l];
+                xre[irev][l] = t;
+
+                t = xim[i][l];
+                xim[i][l] = xim[irev][l];
+                xim[irev][l] = t;
+            }
+        }
+    }
+
+    for (shift = 0; (1 << shift) <= FREQUENCY_WINDOW_SIZE / 2; shift++) {
+        int step = 1 << shift;
+        int table_shift = FFT_TABLE_BITS - shift;
+        int offset;
+
+        for (offset = 0; offset < FREQUENCY_WINDOW_SIZE; offset += 2 * step) {
+            for (i = 0; i < step; i++) {
+                int index = i + offset;
+                fft_lanes_butterfly(xre[index], xim[index], xre[index + step], xim[index + step],
+                                    tcos(i << table_shift), -tsin(i << table_shift));
+            }
+        }
+    }
+}
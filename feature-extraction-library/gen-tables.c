@@ -0,0 +1,97 @@
+/*
+ * Copyright (c) 2019, Institute of Electronics and Computer Science (EDI)
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * Author: Atis Elsts
+ */
+
+/*
+ * File: gen-tables.c
+ * Host tool that prints `tables-generated.h` for the configured window sizes.
+ * It must be compiled with the same TIME_WINDOW_SIZE, FREQUENCY_WINDOW_SIZE
+ * and FFT_QUARTER_WAVE_TABLE options as the application (see the Makefile).
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+
+#define TABLES_GENERATOR 1
+#include "tables.h"
+
+// -----------------------------------------------------------
+
+int main(void)
+{
+    int i;
+
+    printf("/*\n");
+    printf(" * File: tables-generated.h\n");
+    printf(" * Generated by gen-tables for TIME_WINDOW_SIZE=%d, FREQUENCY_WINDOW_SIZE=%d.\n",
+           TIME_WINDOW_SIZE, FREQUENCY_WINDOW_SIZE);
+    printf(" * Do not edit: use `make tables` to regenerate.\n");
+    printf(" */\n\n");
+
+    printf("#ifndef TABLES_GENERATED_H\n");
+    printf("#define TABLES_GENERATED_H\n\n");
+
+    printf("#define TABLES_GENERATED_TIME_WINDOW_SIZE %d\n", TIME_WINDOW_SIZE);
+    printf("#define TABLES_GENERATED_FREQUENCY_WINDOW_SIZE %d\n", FREQUENCY_WINDOW_SIZE);
+    printf("#define TABLES_GENERATED_QUARTER_WAVE %d\n\n", FFT_QUARTER_WAVE_TABLE);
+
+    // -p * log2(p) for all possible numbers of occurrences in a window
+    printf("static const float entropy_lookup_table[%d] = {\n", ENTROPY_TABLE_LEN);
+    for (i = 0; i < ENTROPY_TABLE_LEN; ++i) {
+        printf("    %.9g,\n", table_entropy_value(i));
+    }
+    printf("};\n\n");
+
+    printf("static const float sin_table[%d] = {\n", SIN_TABLE_LEN);
+    for (i = 0; i < SIN_TABLE_LEN; ++i) {
+        printf("    %.9g,\n", table_sin_value(i));
+    }
+    printf("};\n\n");
+
+    printf("static const bitrev_table_t bitrev_table[%d] = {\n", FREQUENCY_WINDOW_SIZE);
+    for (i = 0; i < FREQUENCY_WINDOW_SIZE; ++i) {
+        printf("%s%4d,%s", i % 16 ? "" : "   ",
+               table_bitrev_value(i, FREQUENCY_WINDOW_BITS),
+               i % 16 == 15 ? "\n" : "");
+    }
+    printf("%s};\n\n", FREQUENCY_WINDOW_SIZE % 16 ? "\n" : "");
+
+    // log2(1 + i / LOG2_TABLE_SIZE) in Q16
+    printf("static const uint32_t log2_lookup_table[%d] = {\n", LOG2_TABLE_LEN);
+    for (i = 0; i < LOG2_TABLE_LEN; ++i) {
+        printf("%s%6u,%s", i % 8 ? "" : "   ", table_log2_value(i), i % 8 == 7 ? "\n" : "");
+    }
+    printf("%s};\n\n", LOG2_TABLE_LEN % 8 ? "\n" : "");
+
+    printf("#endif // TABLES_GENERATED_H\n");
+
+    return 0;
+}
+
+// -----------------------------------------------------------
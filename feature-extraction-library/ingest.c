@@ -0,0 +1,469 @@
+/*
+ * Copyright (c) 2019, Institute of Electronics and Computer Science (EDI)
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * Author: Atis Elsts
+ */
+
+/*
+ * File: ingest.c
+ * Extract the features of recordings in files, with the stages on separate threads:
+ *
+ *   decode -> transform -> extract -> write
+ *
+ * The decoder parses the files (in the text format of sample-data,
+ * three integers per sample) into blocks of INGEST_BLOCK_SAMPLES samples.
+ * The transform stage applies the 3-sample median filter to each axis,
+ * in place. The extraction stage computes the rows of the features with
+ * the library (feature-extraction.h), and the writer prints them.
+ *
+ * The stages are connected with SPSC queues (spsc-queue.h) of blocks that are
+ * allocated at the start; the sample blocks go back from the extraction
+ * to the decoder, and the row blocks from the writer to the extraction.
+ * A block with `file == -1` ends the stream.
+ *
+ * Usage: ingest-test [-s] file...
+ * With `-s`, the same stages are run one after another in a single thread;
+ * the output is the same.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "adaptation.h"
+#include "feature-extraction.h"
+#include "spsc-queue.h"
+#include "output-format.h"
+
+// -----------------------------------------------------------
+
+#ifndef INGEST_BLOCK_SAMPLES
+#define INGEST_BLOCK_SAMPLES 1024
+#endif
+
+// The number of blocks in flight between each pair of stages
+#ifndef INGEST_NUM_BLOCKS
+#define INGEST_NUM_BLOCKS 8
+#endif
+
+#if INGEST_NUM_BLOCKS > SPSC_QUEUE_SIZE
+#error INGEST_NUM_BLOCKS must not be larger than SPSC_QUEUE_SIZE
+#endif
+
+#define INGEST_READ_SIZE (64 * 1024)
+
+#define NUM_AXIS 3
+
+// The features computed for each axis
+static const features_kind_t ingest_kinds[] = {
+    FEATURES_MEAN,
+    FEATURES_STD,
+    FEATURES_MIN,
+    FEATURES_MAX,
+    FEATURES_MEDIAN,
+    FEATURES_IQR,
+    FEATURES_ENTROPY,
+    FEATURES_CORRELATION,
+    FEATURES_SPECTRAL_ENTROPY,
+    FEATURES_SPECTRAL_MAXIMUM,
+};
+
+#define INGEST_NUM_KINDS (sizeof(ingest_kinds) / sizeof(*ingest_kinds))
+
+typedef struct {
+    int file;
+    int n;
+    // the last block of the file
+    bool last;
+    features_sample_t samples[INGEST_BLOCK_SAMPLES];
+} ingest_samples_t;
+
+typedef struct {
+    int file;
+    int num_rows;
+    bool last;
+    float *rows;
+} ingest_rows_t;
+
+// -----------------------------------------------------------
+// Decode
+
+typedef struct {
+    char *const *filenames;
+    int num_files;
+    int file;
+    FILE *f;
+    char buffer[INGEST_READ_SIZE];
+    size_t pos;
+    size_t len;
+    // the number being parsed, and the values of the current sample
+    bool in_number;
+    bool negative;
+    int value;
+    int num_values;
+    int values[NUM_AXIS];
+    bool failed;
+} ingest_decoder_t;
+
+static void ingest_decoder_init(ingest_decoder_t *d, char *const filenames[], int num_files)
+{
+    memset(d, 0, sizeof(*d));
+    d->filenames = filenames;
+    d->num_files = num_files;
+    d->file = -1;
+}
+
+static inline int8_t ingest_clamp(int v)
+{
+    return v < INT8_MIN ? INT8_MIN : v > INT8_MAX ? INT8_MAX : v;
+}
+
+// Returns false at the end of the file
+static bool ingest_decoder_fill(ingest_decoder_t *d)
+{
+    if (d->pos < d->len) {
+        return true;
+    }
+    d->pos = 0;
+    d->len = d->f ? fread(d->buffer, 1, sizeof(d->buffer), d->f) : 0;
+    return d->len > 0;
+}
+
+// Decode the next block; returns false when all files are done
+static bool ingest_decode(ingest_decoder_t *d, ingest_samples_t *b)
+{
+    if (d->f == NULL) {
+        if (++d->file >= d->num_files) {
+            return false;
+        }
+        d->f = fopen(d->filenames[d->file], "r");
+        if (d->f == NULL) {
+            perror(d->filenames[d->file]);
+            d->failed = true;
+        }
+        d->pos = d->len = 0;
+        d->in_number = false;
+        d->num_values = 0;
+    }
+
+    b->file = d->file;
+    b->n = 0;
+    b->last = false;
+
+    while (b->n < INGEST_BLOCK_SAMPLES) {
+        bool more = ingest_decoder_fill(d);
+        char c = more ? d->buffer[d->pos++] : ' ';
+
+        if (c >= '0' && c <= '9') {
+            d->value = d->in_number ? d->value * 10 + (c - '0') : c - '0';
+            if (d->value > 1000) {
+                d->value = 1000;
+            }
+            d->in_number = true;
+            continue;
+        }
+        if (d->in_number) {
+            d->values[d->num_values++] = d->negative ? -d->value : d->value;
+            d->in_number = false;
+            if (d->num_values == NUM_AXIS) {
+                int a;
+                for (a = 0; a < NUM_AXIS; ++a) {
+                    b->samples[b->n].v[a] = ingest_clamp(d->values[a]);
+                }
+                b->n++;
+                d->num_values = 0;
+            }
+        }
+        d->negative = c == '-';
+
+        if (!more) {
+            if (d->f) {
+                fclose(d->f);
+                d->f = NULL;
+            }
+            b->last = true;
+            break;
+        }
+    }
+    return true;
+}
+
+// -----------------------------------------------------------
+// Transform: the 3-sample median filter, as `filter_median` without the edges
+
+typedef struct {
+    int primed;
+    features_sample_t prev[2];
+} ingest_filter_t;
+
+static inline int ingest_median3(int a, int b, int c)
+{
+    return max(min(a, b), min(max(a, b), c));
+}
+
+static void ingest_transform(ingest_filter_t *f, ingest_samples_t *b)
+{
+    int i, a, n = 0;
+
+    for (i = 0; i < b->n; ++i) {
+        features_sample_t x = b->samples[i];
+        if (f->primed == 2) {
+            for (a = 0; a < NUM_AXIS; ++a) {
+                b->samples[n].v[a] = ingest_median3(f->prev[0].v[a], f->prev[1].v[a], x.v[a]);
+            }
+            n++;
+        } else {
+            f->primed++;
+        }
+        f->prev[0] = f->prev[1];
+        f->prev[1] = x;
+    }
+    b->n = n;
+
+    if (b->last) {
+        f->primed = 0;
+    }
+}
+
+// -----------------------------------------------------------
+// Extract
+
+static features_context_t *ingest_context_create(void)
+{
+    features_context_t *ctx = features_create();
+    int axis, k;
+    if (ctx) {
+        for (axis = 0; axis < NUM_AXIS; ++axis) {
+            for (k = 0; k < INGEST_NUM_KINDS; ++k) {
+                features_plan_add(ctx, ingest_kinds[k], axis);
+            }
+        }
+    }
+    return ctx;
+}
+
+static void ingest_extract(features_context_t *ctx, const ingest_samples_t *b, ingest_rows_t *r)
+{
+    r->file = b->file;
+    r->last = b->last;
+    r->num_rows = features_process_stream(ctx, b->samples, b->n, r->rows,
+                                          features_max_windows(INGEST_BLOCK_SAMPLES));
+    if (b->last) {
+        features_reset(ctx);
+    }
+}
+
+// -----------------------------------------------------------
+// Write
+
+typedef struct {
+    char *const *filenames;
+    int width;
+    int row;
+} ingest_writer_t;
+
+static void ingest_write(ingest_writer_t *w, const ingest_rows_t *r)
+{
+    int i, k;
+    for (i = 0; i < r->num_rows; ++i) {
+        output_format_log("%s %d ", w->filenames[r->file], w->row++);
+        for (k = 0; k < w->width; ++k) {
+            output_format_f(r->rows[i * w->width + k]);
+        }
+        output_format_log("\n");
+    }
+    if (r->last) {
+        w->row = 0;
+    }
+}
+
+// -----------------------------------------------------------
+// The threads
+
+typedef struct {
+    ingest_decoder_t decoder;
+    ingest_filter_t filter;
+    features_context_t *ctx;
+    ingest_writer_t writer;
+
+    ingest_samples_t samples[INGEST_NUM_BLOCKS];
+    ingest_rows_t rows[INGEST_NUM_BLOCKS];
+
+    // decode -> transform -> extract, and back to decode
+    spsc_queue_t decoded;
+    spsc_queue_t transformed;
+    spsc_queue_t free_samples;
+    // extract -> write, and back
+    spsc_queue_t extracted;
+    spsc_queue_t free_rows;
+} ingest_t;
+
+static void *ingest_decode_thread(void *arg)
+{
+    ingest_t *in = arg;
+    for (;;) {
+        ingest_samples_t *b = spsc_queue_get(&in->free_samples);
+        if (!ingest_decode(&in->decoder, b)) {
+            b->file = -1;
+            spsc_queue_put(&in->decoded, b);
+            return NULL;
+        }
+        spsc_queue_put(&in->decoded, b);
+    }
+}
+
+static void *ingest_transform_thread(void *arg)
+{
+    ingest_t *in = arg;
+    for (;;) {
+        ingest_samples_t *b = spsc_queue_get(&in->decoded);
+        if (b->file >= 0) {
+            ingest_transform(&in->filter, b);
+        }
+        spsc_queue_put(&in->transformed, b);
+        if (b->file < 0) {
+            return NULL;
+        }
+    }
+}
+
+static void *ingest_extract_thread(void *arg)
+{
+    ingest_t *in = arg;
+    for (;;) {
+        ingest_samples_t *b = spsc_queue_get(&in->transformed);
+        ingest_rows_t *r = spsc_queue_get(&in->free_rows);
+        bool end = b->file < 0;
+        if (end) {
+            r->file = -1;
+        } else {
+            ingest_extract(in->ctx, b, r);
+        }
+        spsc_queue_put(&in->free_samples, b);
+        spsc_queue_put(&in->extracted, r);
+        if (end) {
+            return NULL;
+        }
+    }
+}
+
+static void ingest_run_threads(ingest_t *in)
+{
+    pthread_t decode, transform, extract;
+    int i;
+
+    spsc_queue_init(&in->decoded);
+    spsc_queue_init(&in->transformed);
+    spsc_queue_init(&in->free_samples);
+    spsc_queue_init(&in->extracted);
+    spsc_queue_init(&in->free_rows);
+    for (i = 0; i < INGEST_NUM_BLOCKS; ++i) {
+        spsc_queue_put(&in->free_samples, &in->samples[i]);
+        spsc_queue_put(&in->free_rows, &in->rows[i]);
+    }
+
+    pthread_create(&decode, NULL, ingest_decode_thread, in);
+    pthread_create(&transform, NULL, ingest_transform_thread, in);
+    pthread_create(&extract, NULL, ingest_extract_thread, in);
+
+    // this thread writes
+    for (;;) {
+        ingest_rows_t *r = spsc_queue_get(&in->extracted);
+        if (r->file < 0) {
+            break;
+        }
+        ingest_write(&in->writer, r);
+        spsc_queue_put(&in->free_rows, r);
+    }
+
+    pthread_join(decode, NULL);
+    pthread_join(transform, NULL);
+    pthread_join(extract, NULL);
+}
+
+static void ingest_run_serial(ingest_t *in)
+{
+    ingest_samples_t *b = &in->samples[0];
+    ingest_rows_t *r = &in->rows[0];
+
+    while (ingest_decode(&in->decoder, b)) {
+        ingest_transform(&in->filter, b);
+        ingest_extract(in->ctx, b, r);
+        ingest_write(&in->writer, r);
+    }
+}
+
+// -----------------------------------------------------------
+
+int main(int argc, char *argv[])
+{
+    static ingest_t in;
+    bool serial = false;
+    int row_size, i;
+
+    if (argc > 1 && strcmp(argv[1], "-s") == 0) {
+        serial = true;
+        argc--;
+        argv++;
+    }
+    if (argc < 2) {
+        fprintf(stderr, "usage: ingest-test [-s] file...\n");
+        return 2;
+    }
+
+    in.ctx = ingest_context_create();
+    if (!in.ctx) {
+        return 1;
+    }
+    ingest_decoder_init(&in.decoder, &argv[1], argc - 1);
+    in.writer.filenames = &argv[1];
+    in.writer.width = features_plan_width(in.ctx);
+
+    row_size = features_max_windows(INGEST_BLOCK_SAMPLES) * in.writer.width;
+    for (i = 0; i < INGEST_NUM_BLOCKS; ++i) {
+        in.rows[i].rows = malloc(row_size * sizeof(float));
+        if (!in.rows[i].rows) {
+            return 1;
+        }
+    }
+
+    if (serial) {
+        ingest_run_serial(&in);
+    } else {
+        ingest_run_threads(&in);
+    }
+    output_format_flush();
+
+    for (i = 0; i < INGEST_NUM_BLOCKS; ++i) {
+        free(in.rows[i].rows);
+    }
+    features_destroy(in.ctx);
+    return in.decoder.failed ? 1 : 0;
+}
@@ -0,0 +1,235 @@
+/*
+ * Copyright (c) 2019, Institute of Electronics and Computer Science (EDI)
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * Author: Atis Elsts
+ */
+
+/*
+ * File: libfeatures-cache.c
+ * A cache of the rows of recent windows, for the library.
+ *
+ * Resting devices produce long runs of the same readings, so the same windows
+ * recur. The cache is direct mapped, indexed by a hash of the samples of the window;
+ * a window hits only if its samples are the same as those of the entry,
+ * so the rows are exactly those that would have been computed.
+ * The windows that miss are computed together in a tile, and replace the entries.
+ */
+
+#include "libfeatures-internal.h"
+
+_Static_assert(sizeof(accel_t) * FEATURES_WINDOW_SIZE % sizeof(uint64_t) == 0,
+               "the windows are hashed in 64-bit words");
+
+struct features_cache {
+    // a power of two
+    unsigned num_entries;
+    int width;
+    // the hash of the window of each entry; zero if the entry is empty
+    uint64_t *hashes;
+    accel_t (*windows)[FEATURES_WINDOW_SIZE];
+    float *rows;
+    // the windows that missed, and their rows
+    accel_t tile[WINDOW_LANES][FEATURES_WINDOW_SIZE];
+    features_sums_t tile_sums[WINDOW_LANES];
+    float *tile_rows;
+};
+
+// -----------------------------------------------------------
+
+features_cache_t *features_cache_create(int num_entries, int width)
+{
+    features_cache_t *cache;
+    unsigned n = 1;
+
+    if (num_entries <= 0 || num_entries > FEATURES_CACHE_MAX_ENTRIES || width <= 0) {
+        return NULL;
+    }
+    while (n < (unsigned)num_entries) {
+        n <<= 1;
+    }
+
+    cache = calloc(1, sizeof(features_cache_t));
+    if (!cache) {
+        return NULL;
+    }
+    cache->num_entries = n;
+    cache->width = width;
+    cache->hashes = calloc(n, sizeof(uint64_t));
+    cache->windows = malloc(n * sizeof(*cache->windows));
+    cache->rows = malloc(n * width * sizeof(float));
+    cache->tile_rows = malloc(WINDOW_LANES * width * sizeof(float));
+    if (!cache->hashes || !cache->windows || !cache->rows || !cache->tile_rows) {
+        features_cache_destroy(cache);
+        return NULL;
+    }
+    return cache;
+}
+
+void features_cache_destroy(features_cache_t *cache)
+{
+    if (cache) {
+        free(cache->hashes);
+        free(cache->windows);
+        free(cache->rows);
+        free(cache->tile_rows);
+        free(cache);
+    }
+}
+
+int features_cache_width(const features_cache_t *cache)
+{
+    return cache->width;
+}
+
+// -----------------------------------------------------------
+
+// Never zero
+static inline uint64_t features_cache_hash(const accel_t *window)
+{
+    const uint8_t *p = (const uint8_t *)window;
+    uint64_t h = 0, x;
+    unsigned i;
+
+    for (i = 0; i < sizeof(accel_t) * FEATURES_WINDOW_SIZE; i += sizeof(x)) {
+        memcpy(&x, &p[i], sizeof(x));
+        h = (h ^ x) * 0x9e3779b97f4a7c15ull;
+        h ^= h >> 32;
+    }
+    return h | 1;
+}
+
+static inline unsigned features_cache_slot(const features_cache_t *cache, uint64_t hash)
+{
+    return (hash >> 16) & (cache->num_entries - 1);
+}
+
+// Copy the row of the window if it is in the cache
+static inline bool features_cache_lookup(const features_cache_t *cache, uint64_t hash,
+                                         const accel_t *window, float row[])
+{
+    unsigned slot = features_cache_slot(cache, hash);
+
+    if (cache->hashes[slot] != hash
+        || memcmp(cache->windows[slot], window, sizeof(cache->windows[slot])) != 0) {
+        return false;
+    }
+    memcpy(row, &cache->rows[slot * cache->width], cache->width * sizeof(float));
+    return true;
+}
+
+static inline void features_cache_insert(features_cache_t *cache, uint64_t hash,
+                                         const accel_t *window, const float row[])
+{
+    unsigned slot = features_cache_slot(cache, hash);
+
+    cache->hashes[slot] = hash;
+    memcpy(cache->windows[slot], window, sizeof(cache->windows[slot]));
+    memcpy(&cache->rows[slot * cache->width], row, cache->width * sizeof(float));
+}
+
+// -----------------------------------------------------------
+
+void features_window_cached(const features_context_t *ctx, features_cache_t *cache,
+                            const accel_t *window, const features_sums_t *sums, float row[])
+{
+    uint64_t hash;
+
+    if (!cache) {
+        features_window(ctx, window, sums, row);
+        return;
+    }
+    hash = features_cache_hash(window);
+    if (!features_cache_lookup(cache, hash, window, row)) {
+        features_window(ctx, window, sums, row);
+        features_cache_insert(cache, hash, window, row);
+    }
+}
+
+void features_tile_cached(const features_context_t *ctx, features_cache_t *cache,
+                          const accel_t *first, int stride, int n,
+                          const features_sums_t sums[], float rows[])
+{
+    uint64_t hashes[WINDOW_LANES];
+    // the windows that are computed, and for each of the rest, the window with the same samples
+    int misses[WINDOW_LANES];
+    int same[WINDOW_LANES];
+    int num_misses = 0;
+    int l, m;
+
+    if (!cache) {
+        features_tile(ctx, first, stride, n, sums, rows);
+        return;
+    }
+
+    for (l = 0; l < n; ++l) {
+        const accel_t *window = &first[l * stride];
+        hashes[l] = features_cache_hash(window);
+        same[l] = -1;
+        if (features_cache_lookup(cache, hashes[l], window, &rows[l * ctx->width])) {
+            continue;
+        }
+        // the same windows are usually next to each other, in the same tile
+        for (m = 0; m < num_misses; ++m) {
+            if (hashes[misses[m]] == hashes[l]
+                && memcmp(&first[misses[m] * stride], window, sizeof(cache->tile[0])) == 0) {
+                same[l] = misses[m];
+                break;
+            }
+        }
+        if (same[l] < 0) {
+            misses[num_misses++] = l;
+        }
+    }
+
+    if (num_misses == n) {
+        features_tile(ctx, first, stride, n, sums, rows);
+    } else if (num_misses > 0) {
+        // the windows that missed, side by side
+        for (m = 0; m < num_misses; ++m) {
+            memcpy(cache->tile[m], &first[misses[m] * stride], sizeof(cache->tile[m]));
+            if (sums) {
+                cache->tile_sums[m] = sums[misses[m]];
+            }
+        }
+        features_tile(ctx, cache->tile[0], FEATURES_WINDOW_SIZE, num_misses,
+                      sums ? cache->tile_sums : NULL, cache->tile_rows);
+        for (m = 0; m < num_misses; ++m) {
+            memcpy(&rows[misses[m] * ctx->width], &cache->tile_rows[m * ctx->width],
+                   ctx->width * sizeof(float));
+        }
+    }
+
+    for (m = 0; m < num_misses; ++m) {
+        l = misses[m];
+        features_cache_insert(cache, hashes[l], &first[l * stride], &rows[l * ctx->width]);
+    }
+    for (l = 0; l < n; ++l) {
+        if (same[l] >= 0) {
+            memcpy(&rows[l * ctx->width], &rows[same[l] * ctx->width], ctx->width * sizeof(float));
+        }
+    }
+}
@@ -0,0 +1,189 @@
+/*
+ * Copyright (c) 2019, Institute of Electronics and Computer Science (EDI)
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * Author: Atis Elsts
+ */
+
+/*
+ * File: libfeatures-internal.h
+ * Shared by the translation units of the feature extraction library.
+ */
+
+#ifndef LIBFEATURES_INTERNAL_H
+#define LIBFEATURES_INTERNAL_H
+
+#define FEATURES_LIBRARY 1
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <limits.h>
+#include <string.h>
+
+#include "adaptation.h"
+#include "main.h"
+#include "feature-extraction.h"
+
+// -----------------------------------------------------------
+
+// The maximal number of features in a plan
+#ifndef FEATURES_MAX_PLAN
+#define FEATURES_MAX_PLAN 64
+#endif
+
+// The windows are long enough for both the time and frequency domain features,
+// which use the first TIME_WINDOW_SIZE and FREQUENCY_WINDOW_SIZE samples
+#define FEATURES_WINDOW_SIZE \
+    (TIME_WINDOW_SIZE > FREQUENCY_WINDOW_SIZE ? TIME_WINDOW_SIZE : FREQUENCY_WINDOW_SIZE)
+
+#define FEATURES_HOP_SIZE PERIODIC_COMPUTATION_WINDOW_SIZE
+
+_Static_assert(sizeof(features_sample_t) == sizeof(accel_t), "features_sample_t must match accel_t");
+
+typedef struct {
+    uint8_t kind;
+    uint8_t axis;
+    uint16_t offset;
+} features_item_t;
+
+// The rows of recent windows, see libfeatures-cache.c
+typedef struct features_cache features_cache_t;
+
+// The largest number of entries of a cache
+#define FEATURES_CACHE_MAX_ENTRIES (1 << 16)
+
+struct features_context {
+    features_item_t plan[FEATURES_MAX_PLAN];
+    int plan_size;
+    int width;
+    // the start of the next window, for `features_process_stream()`
+    accel_t buffer[FEATURES_WINDOW_SIZE];
+    int buffered;
+    // for the timestamped samples
+    uint64_t max_gap;
+    uint64_t last_timestamp;
+    // the number of entries of the cache, which is created for the plan when first used
+    int cache_size;
+    features_cache_t *cache;
+    // the axes with skewness or kurtosis in the plan
+    unsigned powers_axes;
+    // the axes with spectral features in the plan
+    unsigned spectral_axes;
+};
+
+// The kinds are classified by a table, as their values do not follow the domains
+// (see features_kind_t)
+#define FEATURES_KIND_SPECTRAL 0x1 // a frequency domain feature
+#define FEATURES_KIND_POWER    0x2 // computed from the power spectrum
+
+typedef struct {
+    uint8_t width; // the number of values
+    uint8_t flags;
+} features_kind_info_t;
+
+extern const features_kind_info_t features_kinds[FEATURES_NUM_KINDS];
+
+static inline bool features_is_spectral(int kind)
+{
+    return features_kinds[kind].flags & FEATURES_KIND_SPECTRAL;
+}
+
+// Are the samples with these timestamps separated by a gap?
+static inline bool features_is_gap(const features_context_t *ctx, uint64_t previous, uint64_t timestamp)
+{
+    return timestamp < previous || (ctx->max_gap && timestamp - previous > ctx->max_gap);
+}
+
+// The number of samples from the start of `timestamps` before the first gap
+static inline int features_gap_free(const features_context_t *ctx,
+                                    const uint64_t timestamps[], int n)
+{
+    int i;
+    for (i = 1; i < n; ++i) {
+        if (features_is_gap(ctx, timestamps[i - 1], timestamps[i])) {
+            break;
+        }
+    }
+    return i;
+}
+
+// The sums of the values and of their powers up to the fourth, for each axis
+typedef struct {
+    window_sum_t sum[NUM_AXIS];
+    window_sqsum_t sqsum[NUM_AXIS];
+    int64_t cubesum[NUM_AXIS];
+    uint64_t quartsum[NUM_AXIS];
+} features_sums_t;
+
+// The minimum and maximum of the axes of the windows of a tile (or of a single window,
+// in the lane 0), from the time domain pass; `axes` has the bits of the axes that are known.
+// The spectral features take the axes with equal minimum and maximum as constant.
+typedef struct {
+    int minval[NUM_AXIS][WINDOW_LANES];
+    int maxval[NUM_AXIS][WINDOW_LANES];
+    unsigned axes;
+} features_ranges_t;
+
+// Build the tables of the spectral features; called when the first one is added to a plan
+void features_spectral_prepare(void);
+
+// Compute the features of the plan for one window into its row.
+// If the sums of the (time domain) window are known, they can be passed in `sums`.
+// The time domain pass fills `ranges`, which the spectral one takes; either can be NULL.
+void features_time_window(const features_context_t *ctx, const accel_t *window,
+                          const features_sums_t *sums, features_ranges_t *ranges, float row[]);
+void features_spectral_window(const features_context_t *ctx, const accel_t *window,
+                              const features_ranges_t *ranges, float row[]);
+// Both of the above
+void features_window(const features_context_t *ctx, const accel_t *window,
+                     const features_sums_t *sums, float row[]);
+
+// The same for a tile of `n` <= WINDOW_LANES windows, the window `l` starting
+// at `first[l * stride]`, with the cross-window kernels.
+// `sums` are either NULL or those of each window.
+void features_time_tile(const features_context_t *ctx, const accel_t *first, int stride, int n,
+                        const features_sums_t sums[], features_ranges_t *ranges, float rows[]);
+void features_spectral_tile(const features_context_t *ctx, const accel_t *first, int stride, int n,
+                            const features_ranges_t *ranges, float rows[]);
+void features_tile(const features_context_t *ctx, const accel_t *first, int stride, int n,
+                   const features_sums_t sums[], float rows[]);
+
+
+// Returns NULL if out of memory, or if there are too many entries
+features_cache_t *features_cache_create(int num_entries, int width);
+void features_cache_destroy(features_cache_t *cache);
+int features_cache_width(const features_cache_t *cache);
+
+// Same as `features_window()` and `features_tile()`, but the rows of the windows
+// that are in the cache are copied from it; `cache` can be NULL
+void features_window_cached(const features_context_t *ctx, features_cache_t *cache,
+                            const accel_t *window, const features_sums_t *sums, float row[]);
+void features_tile_cached(const features_context_t *ctx, features_cache_t *cache,
+                          const accel_t *first, int stride, int n,
+                          const features_sums_t sums[], float rows[]);
+
+#endif // LIBFEATURES_INTERNAL_H
@@ -0,0 +1,425 @@
+/*
+ * Copyright (c) 2019, Institute of Electronics and Computer Science (EDI)
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * Author: Atis Elsts
+ */
+
+/*
+ * File: libfeatures-spectral.c
+ * The frequency domain features of the library.
+ */
+
+#include "libfeatures-internal.h"
+#include "tables.h"
+
+// The FFT functions are not static; keep their names out of the way of the application
+#define fft_recursive features_fft_recursive
+#define fftr features_fftr
+#define fft features_fft
+#define ifft features_ifft
+#define fft_lanes features_fft_lanes
+#include "fft.c"
+
+#include "spectral.h"
+#include "window-features.h"
+
+#if FEATURES_SPECTRAL_PEAKS_COUNT != SPECTRAL_TOP_PEAKS
+#error FEATURES_SPECTRAL_PEAKS_COUNT must match SPECTRAL_TOP_PEAKS
+#endif
+
+// The smallest number of windows for which `fft_lanes()` is used
+#ifndef FEATURES_SPECTRAL_MIN_LANES
+#define FEATURES_SPECTRAL_MIN_LANES (WINDOW_LANES / 4)
+#endif
+
+#if WINDOW_LANES > 32
+#error The constant lanes of a tile must fit in 32 bits
+#endif
+
+// -----------------------------------------------------------
+
+// The spectral features of an axis that has the same value in the whole window,
+// e.g. of a device at rest, for each of the values
+typedef struct {
+    float entropy;
+    float maximum;
+    float histogram[NUM_FREQUENCY_HISTOGRAM_BINS];
+    float period;
+    float period_strength;
+    float centroid;
+    float spread;
+    float rolloff;
+    float flatness;
+    float dominant;
+    float band_ratio;
+    float maximum_bin;
+    float peaks[2 * SPECTRAL_TOP_PEAKS];
+} features_spectral_constant_t;
+
+static features_spectral_constant_t features_spectral_constants[256];
+
+// The table is built when the first spectral feature is added to a plan, by one thread;
+// any other one waits for it
+enum {
+    FEATURES_SPECTRAL_UNPREPARED,
+    FEATURES_SPECTRAL_PREPARING,
+    FEATURES_SPECTRAL_PREPARED,
+};
+static int features_spectral_state;
+
+// The maximal nonzero frequency and its bin, or zeros
+static void features_spectral_maximum(const float power[], float *maximum, float *bin)
+{
+    int last = spectral_last_above_f(power, SPECTRAL_MAXIMUM_EPSILON);
+    *maximum = last < 0 ? 0 : power[last];
+    *bin = last < 0 ? 0 : last;
+}
+
+// The bin and the power of each of the highest peaks
+static void features_spectral_peaks(const float power[], float out[2 * SPECTRAL_TOP_PEAKS])
+{
+    int bins[SPECTRAL_TOP_PEAKS];
+    float powers[SPECTRAL_TOP_PEAKS];
+    int i;
+
+    spectral_top_peaks_f(power, bins, powers);
+    for (i = 0; i < SPECTRAL_TOP_PEAKS; ++i) {
+        out[2 * i] = bins[i];
+        out[2 * i + 1] = powers[i];
+    }
+}
+
+// The dominant period of the autocorrelation, or zeros
+static void features_spectral_period(const float re[], const float im[],
+                                     float *period, float *strength)
+{
+    float r[FREQUENCY_WINDOW_SIZE];
+    int lag;
+
+    spectral_autocorrelation_f(re, im, r);
+    if (spectral_period_f(r, &lag, strength)) {
+        *period = lag;
+    } else {
+        *period = 0;
+        *strength = 0;
+    }
+}
+
+static void features_spectral_values(const float re[], const float im[],
+                                     features_spectral_constant_t *values)
+{
+    float power[SPECTRAL_NUM_BINS];
+
+    spectral_power_f(re, im, power);
+    values->entropy = spectral_entropy_f(re, im);
+    features_spectral_maximum(power, &values->maximum, &values->maximum_bin);
+    features_spectral_peaks(power, values->peaks);
+    spectral_histogram_power_f(power, values->histogram);
+    features_spectral_period(re, im, &values->period, &values->period_strength);
+    values->centroid = spectral_centroid_f(power);
+    values->spread = spectral_spread_f(power);
+    values->rolloff = spectral_rolloff_f(power);
+    values->flatness = spectral_flatness_f(power);
+    values->dominant = spectral_dominant_f(power);
+    values->band_ratio = spectral_band_ratio_f(power);
+}
+
+static void features_spectral_init(void)
+{
+    accel_t window[FREQUENCY_WINDOW_SIZE];
+    float re[FREQUENCY_WINDOW_SIZE];
+    float im[FREQUENCY_WINDOW_SIZE];
+    int value, i;
+
+    tables_init();
+    spectral_window_init();
+
+    // with the same code as the other windows, so the values are exactly the same
+    for (value = -128; value < 128; ++value) {
+        int32_t sum;
+        for (i = 0; i < FREQUENCY_WINDOW_SIZE; ++i) {
+            window[i].v[0] = value;
+        }
+        sum = spectral_load_f(re, window, 0);
+        memset(im, 0, sizeof(im));
+        fft(re, im, FREQUENCY_WINDOW_SIZE);
+        spectral_detrend_f(re, sum);
+        features_spectral_values(re, im, &features_spectral_constants[value + 128]);
+    }
+}
+
+void features_spectral_prepare(void)
+{
+    int state = FEATURES_SPECTRAL_UNPREPARED;
+
+    if (__atomic_load_n(&features_spectral_state, __ATOMIC_ACQUIRE) == FEATURES_SPECTRAL_PREPARED) {
+        return;
+    }
+    if (__atomic_compare_exchange_n(&features_spectral_state, &state, FEATURES_SPECTRAL_PREPARING,
+                                    false, __ATOMIC_ACQUIRE, __ATOMIC_ACQUIRE)) {
+        features_spectral_init();
+        __atomic_store_n(&features_spectral_state, FEATURES_SPECTRAL_PREPARED, __ATOMIC_RELEASE);
+        return;
+    }
+    while (__atomic_load_n(&features_spectral_state, __ATOMIC_ACQUIRE) != FEATURES_SPECTRAL_PREPARED) {
+    }
+}
+
+// -----------------------------------------------------------
+
+// The kinds computed from the power spectrum
+static bool features_spectral_uses_power(int kind)
+{
+    return features_kinds[kind].flags & FEATURES_KIND_POWER;
+}
+
+// Compute the spectral features of an axis from its FFT.
+// The power spectrum and the autocorrelation are computed once for all the features
+// that need them; then each feature is one pass over the power spectrum.
+static void features_spectral_axis(const features_context_t *ctx, int axis,
+                                   const float re[], const float im[], float row[])
+{
+    bool have_power = false, have_period = false;
+    float power[SPECTRAL_NUM_BINS];
+    float period, period_strength, unused;
+    int i;
+
+    for (i = 0; i < ctx->plan_size; ++i) {
+        const features_item_t *item = &ctx->plan[i];
+        float *out = &row[item->offset];
+
+        if (item->axis != axis) {
+            continue;
+        }
+        if (!have_power && features_spectral_uses_power(item->kind)) {
+            spectral_power_f(re, im, power);
+            have_power = true;
+        }
+
+        switch (item->kind) {
+        case FEATURES_SPECTRAL_ENTROPY:
+            *out = spectral_entropy_f(re, im);
+            break;
+        case FEATURES_SPECTRAL_MAXIMUM:
+            features_spectral_maximum(power, out, &unused);
+            break;
+        case FEATURES_SPECTRAL_MAXIMUM_BIN:
+            features_spectral_maximum(power, &unused, out);
+            break;
+        case FEATURES_SPECTRAL_PEAKS:
+            features_spectral_peaks(power, out);
+            break;
+        case FEATURES_SPECTRAL_HISTOGRAM:
+            spectral_histogram_power_f(power, out);
+            break;
+        case FEATURES_PERIOD:
+        case FEATURES_PERIOD_STRENGTH:
+            if (!have_period) {
+                features_spectral_period(re, im, &period, &period_strength);
+                have_period = true;
+            }
+            *out = item->kind == FEATURES_PERIOD ? period : period_strength;
+            break;
+        case FEATURES_SPECTRAL_CENTROID:
+            *out = spectral_centroid_f(power);
+            break;
+        case FEATURES_SPECTRAL_SPREAD:
+            *out = spectral_spread_f(power);
+            break;
+        case FEATURES_SPECTRAL_ROLLOFF:
+            *out = spectral_rolloff_f(power);
+            break;
+        case FEATURES_SPECTRAL_FLATNESS:
+            *out = spectral_flatness_f(power);
+            break;
+        case FEATURES_DOMINANT_FREQUENCY:
+            *out = spectral_dominant_f(power);
+            break;
+        case FEATURES_SPECTRAL_BAND_RATIO:
+            *out = spectral_band_ratio_f(power);
+            break;
+        }
+    }
+}
+
+// The same for an axis with a constant value, without the FFT
+static void features_spectral_axis_constant(const features_context_t *ctx, int axis,
+                                            int value, float row[])
+{
+    const features_spectral_constant_t *values = &features_spectral_constants[value + 128];
+    int i;
+
+    for (i = 0; i < ctx->plan_size; ++i) {
+        const features_item_t *item = &ctx->plan[i];
+        float *out = &row[item->offset];
+
+        if (item->axis != axis) {
+            continue;
+        }
+
+        switch (item->kind) {
+        case FEATURES_SPECTRAL_ENTROPY:
+            *out = values->entropy;
+            break;
+        case FEATURES_SPECTRAL_MAXIMUM:
+            *out = values->maximum;
+            break;
+        case FEATURES_SPECTRAL_HISTOGRAM:
+            memcpy(out, values->histogram, sizeof(values->histogram));
+            break;
+        case FEATURES_PERIOD:
+            *out = values->period;
+            break;
+        case FEATURES_PERIOD_STRENGTH:
+            *out = values->period_strength;
+            break;
+        case FEATURES_SPECTRAL_CENTROID:
+            *out = values->centroid;
+            break;
+        case FEATURES_SPECTRAL_SPREAD:
+            *out = values->spread;
+            break;
+        case FEATURES_SPECTRAL_ROLLOFF:
+            *out = values->rolloff;
+            break;
+        case FEATURES_SPECTRAL_FLATNESS:
+            *out = values->flatness;
+            break;
+        case FEATURES_DOMINANT_FREQUENCY:
+            *out = values->dominant;
+            break;
+        case FEATURES_SPECTRAL_BAND_RATIO:
+            *out = values->band_ratio;
+            break;
+        case FEATURES_SPECTRAL_MAXIMUM_BIN:
+            *out = values->maximum_bin;
+            break;
+        case FEATURES_SPECTRAL_PEAKS:
+            memcpy(out, values->peaks, sizeof(values->peaks));
+            break;
+        }
+    }
+}
+
+// Is the axis of the window `l` of the ranges constant? A scan of the samples
+// if the time domain pass has not found its range
+static inline bool features_spectral_is_constant(const features_ranges_t *ranges, int l,
+                                                 const accel_t *window, int axis)
+{
+    if (ranges && (ranges->axes & (1u << axis))) {
+        return ranges->minval[axis][l] == ranges->maxval[axis][l];
+    }
+    return window_is_constant(window, axis, FREQUENCY_WINDOW_SIZE);
+}
+
+// The features of one axis of one window that is not constant
+static void features_spectral_window_axis(const features_context_t *ctx, const accel_t *window,
+                                          int axis, float row[])
+{
+    float re[FREQUENCY_WINDOW_SIZE];
+    float im[FREQUENCY_WINDOW_SIZE];
+    int32_t sum;
+
+    sum = spectral_load_f(re, window, axis);
+    memset(im, 0, sizeof(im));
+    fft(re, im, FREQUENCY_WINDOW_SIZE);
+    spectral_detrend_f(re, sum);
+    features_spectral_axis(ctx, axis, re, im, row);
+}
+
+void features_spectral_window(const features_context_t *ctx, const accel_t *window,
+                              const features_ranges_t *ranges, float row[])
+{
+    int axis;
+
+    for (axis = 0; axis < NUM_AXIS; ++axis) {
+        if (!(ctx->spectral_axes & (1u << axis))) {
+            continue;
+        }
+        if (features_spectral_is_constant(ranges, 0, window, axis)) {
+            features_spectral_axis_constant(ctx, axis, window[0].v[axis], row);
+        } else {
+            features_spectral_window_axis(ctx, window, axis, row);
+        }
+    }
+}
+
+// The same for a tile of windows, with the FFT of all of them done at once.
+// The constant windows of each axis are skipped; if only a few windows remain,
+// the FFT of each of them is cheaper.
+void features_spectral_tile(const features_context_t *ctx, const accel_t *first, int stride, int n,
+                            const features_ranges_t *ranges, float rows[])
+{
+    float lanes_re[FREQUENCY_WINDOW_SIZE][WINDOW_LANES];
+    float lanes_im[FREQUENCY_WINDOW_SIZE][WINDOW_LANES];
+    float re[FREQUENCY_WINDOW_SIZE];
+    float im[FREQUENCY_WINDOW_SIZE];
+    int32_t sum[WINDOW_LANES];
+    int axis, l;
+
+    for (axis = 0; axis < NUM_AXIS; ++axis) {
+        uint32_t constant = 0;
+        int num_varying = 0;
+
+        if (!(ctx->spectral_axes & (1u << axis))) {
+            continue;
+        }
+        for (l = 0; l < n; ++l) {
+            const accel_t *window = &first[l * stride];
+            if (features_spectral_is_constant(ranges, l, window, axis)) {
+                features_spectral_axis_constant(ctx, axis, window[0].v[axis], &rows[l * ctx->width]);
+                constant |= 1u << l;
+            } else {
+                num_varying++;
+            }
+        }
+
+        if (num_varying == 0) {
+            continue;
+        }
+        // all lanes cost the same
+        if (num_varying < FEATURES_SPECTRAL_MIN_LANES) {
+            for (l = 0; l < n; ++l) {
+                if (!(constant & (1u << l))) {
+                    features_spectral_window_axis(ctx, &first[l * stride], axis, &rows[l * ctx->width]);
+                }
+            }
+            continue;
+        }
+
+        spectral_load_lanes_f(lanes_re, sum, first, stride, n, axis);
+        memset(lanes_im, 0, sizeof(lanes_im));
+        fft_lanes(lanes_re, lanes_im);
+        for (l = 0; l < n; ++l) {
+            if (!(constant & (1u << l))) {
+                spectral_unload_lane_f(re, im, lanes_re, lanes_im, l);
+                spectral_detrend_f(re, sum[l]);
+                features_spectral_axis(ctx, axis, re, im, &rows[l * ctx->width]);
+            }
+        }
+    }
+}
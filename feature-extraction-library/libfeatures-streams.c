@@ -0,0 +1,309 @@
+/*
+ * Copyright (c) 2019, Institute of Electronics and Computer Science (EDI)
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * Author: Atis Elsts
+ */
+
+/*
+ * File: libfeatures-streams.c
+ * The state of many concurrent streams, for the library.
+ *
+ * All state is in one arena, allocated once: for each stream a ring buffer
+ * holding one window, and the running sums of the last two hops.
+ * A stream becomes ready when its ring buffer is full; it is put in a FIFO
+ * of the ready streams, and does not take samples until extracted.
+ *
+ * The extraction copies the ready windows into a tile of consecutive windows,
+ * FEATURES_STREAMS_TILE at a time, and computes their features together
+ * with the cross-window kernels (window-lanes.h and `fft_lanes()`).
+ * The mean, energy and std come from the running sums, without a pass over the window.
+ * If the context has a cache size set, the streams have a cache of their own.
+ *
+ * A stream is restarted by a reset or a gap in the timestamps; that only clears
+ * its counters and sums, and the samples in the ring are overwritten later.
+ */
+
+#include "libfeatures-internal.h"
+
+// The number of windows extracted at once
+#ifndef FEATURES_STREAMS_TILE
+#define FEATURES_STREAMS_TILE WINDOW_LANES
+#endif
+
+#if FEATURES_STREAMS_TILE > WINDOW_LANES
+#error FEATURES_STREAMS_TILE must not be larger than WINDOW_LANES
+#endif
+
+// The running sums work when the windows consist of two hops
+#define FEATURES_STREAMS_SUMS (FEATURES_WINDOW_SIZE == TIME_WINDOW_SIZE \
+                               && FEATURES_WINDOW_SIZE == 2 * FEATURES_HOP_SIZE)
+
+typedef struct {
+    accel_t ring[FEATURES_WINDOW_SIZE];
+    // the position of the oldest sample in the ring, and the number of samples
+    uint16_t head;
+    uint16_t count;
+    // of the last sample pushed, for the timestamped samples
+    uint64_t last_timestamp;
+#if FEATURES_STREAMS_SUMS
+    // the sums of the previous (complete) hop and of the current one
+    features_sums_t hop[2];
+#endif
+} features_stream_t;
+
+struct features_streams {
+    const features_context_t *ctx;
+    features_stream_t *states;
+    int num_streams;
+    // FIFO of the ready streams; a stream is in it at most once
+    int *ready;
+    int ready_head;
+    int num_ready;
+    // the windows being extracted
+    accel_t tile[FEATURES_STREAMS_TILE][FEATURES_WINDOW_SIZE];
+    features_sums_t tile_sums[FEATURES_STREAMS_TILE];
+    features_cache_t *cache;
+};
+
+// -----------------------------------------------------------
+
+features_streams_t *features_streams_create(const features_context_t *ctx, int num_streams)
+{
+    features_streams_t *streams;
+
+    if (!ctx || num_streams <= 0) {
+        return NULL;
+    }
+    streams = calloc(1, sizeof(features_streams_t));
+    if (!streams) {
+        return NULL;
+    }
+    streams->ctx = ctx;
+    streams->num_streams = num_streams;
+    streams->states = calloc(num_streams, sizeof(features_stream_t));
+    streams->ready = calloc(num_streams, sizeof(int));
+    if (ctx->cache_size > 0 && ctx->width > 0) {
+        streams->cache = features_cache_create(ctx->cache_size, ctx->width);
+        if (!streams->cache) {
+            features_streams_destroy(streams);
+            return NULL;
+        }
+    }
+    if (!streams->states || !streams->ready) {
+        features_streams_destroy(streams);
+        return NULL;
+    }
+    return streams;
+}
+
+void features_streams_destroy(features_streams_t *streams)
+{
+    if (streams) {
+        free(streams->states);
+        free(streams->ready);
+        features_cache_destroy(streams->cache);
+        free(streams);
+    }
+}
+
+// Start the stream from an empty window
+static inline void features_stream_restart(features_stream_t *s)
+{
+    s->head = 0;
+    s->count = 0;
+#if FEATURES_STREAMS_SUMS
+    memset(s->hop, 0, sizeof(s->hop));
+#endif
+}
+
+void features_streams_reset(features_streams_t *streams, int stream)
+{
+    int i, j;
+
+    if (!streams || stream < 0 || stream >= streams->num_streams) {
+        return;
+    }
+    // drop it from the ready streams
+    for (i = 0, j = 0; i < streams->num_ready; ++i) {
+        int id = streams->ready[(streams->ready_head + i) % streams->num_streams];
+        if (id != stream) {
+            streams->ready[(streams->ready_head + j++) % streams->num_streams] = id;
+        }
+    }
+    streams->num_ready = j;
+    features_stream_restart(&streams->states[stream]);
+}
+
+int features_streams_num_ready(const features_streams_t *streams)
+{
+    return streams ? streams->num_ready : -1;
+}
+
+// -----------------------------------------------------------
+
+// Append samples to a stream until it is ready; returns the number of samples consumed
+static int features_streams_append(features_streams_t *streams, int stream,
+                                   const accel_t *in, int n)
+{
+    features_stream_t *s = &streams->states[stream];
+    int i, a;
+
+    for (i = 0; i < n && s->count < FEATURES_WINDOW_SIZE; ++i) {
+        s->ring[(s->head + s->count) % FEATURES_WINDOW_SIZE] = in[i];
+        s->count++;
+#if FEATURES_STREAMS_SUMS
+        for (a = 0; a < NUM_AXIS; ++a) {
+            int v = in[i].v[a];
+            int v2 = v * v;
+            s->hop[1].sum[a] += v;
+            s->hop[1].sqsum[a] += v2;
+            s->hop[1].cubesum[a] += v2 * v;
+            s->hop[1].quartsum[a] += (uint32_t)(v2 * v2);
+        }
+        if (s->count == FEATURES_HOP_SIZE) {
+            // the first hop is complete
+            s->hop[0] = s->hop[1];
+            memset(&s->hop[1], 0, sizeof(s->hop[1]));
+        }
+#else
+        (void)a;
+#endif
+        if (s->count == FEATURES_WINDOW_SIZE) {
+            streams->ready[(streams->ready_head + streams->num_ready) % streams->num_streams] = stream;
+            streams->num_ready++;
+        }
+    }
+    return i;
+}
+
+int features_streams_push(features_streams_t *streams, int stream,
+                          const features_sample_t samples[], int n)
+{
+    if (!streams || stream < 0 || stream >= streams->num_streams
+        || n < 0 || (n > 0 && !samples)) {
+        return -1;
+    }
+    return features_streams_append(streams, stream, (const accel_t *)samples, n);
+}
+
+int features_streams_push_timed(features_streams_t *streams, int stream,
+                                const features_sample_t samples[],
+                                const uint64_t timestamps[], int n)
+{
+    const accel_t *in = (const accel_t *)samples;
+    features_stream_t *s;
+    int i = 0;
+
+    if (!streams || stream < 0 || stream >= streams->num_streams
+        || n < 0 || (n > 0 && (!samples || !timestamps))) {
+        return -1;
+    }
+    s = &streams->states[stream];
+
+    while (i < n) {
+        int count, consumed;
+        // a ready stream is not in the middle of a gap: it takes no samples
+        if (s->count > 0 && s->count < FEATURES_WINDOW_SIZE
+            && features_is_gap(streams->ctx, s->last_timestamp, timestamps[i])) {
+            features_stream_restart(s);
+        }
+        count = features_gap_free(streams->ctx, &timestamps[i], n - i);
+        consumed = features_streams_append(streams, stream, &in[i], count);
+        if (consumed > 0) {
+            s->last_timestamp = timestamps[i + consumed - 1];
+        }
+        i += consumed;
+        if (consumed < count) {
+            // the stream is ready
+            break;
+        }
+    }
+    return i;
+}
+
+// -----------------------------------------------------------
+
+// Copy the window of a ready stream in the tile, and move the stream by a hop
+static void features_streams_take(features_streams_t *streams, int stream,
+                                  accel_t window[], features_sums_t *sums)
+{
+    features_stream_t *s = &streams->states[stream];
+    int first = FEATURES_WINDOW_SIZE - s->head;
+    int a;
+
+    memcpy(window, &s->ring[s->head], first * sizeof(accel_t));
+    memcpy(&window[first], s->ring, s->head * sizeof(accel_t));
+
+#if FEATURES_STREAMS_SUMS
+    for (a = 0; a < NUM_AXIS; ++a) {
+        sums->sum[a] = s->hop[0].sum[a] + s->hop[1].sum[a];
+        sums->sqsum[a] = s->hop[0].sqsum[a] + s->hop[1].sqsum[a];
+        sums->cubesum[a] = s->hop[0].cubesum[a] + s->hop[1].cubesum[a];
+        sums->quartsum[a] = s->hop[0].quartsum[a] + s->hop[1].quartsum[a];
+    }
+    s->hop[0] = s->hop[1];
+    memset(&s->hop[1], 0, sizeof(s->hop[1]));
+#else
+    (void)a;
+    (void)sums;
+#endif
+
+    s->head = (s->head + FEATURES_HOP_SIZE) % FEATURES_WINDOW_SIZE;
+    s->count -= FEATURES_HOP_SIZE;
+}
+
+int features_streams_extract(features_streams_t *streams,
+                             float out[], int stream_ids[], int max_windows)
+{
+    const features_context_t *ctx;
+    int num_windows = 0;
+
+    if (!streams || max_windows < 0
+        || (max_windows > 0 && streams->num_ready > 0 && (!out || !stream_ids))) {
+        return -1;
+    }
+    ctx = streams->ctx;
+
+    while (streams->num_ready > 0 && num_windows < max_windows) {
+        int n = min(min(streams->num_ready, FEATURES_STREAMS_TILE), max_windows - num_windows);
+        int i;
+
+        for (i = 0; i < n; ++i) {
+            int stream = streams->ready[streams->ready_head];
+            streams->ready_head = (streams->ready_head + 1) % streams->num_streams;
+            stream_ids[num_windows + i] = stream;
+            features_streams_take(streams, stream, streams->tile[i], &streams->tile_sums[i]);
+        }
+        streams->num_ready -= n;
+
+        features_tile_cached(ctx, streams->cache, streams->tile[0], FEATURES_WINDOW_SIZE, n,
+                             FEATURES_STREAMS_SUMS ? streams->tile_sums : NULL,
+                             &out[num_windows * ctx->width]);
+        num_windows += n;
+    }
+    return num_windows;
+}
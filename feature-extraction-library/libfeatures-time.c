@@ -0,0 +1,499 @@
+/*
+ * Copyright (c) 2019, Institute of Electronics and Computer Science (EDI)
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * Author: Atis Elsts
+ */
+
+/*
+ * File: libfeatures-time.c
+ * The time domain features of the library.
+ */
+
+#include "libfeatures-internal.h"
+#include "tables.h"
+#include "window-features.h"
+#include "window-lanes.h"
+
+// -----------------------------------------------------------
+
+__attribute__((constructor))
+static void features_time_init(void)
+{
+    tables_init();
+}
+
+// -----------------------------------------------------------
+
+// The moments, the ranges and the histograms are shared by the features of the same axis.
+// The histograms only have the bins of the range of the values.
+// The sums of the powers are those of the axes with the higher moments, see below.
+// The orientation does not depend on the axis, and is shared by all of its features.
+typedef struct {
+    window_moments_t moments[NUM_AXIS];
+    const window_powers_t *powers;
+    int minval[NUM_AXIS];
+    int maxval[NUM_AXIS];
+    histogram_bin_t stats[NUM_AXIS][256];
+    window_orientation_t orientation;
+    unsigned have_moments;
+    unsigned have_range;
+    unsigned have_stats;
+    bool have_orientation;
+} features_time_cache_t;
+
+static inline bool features_is_histogram(int kind)
+{
+    switch (kind) {
+    case FEATURES_MEDIAN:
+    case FEATURES_Q25:
+    case FEATURES_Q75:
+    case FEATURES_IQR:
+    case FEATURES_ENTROPY:
+        return true;
+    }
+    return false;
+}
+
+static void features_time_item(const features_item_t *item, const accel_t *window,
+                               features_time_cache_t *cache, float *out)
+{
+    int axis = item->axis;
+    window_moments_t *moments = &cache->moments[axis];
+    histogram_bin_t *stats = cache->stats[axis];
+    int lo = 0, hi = 0;
+
+    switch (item->kind) {
+    case FEATURES_MEAN:
+    case FEATURES_ENERGY:
+    case FEATURES_STD:
+    case FEATURES_MEAN_CROSSINGS:
+    case FEATURES_PEAKS:
+    case FEATURES_PEAK_INTERVAL:
+        if (!(cache->have_moments & (1u << axis))) {
+            window_moments(window, axis, moments);
+            cache->have_moments |= 1u << axis;
+        }
+        break;
+    case FEATURES_MIN:
+    case FEATURES_MAX:
+    case FEATURES_MEDIAN:
+    case FEATURES_Q25:
+    case FEATURES_Q75:
+    case FEATURES_IQR:
+    case FEATURES_ENTROPY:
+        if (!(cache->have_range & (1u << axis))) {
+            cache->minval[axis] = window_min(window, axis);
+            cache->maxval[axis] = window_max(window, axis);
+            cache->have_range |= 1u << axis;
+        }
+        lo = cache->minval[axis];
+        hi = cache->maxval[axis];
+        if (features_is_histogram(item->kind) && !(cache->have_stats & (1u << axis))) {
+            window_histogram_range(window, axis, lo, hi, stats);
+            cache->have_stats |= 1u << axis;
+        }
+        break;
+    case FEATURES_PITCH:
+    case FEATURES_ROLL:
+    case FEATURES_TILT:
+        if (!cache->have_orientation) {
+            window_orientation(window, &cache->orientation);
+            cache->have_orientation = true;
+        }
+        break;
+    }
+
+    switch (item->kind) {
+    case FEATURES_MEAN:
+        *out = moments->avg;
+        break;
+    case FEATURES_ENERGY:
+        *out = window_energy(moments);
+        break;
+    case FEATURES_STD:
+        *out = window_std(moments);
+        break;
+    case FEATURES_MIN:
+        *out = lo;
+        break;
+    case FEATURES_MAX:
+        *out = hi;
+        break;
+    case FEATURES_MEDIAN:
+        *out = window_histogram_select_range(stats, lo, TIME_WINDOW_SIZE / 2);
+        break;
+    case FEATURES_Q25:
+        *out = window_histogram_select_range(stats, lo, TIME_WINDOW_SIZE / 4);
+        break;
+    case FEATURES_Q75:
+        *out = window_histogram_select_range(stats, lo, TIME_WINDOW_SIZE * 3 / 4);
+        break;
+    case FEATURES_IQR:
+        *out = window_histogram_select_range(stats, lo, TIME_WINDOW_SIZE * 3 / 4)
+            - window_histogram_select_range(stats, lo, TIME_WINDOW_SIZE / 4);
+        break;
+    case FEATURES_SMA:
+        *out = window_sma(window, axis);
+        break;
+    case FEATURES_ENTROPY:
+        // zero for a constant window
+        *out = lo == hi ? 0.0f : window_entropy_range(stats, lo, hi);
+        break;
+    case FEATURES_CORRELATION:
+        *out = window_correlation(window, axis, (axis + 1) % NUM_AXIS, NULL, NULL);
+        break;
+    case FEATURES_SKEWNESS:
+        *out = window_skewness(&cache->powers[axis]);
+        break;
+    case FEATURES_KURTOSIS:
+        *out = window_kurtosis(&cache->powers[axis]);
+        break;
+    case FEATURES_ZERO_CROSSINGS:
+        *out = window_crossings(window, axis, 0);
+        break;
+    case FEATURES_MEAN_CROSSINGS:
+        *out = window_crossings(window, axis, moments->avg);
+        break;
+    case FEATURES_PEAKS:
+    case FEATURES_PEAK_INTERVAL: {
+        window_peaks_t p;
+        window_peaks(window, axis, moments->avg, &p);
+        *out = item->kind == FEATURES_PEAKS ? p.count : window_peak_interval(&p);
+        break;
+    }
+    case FEATURES_PITCH:
+        *out = cache->orientation.pitch;
+        break;
+    case FEATURES_ROLL:
+        *out = cache->orientation.roll;
+        break;
+    case FEATURES_TILT:
+        *out = cache->orientation.tilt;
+        break;
+    default:
+        // a spectral feature
+        break;
+    }
+}
+
+// The sums of the powers of the axes with skewness or kurtosis, taken from `sums` if known.
+// Otherwise they are computed in one pass, which gives the sums of the mean, energy and std too.
+static void features_time_powers(const features_context_t *ctx, const accel_t *window,
+                                 const features_sums_t *sums, window_powers_t powers[NUM_AXIS])
+{
+    int a;
+    for (a = 0; a < NUM_AXIS; ++a) {
+        if (!(ctx->powers_axes & (1u << a))) {
+            continue;
+        }
+        if (sums) {
+            powers[a].sum = sums->sum[a];
+            powers[a].sqsum = sums->sqsum[a];
+            powers[a].cubesum = sums->cubesum[a];
+            powers[a].quartsum = sums->quartsum[a];
+        } else {
+            window_powers(window, a, TIME_WINDOW_SIZE, &powers[a]);
+        }
+    }
+}
+
+void features_time_window(const features_context_t *ctx, const accel_t *window,
+                          const features_sums_t *sums, features_ranges_t *ranges, float row[])
+{
+    features_time_cache_t cache;
+    window_powers_t powers[NUM_AXIS];
+    int i;
+
+    cache.have_moments = 0;
+    cache.have_range = 0;
+    cache.have_stats = 0;
+    cache.have_orientation = false;
+    if (sums) {
+        for (i = 0; i < NUM_AXIS; ++i) {
+            window_moments_from_sums(sums->sum[i], sums->sqsum[i], &cache.moments[i]);
+        }
+        cache.have_moments = (1u << NUM_AXIS) - 1;
+    }
+    if (ctx->powers_axes) {
+        features_time_powers(ctx, window, sums, powers);
+        for (i = 0; i < NUM_AXIS; ++i) {
+            if (ctx->powers_axes & (1u << i)) {
+                window_moments_from_sums(powers[i].sum, powers[i].sqsum, &cache.moments[i]);
+            }
+        }
+        cache.have_moments |= ctx->powers_axes;
+        cache.powers = powers;
+    }
+
+    for (i = 0; i < ctx->plan_size; ++i) {
+        features_time_item(&ctx->plan[i], window, &cache, &row[ctx->plan[i].offset]);
+    }
+
+    // the ranges that the features needed; the spectral features use the same samples
+    if (ranges) {
+        ranges->axes = 0;
+#if TIME_WINDOW_SIZE == FREQUENCY_WINDOW_SIZE
+        ranges->axes = cache.have_range;
+        for (i = 0; i < NUM_AXIS; ++i) {
+            if (cache.have_range & (1u << i)) {
+                ranges->minval[i][0] = cache.minval[i];
+                ranges->maxval[i][0] = cache.maxval[i];
+            }
+        }
+#endif
+    }
+}
+
+// -----------------------------------------------------------
+//
+// The features that have cross-window kernels (window-lanes.h)
+// are computed for all windows of a tile at once, the rest one window at a time.
+//
+
+typedef struct {
+    const accel_t *first;
+    int stride;
+    int n;
+    window_lanes_t t[NUM_AXIS];
+    window_sum_t sum[NUM_AXIS][WINDOW_LANES];
+    window_sqsum_t sqsum[NUM_AXIS][WINDOW_LANES];
+    int minval[NUM_AXIS][WINDOW_LANES];
+    int maxval[NUM_AXIS][WINDOW_LANES];
+    unsigned have_t;
+    unsigned have_sums;
+    unsigned have_min_max;
+} features_lanes_t;
+
+static inline bool features_is_lanes(int kind)
+{
+    switch (kind) {
+    case FEATURES_MEAN:
+    case FEATURES_ENERGY:
+    case FEATURES_STD:
+    case FEATURES_MIN:
+    case FEATURES_MAX:
+    case FEATURES_CORRELATION:
+    case FEATURES_ZERO_CROSSINGS:
+    case FEATURES_MEAN_CROSSINGS:
+    case FEATURES_PEAKS:
+    case FEATURES_PEAK_INTERVAL:
+        return true;
+    }
+    return false;
+}
+
+static inline const window_lanes_t *features_lanes_tile(features_lanes_t *lanes, int axis)
+{
+    if (!(lanes->have_t & (1u << axis))) {
+        window_lanes_load(lanes->t[axis], lanes->first, lanes->stride, lanes->n, axis);
+        lanes->have_t |= 1u << axis;
+    }
+    return (const window_lanes_t *)&lanes->t[axis];
+}
+
+static inline void features_lanes_sums(features_lanes_t *lanes, int axis)
+{
+    if (!(lanes->have_sums & (1u << axis))) {
+        window_lanes_sums(*features_lanes_tile(lanes, axis), lanes->sum[axis], lanes->sqsum[axis]);
+        lanes->have_sums |= 1u << axis;
+    }
+}
+
+static inline void features_lanes_min_max(features_lanes_t *lanes, int axis)
+{
+    if (!(lanes->have_min_max & (1u << axis))) {
+        window_lanes_min_max(*features_lanes_tile(lanes, axis),
+                             lanes->minval[axis], lanes->maxval[axis]);
+        lanes->have_min_max |= 1u << axis;
+    }
+}
+
+static void features_lanes_item(const features_item_t *item, features_lanes_t *lanes,
+                                float *out, int width)
+{
+    int axis = item->axis;
+    int axis2 = (axis + 1) % NUM_AXIS;
+    window_sum_t msum[WINDOW_LANES];
+    int level[WINDOW_LANES];
+    int count[WINDOW_LANES], first[WINDOW_LANES], last[WINDOW_LANES];
+    int l;
+
+    switch (item->kind) {
+    case FEATURES_MEAN:
+    case FEATURES_ENERGY:
+    case FEATURES_STD:
+        features_lanes_sums(lanes, axis);
+        for (l = 0; l < lanes->n; ++l) {
+            window_moments_t m;
+            window_moments_from_sums(lanes->sum[axis][l], lanes->sqsum[axis][l], &m);
+            out[l * width] = item->kind == FEATURES_MEAN ? m.avg
+                : item->kind == FEATURES_ENERGY ? window_energy(&m) : window_std(&m);
+        }
+        break;
+    case FEATURES_MIN:
+    case FEATURES_MAX:
+        features_lanes_min_max(lanes, axis);
+        for (l = 0; l < lanes->n; ++l) {
+            out[l * width] = item->kind == FEATURES_MIN ? lanes->minval[axis][l] : lanes->maxval[axis][l];
+        }
+        break;
+    case FEATURES_CORRELATION:
+        features_lanes_sums(lanes, axis);
+        features_lanes_sums(lanes, axis2);
+        window_lanes_cross_sums(*features_lanes_tile(lanes, axis),
+                                *features_lanes_tile(lanes, axis2), msum);
+        for (l = 0; l < lanes->n; ++l) {
+            out[l * width] = window_correlation_from_sums(
+                lanes->sum[axis][l], lanes->sqsum[axis][l],
+                lanes->sum[axis2][l], lanes->sqsum[axis2][l], msum[l], NULL, NULL);
+        }
+        break;
+    case FEATURES_ZERO_CROSSINGS:
+        memset(level, 0, sizeof(level));
+        window_lanes_crossings(*features_lanes_tile(lanes, axis), level, count);
+        for (l = 0; l < lanes->n; ++l) {
+            out[l * width] = count[l];
+        }
+        break;
+    case FEATURES_MEAN_CROSSINGS:
+    case FEATURES_PEAKS:
+    case FEATURES_PEAK_INTERVAL:
+        // the level is the mean, from the sums of the tile
+        features_lanes_sums(lanes, axis);
+        for (l = 0; l < WINDOW_LANES; ++l) {
+            level[l] = l < lanes->n ? lanes->sum[axis][l] / TIME_WINDOW_SIZE : 0;
+        }
+        if (item->kind == FEATURES_MEAN_CROSSINGS) {
+            window_lanes_crossings(*features_lanes_tile(lanes, axis), level, count);
+            for (l = 0; l < lanes->n; ++l) {
+                out[l * width] = count[l];
+            }
+            break;
+        }
+        window_lanes_peaks(*features_lanes_tile(lanes, axis), level, count, first, last);
+        for (l = 0; l < lanes->n; ++l) {
+            window_peaks_t p = { count[l], first[l], last[l] };
+            out[l * width] = item->kind == FEATURES_PEAKS ? p.count : window_peak_interval(&p);
+        }
+        break;
+    }
+}
+
+void features_time_tile(const features_context_t *ctx, const accel_t *first, int stride, int n,
+                        const features_sums_t sums[], features_ranges_t *ranges, float rows[])
+{
+    features_lanes_t lanes;
+    features_time_cache_t cache;
+    window_powers_t powers[WINDOW_LANES][NUM_AXIS];
+    unsigned range_axes = 0;
+    unsigned min_max_axes;
+    int i, l, a;
+
+    lanes.first = first;
+    lanes.stride = stride;
+    lanes.n = n;
+    lanes.have_t = 0;
+    lanes.have_sums = 0;
+    lanes.have_min_max = 0;
+    if (sums) {
+        for (a = 0; a < NUM_AXIS; ++a) {
+            for (l = 0; l < n; ++l) {
+                lanes.sum[a][l] = sums[l].sum[a];
+                lanes.sqsum[a][l] = sums[l].sqsum[a];
+            }
+        }
+        lanes.have_sums = (1u << NUM_AXIS) - 1;
+    }
+    // the pass over the powers gives the sums of the lanes as well
+    if (ctx->powers_axes) {
+        for (l = 0; l < n; ++l) {
+            features_time_powers(ctx, &first[l * stride], sums ? &sums[l] : NULL, powers[l]);
+            for (a = 0; a < NUM_AXIS; ++a) {
+                if (ctx->powers_axes & (1u << a)) {
+                    lanes.sum[a][l] = powers[l][a].sum;
+                    lanes.sqsum[a][l] = powers[l][a].sqsum;
+                }
+            }
+        }
+        lanes.have_sums |= ctx->powers_axes;
+    }
+
+    for (i = 0; i < ctx->plan_size; ++i) {
+        const features_item_t *item = &ctx->plan[i];
+        if (features_is_lanes(item->kind)) {
+            features_lanes_item(item, &lanes, &rows[item->offset], ctx->width);
+        } else if (features_is_histogram(item->kind)) {
+            range_axes |= 1u << item->axis;
+        }
+    }
+    // the ranges of the histograms come from the cross-window min and max,
+    // and so do the constant axes of the spectral features of the same samples
+    min_max_axes = range_axes;
+#if TIME_WINDOW_SIZE == FREQUENCY_WINDOW_SIZE
+    if (ranges) {
+        min_max_axes |= ctx->spectral_axes;
+    }
+#endif
+    for (a = 0; a < NUM_AXIS; ++a) {
+        if (min_max_axes & (1u << a)) {
+            features_lanes_min_max(&lanes, a);
+        }
+    }
+    if (ranges) {
+        ranges->axes = 0;
+#if TIME_WINDOW_SIZE == FREQUENCY_WINDOW_SIZE
+        ranges->axes = lanes.have_min_max;
+        for (a = 0; a < NUM_AXIS; ++a) {
+            if (lanes.have_min_max & (1u << a)) {
+                memcpy(ranges->minval[a], lanes.minval[a], n * sizeof(int));
+                memcpy(ranges->maxval[a], lanes.maxval[a], n * sizeof(int));
+            }
+        }
+#endif
+    }
+
+    for (l = 0; l < n; ++l) {
+        const accel_t *window = &first[l * stride];
+        cache.have_moments = 0;
+        cache.have_range = range_axes;
+        cache.have_stats = 0;
+        cache.have_orientation = false;
+        cache.powers = powers[l];
+        for (a = 0; a < NUM_AXIS; ++a) {
+            if (range_axes & (1u << a)) {
+                cache.minval[a] = lanes.minval[a][l];
+                cache.maxval[a] = lanes.maxval[a][l];
+            }
+        }
+        for (i = 0; i < ctx->plan_size; ++i) {
+            const features_item_t *item = &ctx->plan[i];
+            if (!features_is_lanes(item->kind)) {
+                features_time_item(item, window, &cache, &rows[l * ctx->width + item->offset]);
+            }
+        }
+    }
+}
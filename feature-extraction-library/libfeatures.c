@@ -0,0 +1,315 @@
+/*
+ * Copyright (c) 2019, Institute of Electronics and Computer Science (EDI)
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * Author: Atis Elsts
+ */
+
+/*
+ * File: libfeatures.c
+ * The feature extraction library: the contexts, the plans and the processing
+ * of the samples in windows. See feature-extraction.h.
+ *
+ * Build with `make lib`. The features are computed by libfeatures-time.c and
+ * libfeatures-spectral.c, from the same code as the feature functions use.
+ */
+
+#include "libfeatures-internal.h"
+
+#if FEATURES_SPECTRAL_HISTOGRAM_BINS != 9
+#error FEATURES_SPECTRAL_HISTOGRAM_BINS must match NUM_FREQUENCY_HISTOGRAM_BINS
+#endif
+
+// -----------------------------------------------------------
+
+features_context_t *features_create(void)
+{
+    return calloc(1, sizeof(features_context_t));
+}
+
+void features_destroy(features_context_t *ctx)
+{
+    if (ctx) {
+        features_cache_destroy(ctx->cache);
+        free(ctx);
+    }
+}
+
+void features_reset(features_context_t *ctx)
+{
+    if (ctx) {
+        ctx->buffered = 0;
+    }
+}
+
+int features_set_cache_size(features_context_t *ctx, int num_entries)
+{
+    if (!ctx || num_entries < 0 || num_entries > FEATURES_CACHE_MAX_ENTRIES) {
+        return -1;
+    }
+    features_cache_destroy(ctx->cache);
+    ctx->cache = NULL;
+    ctx->cache_size = num_entries;
+    return 0;
+}
+
+// Create the cache for the current plan, if it is enabled
+static int features_prepare_cache(features_context_t *ctx)
+{
+    if (ctx->cache_size == 0 || ctx->width == 0
+        || (ctx->cache && features_cache_width(ctx->cache) == ctx->width)) {
+        return 0;
+    }
+    features_cache_destroy(ctx->cache);
+    ctx->cache = features_cache_create(ctx->cache_size, ctx->width);
+    return ctx->cache ? 0 : -1;
+}
+
+int features_set_max_gap(features_context_t *ctx, uint64_t max_gap)
+{
+    if (!ctx) {
+        return -1;
+    }
+    ctx->max_gap = max_gap;
+    return 0;
+}
+
+// -----------------------------------------------------------
+
+// The number of values and the flags of each kind; a new kind must be added here as well
+#define FEATURES_SPECTRAL_POWER (FEATURES_KIND_SPECTRAL | FEATURES_KIND_POWER)
+
+const features_kind_info_t features_kinds[FEATURES_NUM_KINDS] = {
+    [FEATURES_MEAN] = { 1, 0 },
+    [FEATURES_ENERGY] = { 1, 0 },
+    [FEATURES_STD] = { 1, 0 },
+    [FEATURES_MIN] = { 1, 0 },
+    [FEATURES_MAX] = { 1, 0 },
+    [FEATURES_MEDIAN] = { 1, 0 },
+    [FEATURES_Q25] = { 1, 0 },
+    [FEATURES_Q75] = { 1, 0 },
+    [FEATURES_IQR] = { 1, 0 },
+    [FEATURES_SMA] = { 1, 0 },
+    [FEATURES_ENTROPY] = { 1, 0 },
+    [FEATURES_CORRELATION] = { 1, 0 },
+    [FEATURES_SPECTRAL_ENTROPY] = { 1, FEATURES_KIND_SPECTRAL },
+    [FEATURES_SPECTRAL_MAXIMUM] = { 1, FEATURES_SPECTRAL_POWER },
+    [FEATURES_SPECTRAL_HISTOGRAM] = { FEATURES_SPECTRAL_HISTOGRAM_BINS, FEATURES_SPECTRAL_POWER },
+    [FEATURES_SKEWNESS] = { 1, 0 },
+    [FEATURES_KURTOSIS] = { 1, 0 },
+    [FEATURES_ZERO_CROSSINGS] = { 1, 0 },
+    [FEATURES_MEAN_CROSSINGS] = { 1, 0 },
+    [FEATURES_PEAKS] = { 1, 0 },
+    [FEATURES_PEAK_INTERVAL] = { 1, 0 },
+    [FEATURES_PERIOD] = { 1, FEATURES_KIND_SPECTRAL },
+    [FEATURES_PERIOD_STRENGTH] = { 1, FEATURES_KIND_SPECTRAL },
+    [FEATURES_SPECTRAL_CENTROID] = { 1, FEATURES_SPECTRAL_POWER },
+    [FEATURES_SPECTRAL_SPREAD] = { 1, FEATURES_SPECTRAL_POWER },
+    [FEATURES_SPECTRAL_ROLLOFF] = { 1, FEATURES_SPECTRAL_POWER },
+    [FEATURES_SPECTRAL_FLATNESS] = { 1, FEATURES_SPECTRAL_POWER },
+    [FEATURES_DOMINANT_FREQUENCY] = { 1, FEATURES_SPECTRAL_POWER },
+    [FEATURES_SPECTRAL_BAND_RATIO] = { 1, FEATURES_SPECTRAL_POWER },
+    [FEATURES_SPECTRAL_MAXIMUM_BIN] = { 1, FEATURES_SPECTRAL_POWER },
+    [FEATURES_SPECTRAL_PEAKS] = { 2 * FEATURES_SPECTRAL_PEAKS_COUNT, FEATURES_SPECTRAL_POWER },
+    [FEATURES_PITCH] = { 1, 0 },
+    [FEATURES_ROLL] = { 1, 0 },
+    [FEATURES_TILT] = { 1, 0 },
+};
+
+int features_plan_add(features_context_t *ctx, features_kind_t kind, int axis)
+{
+    features_item_t *item;
+
+    if (!ctx || (unsigned)kind >= FEATURES_NUM_KINDS
+        || axis < 0 || axis >= NUM_AXIS
+        || ctx->plan_size >= FEATURES_MAX_PLAN) {
+        return -1;
+    }
+
+    item = &ctx->plan[ctx->plan_size++];
+    item->kind = kind;
+    item->axis = axis;
+    item->offset = ctx->width;
+    ctx->width += features_kinds[kind].width;
+    if (kind == FEATURES_SKEWNESS || kind == FEATURES_KURTOSIS) {
+        ctx->powers_axes |= 1u << axis;
+    }
+    if (features_is_spectral(kind)) {
+        features_spectral_prepare();
+        ctx->spectral_axes |= 1u << axis;
+    }
+    return item->offset;
+}
+
+int features_plan_width(const features_context_t *ctx)
+{
+    return ctx ? ctx->width : -1;
+}
+
+int features_window_size(void)
+{
+    return FEATURES_WINDOW_SIZE;
+}
+
+int features_hop_size(void)
+{
+    return FEATURES_HOP_SIZE;
+}
+
+int features_max_windows(int n)
+{
+    return n < 0 ? -1 : n / FEATURES_HOP_SIZE + 1;
+}
+
+// -----------------------------------------------------------
+
+// The number of windows in `n` samples
+static inline int features_num_windows(int n)
+{
+    return n >= FEATURES_WINDOW_SIZE ? (n - FEATURES_WINDOW_SIZE) / FEATURES_HOP_SIZE + 1 : 0;
+}
+
+void features_window(const features_context_t *ctx, const accel_t *window,
+                     const features_sums_t *sums, float row[])
+{
+    features_ranges_t ranges;
+    features_time_window(ctx, window, sums, &ranges, row);
+    features_spectral_window(ctx, window, &ranges, row);
+}
+
+void features_tile(const features_context_t *ctx, const accel_t *first, int stride, int n,
+                   const features_sums_t sums[], float rows[])
+{
+    features_ranges_t ranges;
+    features_time_tile(ctx, first, stride, n, sums, &ranges, rows);
+    features_spectral_tile(ctx, first, stride, n, &ranges, rows);
+}
+
+int features_process_batch(features_context_t *ctx,
+                           const features_sample_t samples[], int n,
+                           float out[], int max_windows)
+{
+    const accel_t *in = (const accel_t *)samples;
+    int num_windows;
+    int i;
+
+    if (!ctx || n < 0 || (n > 0 && !samples)) {
+        return -1;
+    }
+    num_windows = features_num_windows(n);
+    if (num_windows > max_windows || (num_windows > 0 && !out)
+        || features_prepare_cache(ctx) < 0) {
+        return -1;
+    }
+
+    // the consecutive windows overlap, and are processed WINDOW_LANES at a time
+    for (i = 0; i < num_windows; i += WINDOW_LANES) {
+        features_tile_cached(ctx, ctx->cache, &in[i * FEATURES_HOP_SIZE], FEATURES_HOP_SIZE,
+                             min(WINDOW_LANES, num_windows - i), NULL, &out[i * ctx->width]);
+    }
+    return num_windows;
+}
+
+// Append the samples to the buffer of the stream, and compute the windows
+// that become complete; returns the number of rows
+static int features_stream_append(features_context_t *ctx, const accel_t *in,
+                                  const uint64_t *timestamps, int n,
+                                  float out[], uint64_t row_times[])
+{
+    int i = 0;
+
+    while (n > 0) {
+        int count = min(n, FEATURES_WINDOW_SIZE - ctx->buffered);
+        memcpy(&ctx->buffer[ctx->buffered], in, count * sizeof(accel_t));
+        ctx->buffered += count;
+        in += count;
+        n -= count;
+
+        if (ctx->buffered == FEATURES_WINDOW_SIZE) {
+            if (row_times) {
+                row_times[i] = timestamps[count - 1];
+            }
+            features_window_cached(ctx, ctx->cache, ctx->buffer, NULL, &out[i++ * ctx->width]);
+            // keep the overlap with the next window
+            memmove(ctx->buffer, &ctx->buffer[FEATURES_HOP_SIZE],
+                    (FEATURES_WINDOW_SIZE - FEATURES_HOP_SIZE) * sizeof(accel_t));
+            ctx->buffered = FEATURES_WINDOW_SIZE - FEATURES_HOP_SIZE;
+        }
+        if (timestamps) {
+            timestamps += count;
+        }
+    }
+    return i;
+}
+
+int features_process_stream(features_context_t *ctx,
+                            const features_sample_t samples[], int n,
+                            float out[], int max_windows)
+{
+    int num_windows;
+
+    if (!ctx || n < 0 || (n > 0 && !samples)) {
+        return -1;
+    }
+    num_windows = features_num_windows(ctx->buffered + n);
+    if (num_windows > max_windows || (num_windows > 0 && !out)
+        || features_prepare_cache(ctx) < 0) {
+        return -1;
+    }
+    return features_stream_append(ctx, (const accel_t *)samples, NULL, n, out, NULL);
+}
+
+int features_process_timed(features_context_t *ctx,
+                           const features_sample_t samples[],
+                           const uint64_t timestamps[], int n,
+                           float out[], uint64_t row_times[], int max_windows)
+{
+    const accel_t *in = (const accel_t *)samples;
+    int rows = 0;
+    int i, count;
+
+    if (!ctx || n < 0 || (n > 0 && (!samples || !timestamps))) {
+        return -1;
+    }
+    // the gaps can only make the number of windows smaller
+    if (features_num_windows(ctx->buffered + n) > max_windows
+        || (features_num_windows(ctx->buffered + n) > 0 && !out)
+        || features_prepare_cache(ctx) < 0) {
+        return -1;
+    }
+
+    for (i = 0; i < n; i += count) {
+        if (ctx->buffered > 0 && features_is_gap(ctx, ctx->last_timestamp, timestamps[i])) {
+            // the samples before the gap cannot be part of any window
+            ctx->buffered = 0;
+        }
+        count = features_gap_free(ctx, &timestamps[i], n - i);
+        rows += features_stream_append(ctx, &in[i], &timestamps[i], count, &out[rows * ctx->width],
+                                       row_times ? &row_times[rows] : NULL);
+        ctx->last_timestamp = timestamps[i + count - 1];
+    }
+    return rows;
+}
@@ -39,7 +39,6 @@
 #include <limits.h>
 
 #include "adaptation.h"
-//#include "sqrt.h"
 #include "main.h"
 
 // -----------------------------------------------------------
@@ -63,6 +62,7 @@ const accel_t data[] =
 #include "features-time-advanced.c"
 #include "features-frequency.c"
 #include "transforms-filters.c"
+#include "pipeline.c"
 
 // -----------------------------------------------------------
 
@@ -87,11 +87,19 @@ void test(const test_t *t)
         num_reps = NUM_REPETITIONS[VERY_FAST];
     }
 
+#if DO_SINK_OUTPUT
+    // keep just the results of this feature
+    output_sink_reset();
+#endif
+
     start = k_uptime_get();
     LOG("Start feature: %s\n", t->name);
 
     // iterate for each axis
     for (axis = 0; axis < NUM_AXIS; ++axis) {
+#if DO_SINK_OUTPUT
+        output_sink_begin(t->name, axis);
+#endif
         for (i = 0; i < NUM_REPETITIONS[t->class]; ++i) {
             t->f(axis);
         }
@@ -127,29 +135,62 @@ const test_t tests[] =
     { "std+mean", feature_std_mean },
     { "std+energy", feature_std_energy },
     { "std+energy+mean", feature_std_energy_mean },
+    { "std+energy+mean_lanes", feature_std_energy_mean_lanes },
+    { "skewness", feature_skewness },
+    { "kurtosis", feature_kurtosis },
+    { "std+skewness+kurtosis+mean", feature_std_skewness_kurtosis_mean },
+    { "std+skewness+kurtosis+mean_sliding", feature_std_skewness_kurtosis_mean_sliding },
+    { "energy_i", feature_energy_i },
+    { "std_i", feature_std_i },
 
     // Correlation + std combination
     { "correlation", feature_correlation },
     { "correlation+std", feature_correlation_std },
     { "correlation+std+std", feature_correlation_std_std },
+    { "correlation_lanes", feature_correlation_lanes },
+    { "correlation_i", feature_correlation_i },
+    { "correlation_matrix", feature_correlation_matrix },
+    { "correlation_matrix_lanes", feature_correlation_matrix_lanes },
+    { "correlation_matrix_sliding", feature_correlation_matrix_sliding },
 
     // Entropy
     { "entropy", feature_entropy },
 
+    // Crossings and peaks
+    { "zero_crossings", feature_zero_crossings },
+    { "mean_crossings", feature_mean_crossings },
+    { "peaks", feature_peaks },
+    { "crossings+peaks_lanes", feature_crossings_peaks_lanes },
+
+    // Orientation
+    { "orientation", feature_orientation },
+
     // Sorting-related functions
     { "min", feature_min },
     { "min+max", feature_min_max },
+    { "min+max_lanes", feature_min_max_lanes },
     { "median", feature_median },
     { "iqr", feature_iqr },
     { "median+iqr", feature_median_iqr },
     { "median+iqr+min+max", feature_median_iqr_min_max },
+    { "sort_median", feature_sort_median },
+    { "quantiles", feature_quantiles },
+    { "quantiles_rank", feature_quantiles_rank },
+    { "quantiles_histogram", feature_quantiles_histogram },
 
     // Spectral features
     { "spectral_maxima_i", feature_spectral_maxima_i, MODERATE },
     { "spectral_maxima_f", feature_spectral_maxima_f, MODERATE },
+    { "spectral_top_peaks_f", feature_spectral_top_peaks_f, MODERATE },
     { "spectral_density_i", feature_spectral_density_i, MODERATE },
     { "spectral_density_f", feature_spectral_density_f, MODERATE },
+    { "spectral_density_lanes_f", feature_spectral_density_lanes_f, MODERATE },
     { "spectral_entropy_f", feature_spectral_entropy_f, SLOW },
+    { "spectral_entropy_fast_f", feature_spectral_entropy_fast_f, SLOW },
+    { "spectral_entropy_i", feature_spectral_entropy_i, SLOW },
+    { "spectral_shape_i", feature_spectral_shape_i, MODERATE },
+    { "spectral_shape_f", feature_spectral_shape_f, MODERATE },
+    { "spectral_autocorrelation_f", feature_spectral_autocorrelation_f, SLOW },
     { "spectral_entropy_ma_f", feature_spectral_ma_f, SLOW },
     { "spectral_entropy_ma_squared_i", feature_spectral_ma_squared_i, SLOW },
     { "spectral_histogram_i", feature_spectral_histogram_i, SLOW },
@@ -157,12 +198,35 @@ const test_t tests[] =
 
     // transforms
     { "t_median", filter_median }, /* this is kind of implicit before any other features are calculated */
+    { "t_median5", filter_median5 },
+    { "t_median9", filter_median9 },
+    { "t_median9_histogram", filter_median9_histogram },
+    { "t_median15", filter_median15 },
     { "t_l1norm", transform_l1norm },
     { "t_magnitude_sq", transform_magnitude_sq },
+    { "t_magnitude", transform_magnitude },
+    { "t_magnitude_i", transform_magnitude_i },
+    { "t_orientation", transform_orientation },
+    { "t_orientation_i", transform_orientation_i },
 
     { "t_jerk", transform_jerk },
     { "t_jerk+l1norm", transform_jerk_l1norm },
     { "t_jerk+magnitude_sq", transform_jerk_magnitude_sq },
+    { "t_jerk+magnitude", transform_jerk_magnitude },
+
+    // block versions of the transforms
+    { "t_l1norm_v", transform_l1norm_v },
+    { "t_magnitude_sq_v", transform_magnitude_sq_v },
+    { "t_magnitude_v", transform_magnitude_v },
+    { "t_jerk_v", transform_jerk_v },
+    { "t_jerk+l1norm_v", transform_jerk_l1norm_v },
+    { "t_jerk+magnitude_sq_v", transform_jerk_magnitude_sq_v },
+    { "t_jerk+magnitude_v", transform_jerk_magnitude_v },
+    { "t_orientation_v", transform_orientation_v },
+
+    // transforms chained with features
+    { "p_median+jerk+magnitude", feature_pipeline_jerk_magnitude },
+    { "p_median+jerk+magnitude_passes", feature_pipeline_jerk_magnitude_passes },
 };
 
 // -----------------------------------------------------------
@@ -173,6 +237,8 @@ void do_tests(void)
 
     printk("Starting tests, ARCH=%s F_CPU=%d MHz\n",
            CONFIG_ARCH, (int)(CONFIG_SYS_CLOCK_HW_CYCLES_PER_SEC / 1000000));
+
+    tables_init();
     for (i = 0; i < sizeof(tests) / sizeof(*tests); ++i) {
         test(&tests[i]);
 #if CONTIKI_TARGET_SRF06_CC26XX
@@ -60,6 +60,22 @@
 // Make the windows to have 50% overlap
 #define PERIODIC_COMPUTATION_WINDOW_SIZE (TIME_WINDOW_SIZE / 2)
 
+// The number of windows processed in parallel by the cross-window kernels
+// (window-lanes.h and `fft_lanes()`)
+#ifndef WINDOW_LANES
+#define WINDOW_LANES 16
+#endif
+
+// Take the square roots of energy, std, and correlation in fixed point (sqrt.h),
+// also in the float features. For the targets without a FPU, where `sqrtf` is emulated.
+#ifndef INTEGER_SQRT
+#if CONTIKI_TARGET_Z1
+#define INTEGER_SQRT 1
+#else
+#define INTEGER_SQRT 0
+#endif
+#endif
+
 #define VERY_FAST 0
 #define FAST 1
 #define MODERATE 2
@@ -71,7 +87,23 @@
 #define DO_LOG_OUTPUT 0
 #endif
 
-#if DO_LOG_OUTPUT
+// If this is set to true, repetitions are not done either;
+// the output is stored in memory, see output-sink.h
+#ifndef DO_SINK_OUTPUT
+#define DO_SINK_OUTPUT 0
+#endif
+
+// Set for the library (libfeatures*.c): then there are no global results,
+// as the file is included in several translation units
+#ifndef FEATURES_LIBRARY
+#define FEATURES_LIBRARY 0
+#endif
+
+#if DO_LOG_OUTPUT && DO_SINK_OUTPUT
+#error DO_LOG_OUTPUT and DO_SINK_OUTPUT are mutually exclusive
+#endif
+
+#if DO_LOG_OUTPUT || DO_SINK_OUTPUT
 
 static const int NUM_REPETITIONS[4] = {
     [VERY_FAST] = 1,
@@ -104,18 +136,39 @@ static const int NUM_REPETITIONS[4] = {
     [SLOW] = 10
 };
 #endif
-#endif // DO_LOG_OUTPUT
+#endif // DO_LOG_OUTPUT || DO_SINK_OUTPUT
 
 // -----------------------------------------------------------
 
-#if DO_LOG_OUTPUT
+// Use the buffered formatter in output-format.h for the logged output instead of printk
+#ifndef FAST_TEXT_OUTPUT
+#define FAST_TEXT_OUTPUT 0
+#endif
+
+#if DO_SINK_OUTPUT
+#include "output-sink.h"
+#endif
+
+#if DO_LOG_OUTPUT && FAST_TEXT_OUTPUT
+#include "output-format.h"
+#endif
+
+#if DO_LOG_OUTPUT && FAST_TEXT_OUTPUT
+#define LOG(...) output_format_log(__VA_ARGS__)
+#elif DO_LOG_OUTPUT
 #define LOG(...) printk(__VA_ARGS__)
+#elif DO_SINK_OUTPUT
+#define LOG(...) OUTPUT_SINK_LOG(__VA_ARGS__, 0)
 #else
 #define LOG(...)
 #endif
 
-#if DO_LOG_OUTPUT
+#if DO_LOG_OUTPUT && FAST_TEXT_OUTPUT
+#define OUTPUT(x, variable, format) OUTPUT_FORMAT(x, format)
+#elif DO_LOG_OUTPUT
 #define OUTPUT(x, variable, format) printk(format, x)
+#elif DO_SINK_OUTPUT
+#define OUTPUT(x, variable, format) output_sink_put(x, format[1] == 'f')
 #else
 #define OUTPUT(x, variable, format) variable = x
 #endif
@@ -124,6 +177,24 @@ static const int NUM_REPETITIONS[4] = {
 #define OUTPUT_IL(x, variable) OUTPUT(x, variable, "%lld ")
 #define OUTPUT_F(x, variable)  OUTPUT(x, variable, "%f ")
 
+// Output a whole buffer of results, one per line.
+// Unless logging or collecting, only the last one is stored in the variable.
+#if DO_LOG_OUTPUT || DO_SINK_OUTPUT
+#define OUTPUT_BLOCK(buf, n, variable, format)  \
+    do {                                        \
+        int _k;                                 \
+        for (_k = 0; _k < (n); ++_k) {          \
+            OUTPUT((buf)[_k], variable, format); \
+            LOG("\n");                          \
+        }                                       \
+    } while (0)
+#else
+#define OUTPUT_BLOCK(buf, n, variable, format) variable = (buf)[(n) - 1]
+#endif
+
+#define OUTPUT_BLOCK_I(buf, n, variable) OUTPUT_BLOCK(buf, n, variable, "%d ")
+#define OUTPUT_BLOCK_F(buf, n, variable) OUTPUT_BLOCK(buf, n, variable, "%f ")
+
 #define NUM_AXIS 3
 
 // -----------------------------------------------------------
@@ -140,19 +211,50 @@ typedef struct {
     volatile float v[NUM_AXIS];
 } result_f_t;
 
+// the bins of a histogram over the int8 values must be able to hold the whole window
+#if TIME_WINDOW_SIZE < 256
+typedef uint8_t histogram_bin_t;
+#else
+typedef uint16_t histogram_bin_t;
+#endif
+
+// The sums over a window. The values are int8, so the squares and the products
+// are at most 2^14 and the signed 32-bit sums hold windows of fewer than 2^17
+// samples; the longer windows need 64-bit sums.
+#ifndef WINDOW_WIDE_SUMS
+#define WINDOW_WIDE_SUMS (TIME_WINDOW_SIZE >= (1 << 17))
+#endif
+
+#if WINDOW_WIDE_SUMS
+typedef int64_t window_sum_t;
+typedef uint64_t window_sqsum_t;
+#else
+typedef int32_t window_sum_t;
+typedef uint32_t window_sqsum_t;
+#endif
+
 // -----------------------------------------------------------
 
-// the total number of samples
-#define NSAMPLES ((unsigned int)(sizeof(data) / sizeof(*data)))
+// the total number of samples; can be defined by the application,
+// e.g. when `data` points to one segment of the input at a time.
+// It is signed, so the loops over the windows, `i <= NSAMPLES - TIME_WINDOW_SIZE`,
+// do not run at all when there are fewer samples than a window.
+#ifndef NSAMPLES
+#define NSAMPLES ((int)(sizeof(data) / sizeof(*data)))
+#endif
 
 // -----------------------------------------------------------
 
+#if !FEATURES_LIBRARY
+
 typedef void (*feature_function)(int);
 
 // the result of the accel calculations is stored here
 volatile result_i_t result_i;
 volatile result_f_t result_f;
 
+#endif
+
 // -----------------------------------------------------------
 
 
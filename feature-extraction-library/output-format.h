@@ -0,0 +1,223 @@
+/*
+ * Copyright (c) 2019, Institute of Electronics and Computer Science (EDI)
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * Author: Atis Elsts
+ */
+
+/*
+ * File: output-format.h
+ * Fast text output of the results, enabled with FAST_TEXT_OUTPUT.
+ *
+ * The values are formatted directly into a large buffer, which is written
+ * to the standard output with `write()` when full, and by `output_format_flush()`.
+ * The text is the same as `printf("%d ")`, `printf("%lld ")` and `printf("%f ")`
+ * would produce in the C locale, including the rounding of the floats:
+ * they are converted to fixed point exactly, and rounded half to even.
+ * Values that are too large for that (and infinities and NaNs) are passed to `snprintf`.
+ *
+ * The output of `printf` is flushed before the buffer is written,
+ * so the two can be mixed as long as `output_format_flush()` is called at the end.
+ */
+
+#ifndef OUTPUT_FORMAT_H
+#define OUTPUT_FORMAT_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdarg.h>
+#include <string.h>
+#include <math.h>
+#include <unistd.h>
+
+#ifndef OUTPUT_FORMAT_BUFFER_SIZE
+#define OUTPUT_FORMAT_BUFFER_SIZE (64 * 1024)
+#endif
+
+// the longest text that is added at once: a `%f` double has up to 309 + 8 characters
+#define OUTPUT_FORMAT_MAX_ITEM 512
+
+#if OUTPUT_FORMAT_BUFFER_SIZE < 2 * OUTPUT_FORMAT_MAX_ITEM
+#error OUTPUT_FORMAT_BUFFER_SIZE is too small
+#endif
+
+static char output_format_buffer[OUTPUT_FORMAT_BUFFER_SIZE];
+static unsigned output_format_length;
+
+static const char output_format_digits[200] =
+    "00010203040506070809"
+    "10111213141516171819"
+    "20212223242526272829"
+    "30313233343536373839"
+    "40414243444546474849"
+    "50515253545556575859"
+    "60616263646566676869"
+    "70717273747576777879"
+    "80818283848586878889"
+    "90919293949596979899";
+
+// -----------------------------------------------------------
+
+static void output_format_flush(void)
+{
+    const char *p = output_format_buffer;
+    unsigned n = output_format_length;
+
+    // keep the order with anything printed before
+    fflush(stdout);
+    while (n > 0) {
+        ssize_t written = write(STDOUT_FILENO, p, n);
+        if (written <= 0) {
+            break;
+        }
+        p += written;
+        n -= written;
+    }
+    output_format_length = 0;
+}
+
+// Make sure that there is space for one more item
+static inline char *output_format_reserve(void)
+{
+    if (output_format_length > OUTPUT_FORMAT_BUFFER_SIZE - OUTPUT_FORMAT_MAX_ITEM) {
+        output_format_flush();
+    }
+    return &output_format_buffer[output_format_length];
+}
+
+// Write the decimal digits of `x` ending just before `end`; returns the start
+static inline char *output_format_digits_u64(char *end, uint64_t x)
+{
+    while (x >= 100) {
+        unsigned d = (x % 100) * 2;
+        x /= 100;
+        end -= 2;
+        end[0] = output_format_digits[d];
+        end[1] = output_format_digits[d + 1];
+    }
+    if (x >= 10) {
+        end -= 2;
+        end[0] = output_format_digits[x * 2];
+        end[1] = output_format_digits[x * 2 + 1];
+    } else {
+        *--end = '0' + x;
+    }
+    return end;
+}
+
+// -----------------------------------------------------------
+
+// Same as printf("%lld ", x)
+static inline void output_format_i(long long x)
+{
+    char tmp[24];
+    char *end = tmp + sizeof(tmp);
+    char *p = output_format_reserve();
+    uint64_t u = x < 0 ? -(uint64_t)x : (uint64_t)x;
+    char *start = output_format_digits_u64(end, u);
+    if (x < 0) {
+        *--start = '-';
+    }
+    memcpy(p, start, end - start);
+    p[end - start] = ' ';
+    output_format_length += end - start + 1;
+}
+
+// Same as printf("%f ", x)
+static inline void output_format_f(double x)
+{
+    char tmp[32];
+    char *end = tmp + sizeof(tmp);
+    char *p = output_format_reserve();
+    char *start;
+    int exponent;
+    uint64_t mantissa, fixed;
+    double a = fabs(x);
+
+    // the value in millionths must fit in 64 bits
+    if (!(a < 1e13)) {
+        output_format_length += snprintf(p, OUTPUT_FORMAT_MAX_ITEM, "%f ", x);
+        return;
+    }
+
+    // a = mantissa * 2^exponent exactly, with a 53-bit mantissa
+    mantissa = (uint64_t)ldexp(frexp(a, &exponent), 53);
+    exponent -= 53;
+
+    if (exponent >= 0) {
+        // an integer
+        fixed = (mantissa << exponent) * 1000000;
+    } else if (exponent >= -120) {
+        // round mantissa * 10^6 / 2^-exponent half to even
+        unsigned __int128 scaled = (unsigned __int128)mantissa * 1000000;
+        unsigned __int128 half = (unsigned __int128)1 << (-exponent - 1);
+        unsigned __int128 rest = scaled & ((half << 1) - 1);
+        fixed = (uint64_t)(scaled >> -exponent);
+        if (rest > half || (rest == half && (fixed & 1))) {
+            fixed++;
+        }
+    } else {
+        // less than 2^-67
+        fixed = 0;
+    }
+
+    // the fraction, always 6 digits
+    start = output_format_digits_u64(end, fixed % 1000000 + 1000000) + 1;
+    *--start = '.';
+    start = output_format_digits_u64(start, fixed / 1000000);
+    if (signbit(x)) {
+        *--start = '-';
+    }
+    memcpy(p, start, end - start);
+    p[end - start] = ' ';
+    output_format_length += end - start + 1;
+}
+
+// Used for LOG(), with the `printf` formats; the line ends are the most common
+static void output_format_log(const char *format, ...)
+{
+    va_list args;
+    int n;
+
+    if (format[0] == '\n' && format[1] == '\0') {
+        output_format_reserve()[0] = '\n';
+        output_format_length++;
+        return;
+    }
+
+    va_start(args, format);
+    n = vsnprintf(output_format_reserve(), OUTPUT_FORMAT_MAX_ITEM, format, args);
+    va_end(args);
+    if (n > 0) {
+        output_format_length += min(n, OUTPUT_FORMAT_MAX_ITEM - 1);
+    }
+}
+
+// The type of the value is known from the format
+#define OUTPUT_FORMAT(x, format) \
+    ((format)[1] == 'f' ? output_format_f(x) : output_format_i(x))
+
+#endif // OUTPUT_FORMAT_H
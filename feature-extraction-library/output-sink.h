@@ -0,0 +1,236 @@
+/*
+ * Copyright (c) 2019, Institute of Electronics and Computer Science (EDI)
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * Author: Atis Elsts
+ */
+
+/*
+ * File: output-sink.h
+ * Collect the outputs of the features in memory, as columns, instead of printing them.
+ *
+ * Enabled with DO_SINK_OUTPUT. Then the OUTPUT_* macros append the values
+ * to the current column, and `LOG("\n")` marks the end of a window (a row).
+ * There is one column for each feature and axis, started by `output_sink_begin()`;
+ * it has `values_per_row` values for each of its `num_rows` windows. When the input
+ * is made of separate segments (e.g. recordings), `output_sink_begin_segment()` starts
+ * a column for each of them, named by `segment`.
+ *
+ * All memory is preallocated: OUTPUT_SINK_MAX_CELLS values in total,
+ * in at most OUTPUT_SINK_MAX_COLUMNS columns. The values that do not fit are
+ * dropped, and `output_sink_overflow` is set.
+ *
+ * On hosts, `output_sink_write()` dumps everything with a single `writev()`:
+ *   output_sink_header_t,
+ *   output_sink_column_t[num_columns],
+ *   double[num_cells]
+ * in the native byte order. The values of column `i` are the cells starting
+ * from `columns[i].offset`, row by row.
+ */
+
+#ifndef OUTPUT_SINK_H
+#define OUTPUT_SINK_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#ifndef OUTPUT_SINK_MAX_CELLS
+#define OUTPUT_SINK_MAX_CELLS (256 * 1024)
+#endif
+
+#ifndef OUTPUT_SINK_MAX_COLUMNS
+#define OUTPUT_SINK_MAX_COLUMNS 256
+#endif
+
+#define OUTPUT_SINK_NAME_LEN    32
+#define OUTPUT_SINK_SEGMENT_LEN 16
+#define OUTPUT_SINK_MAGIC       0x54414546 // "FEAT"
+#define OUTPUT_SINK_VERSION     2
+
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t num_columns;
+    uint32_t num_cells;
+} output_sink_header_t;
+
+typedef struct {
+    char name[OUTPUT_SINK_NAME_LEN];
+    char segment[OUTPUT_SINK_SEGMENT_LEN]; // empty if the input is a single segment
+    uint8_t axis;
+    uint8_t is_float;
+    uint16_t values_per_row;
+    uint32_t num_rows;
+    uint32_t offset;
+    uint32_t num_values;
+} output_sink_column_t;
+
+static double output_sink_cells[OUTPUT_SINK_MAX_CELLS];
+static output_sink_column_t output_sink_columns[OUTPUT_SINK_MAX_COLUMNS];
+static uint32_t output_sink_num_cells;
+static uint32_t output_sink_num_columns;
+static uint32_t output_sink_row_start;
+static bool output_sink_overflow;
+
+// -----------------------------------------------------------
+
+static inline void output_sink_reset(void)
+{
+    output_sink_num_cells = 0;
+    output_sink_num_columns = 0;
+    output_sink_overflow = false;
+}
+
+static inline output_sink_column_t *output_sink_current(void)
+{
+    return output_sink_num_columns ? &output_sink_columns[output_sink_num_columns - 1] : NULL;
+}
+
+// Start the column for a feature on an axis and a segment of the input; `segment` can be NULL
+static inline void output_sink_begin_segment(const char *name, const char *segment, int axis)
+{
+    output_sink_column_t *c;
+    if (output_sink_num_columns >= OUTPUT_SINK_MAX_COLUMNS) {
+        output_sink_overflow = true;
+        return;
+    }
+    c = &output_sink_columns[output_sink_num_columns++];
+    memset(c, 0, sizeof(*c));
+    strncpy(c->name, name, sizeof(c->name) - 1);
+    if (segment) {
+        strncpy(c->segment, segment, sizeof(c->segment) - 1);
+    }
+    c->axis = axis;
+    c->offset = output_sink_num_cells;
+    output_sink_row_start = output_sink_num_cells;
+}
+
+// Start the column for a feature on an axis
+static inline void output_sink_begin(const char *name, int axis)
+{
+    output_sink_begin_segment(name, NULL, axis);
+}
+
+static inline void output_sink_put(double x, bool is_float)
+{
+    output_sink_column_t *c = output_sink_current();
+    if (c == NULL || output_sink_num_cells >= OUTPUT_SINK_MAX_CELLS) {
+        output_sink_overflow = true;
+        return;
+    }
+    output_sink_cells[output_sink_num_cells++] = x;
+    c->num_values++;
+    c->is_float |= is_float;
+}
+
+// End a window
+static inline void output_sink_row(void)
+{
+    output_sink_column_t *c = output_sink_current();
+    uint32_t n = output_sink_num_cells - output_sink_row_start;
+    if (c == NULL || n == 0) {
+        return;
+    }
+    if (c->num_rows == 0) {
+        c->values_per_row = n;
+    }
+    c->num_rows++;
+    output_sink_row_start = output_sink_num_cells;
+}
+
+// Only the end of line is of interest in the logs
+static inline void output_sink_log(const char *format)
+{
+    if (format[0] == '\n' && format[1] == '\0') {
+        output_sink_row();
+    }
+}
+
+#define OUTPUT_SINK_LOG(format, ...) output_sink_log(format)
+
+// -----------------------------------------------------------
+
+#if defined(__unix__) || defined(__APPLE__)
+
+#include <sys/uio.h>
+#include <unistd.h>
+#include <fcntl.h>
+
+// Write the header, the columns and the cells with a single system call
+// (more only if the write is partial); returns false on error
+static inline bool output_sink_write(int fd)
+{
+    output_sink_header_t header = {
+        .magic = OUTPUT_SINK_MAGIC,
+        .version = OUTPUT_SINK_VERSION,
+        .num_columns = output_sink_num_columns,
+        .num_cells = output_sink_num_cells,
+    };
+    struct iovec iov[3] = {
+        { &header, sizeof(header) },
+        { output_sink_columns, output_sink_num_columns * sizeof(output_sink_column_t) },
+        { output_sink_cells, output_sink_num_cells * sizeof(double) },
+    };
+    struct iovec *v = iov;
+    int count = 3;
+
+    if (output_sink_overflow) {
+        return false;
+    }
+
+    while (count > 0) {
+        ssize_t written = writev(fd, v, count);
+        if (written < 0) {
+            return false;
+        }
+        while (count > 0 && (size_t)written >= v->iov_len) {
+            written -= v->iov_len;
+            v++;
+            count--;
+        }
+        if (count > 0) {
+            v->iov_base = (char *)v->iov_base + written;
+            v->iov_len -= written;
+        }
+    }
+    return true;
+}
+
+static inline bool output_sink_save(const char *filename)
+{
+    bool ok;
+    int fd = open(filename, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        return false;
+    }
+    ok = output_sink_write(fd);
+    return close(fd) == 0 && ok;
+}
+
+#endif // __unix__
+
+#endif // OUTPUT_SINK_H
@@ -46,27 +46,72 @@
 #include "adaptation.h"
 #endif
 
+// Print the results, unless they are collected in memory and saved in a binary file
+#if !DO_SINK_OUTPUT
 #define DO_LOG_OUTPUT 1
+#endif
+
+// Format the text with output-format.h on POSIX hosts
+#if !defined(FAST_TEXT_OUTPUT) && (defined(__unix__) || defined(__APPLE__)) && !CONTIKI
+#define FAST_TEXT_OUTPUT 1
+#endif
+
+// `data` is the current segment, see below
+#define NSAMPLES data_length
+// a column for each feature, axis and segment
+#ifndef OUTPUT_SINK_MAX_COLUMNS
+#define OUTPUT_SINK_MAX_COLUMNS 1024
+#endif
 #include "main.h"
 
+#ifndef OUTPUT_SINK_FILE
+#define OUTPUT_SINK_FILE "features.bin"
+#endif
+
 // -----------------------------------------------------------
 
-// the input data
-const accel_t data[] =
-{
+// the input data: the recordings are separate segments,
+// and the windows of the features do not cross the boundaries between them
+static const accel_t recording_00001[] = {
 #include "sample-data/00001.c"
-    ,
+};
+static const accel_t recording_00002[] = {
 #include "sample-data/00002.c"
-    ,
+};
+static const accel_t recording_00003[] = {
 #include "sample-data/00003.c"
-    ,
+};
+static const accel_t recording_00004[] = {
 #include "sample-data/00004.c"
-    ,
+};
+static const accel_t recording_00005[] = {
 #include "sample-data/00005.c"
-    ,
+};
+static const accel_t recording_00007[] = {
 #include "sample-data/00007.c"
 };
 
+typedef struct {
+    const char *name;
+    const accel_t *samples;
+    unsigned num_samples;
+} segment_t;
+
+#define SEGMENT(name, samples) { name, samples, sizeof(samples) / sizeof(*samples) }
+
+static const segment_t segments[] = {
+    SEGMENT("00001", recording_00001),
+    SEGMENT("00002", recording_00002),
+    SEGMENT("00003", recording_00003),
+    SEGMENT("00004", recording_00004),
+    SEGMENT("00005", recording_00005),
+    SEGMENT("00007", recording_00007),
+};
+
+// the features run on one segment at a time
+const accel_t *data;
+int data_length;
+
 // -----------------------------------------------------------
 
 #include "features-time-basic.c"
@@ -91,7 +136,19 @@ void test(const test_t *t)
     LOG("Start feature: %s\n", t->name);
     // iterate for each axis
     for (axis = 0; axis < NUM_AXIS; ++axis) {
-        t->f(axis);
+        // and each segment, in a column of its own; the ones shorter than a window have no results
+        for (i = 0; i < sizeof(segments) / sizeof(*segments); ++i) {
+            if (segments[i].num_samples < TIME_WINDOW_SIZE) {
+                continue;
+            }
+            data = segments[i].samples;
+            data_length = segments[i].num_samples;
+#if DO_SINK_OUTPUT
+            output_sink_begin_segment(t->name, segments[i].name, axis);
+#endif
+            LOG("segment=%s\n", segments[i].name);
+            t->f(axis);
+        }
     }
 }
 
@@ -131,10 +188,22 @@ void do_tests(void)
     printk("Starting tests, ARCH=%s F_CPU=%d MHz\n",
            CONFIG_ARCH, (int)(CONFIG_SYS_CLOCK_HW_CYCLES_PER_SEC / 1000000));
 
+    tables_init();
+
     for (i = 0; i < sizeof(tests) / sizeof(*tests); ++i) {
         test(&tests[i]);
     }
 
+#if DO_LOG_OUTPUT && FAST_TEXT_OUTPUT
+    output_format_flush();
+#endif
+
+#if DO_SINK_OUTPUT
+    if (!output_sink_save(OUTPUT_SINK_FILE)) {
+        printk("Failed to save the results in %s\n", OUTPUT_SINK_FILE);
+    }
+#endif
+
     printk("Done!\n");
 }
 
@@ -0,0 +1,487 @@
+/*
+ * Copyright (c) 2019, Institute of Electronics and Computer Science (EDI)
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * Author: Atis Elsts
+ */
+
+/*
+ * File: pipeline.c
+ * Transforms and filters chained together with windowed features.
+ *
+ * A pipeline is a list of stages, for example:
+ *     median filter -> jerk -> magnitude -> mean, std
+ * The vector stages (median, jerk) map the 3-axis samples to 3-axis samples,
+ * the last stage reduces them to a single series (one axis, magnitude or L1 norm),
+ * and the features are then computed on that series in the usual windows.
+ *
+ * The input is processed in blocks of PIPELINE_BLOCK_SIZE samples. Each block
+ * goes through all of the stages while it is in a small buffer on the stack,
+ * so the intermediate series are never stored in full.
+ * Samples can be pushed in chunks of any size; the state of the filters and the
+ * partially filled windows is kept between the calls.
+ *
+ * The windows overlap, so the sums are accumulated per hop
+ * (PERIODIC_COMPUTATION_WINDOW_SIZE samples) and each window is the combination
+ * of its last TIME_WINDOW_SIZE / PERIODIC_COMPUTATION_WINDOW_SIZE hops.
+ * That way each sample is added just once, regardless of the overlap.
+ */
+
+// -----------------------------------------------------------
+
+#ifndef PIPELINE_BLOCK_SIZE
+#define PIPELINE_BLOCK_SIZE 64
+#endif
+
+#ifndef PIPELINE_MAX_STAGES
+#define PIPELINE_MAX_STAGES 8
+#endif
+
+#define PIPELINE_HOPS (TIME_WINDOW_SIZE / PERIODIC_COMPUTATION_WINDOW_SIZE)
+
+#if PIPELINE_HOPS * PERIODIC_COMPUTATION_WINDOW_SIZE != TIME_WINDOW_SIZE
+#error TIME_WINDOW_SIZE must be a multiple of PERIODIC_COMPUTATION_WINDOW_SIZE
+#endif
+
+// The maximal number of windows completed by pushing `n` samples
+#define PIPELINE_MAX_RESULTS(n) ((n) / PERIODIC_COMPUTATION_WINDOW_SIZE + 1)
+
+typedef enum {
+    // vector -> vector
+    PIPELINE_MEDIAN,   // 3-sample median filter, same as `filter_median`
+    PIPELINE_JERK,     // difference of consecutive samples
+    // vector -> series; one of these must be the last stage
+    PIPELINE_AXIS,     // a single axis
+    PIPELINE_MAGNITUDE,
+    PIPELINE_MAGNITUDE_SQ,
+    PIPELINE_L1NORM,
+} pipeline_stage_type_t;
+
+// The features, can be combined
+#define PIPELINE_FEATURE_MEAN   (1u << 0)
+#define PIPELINE_FEATURE_ENERGY (1u << 1) // root mean square
+#define PIPELINE_FEATURE_STD    (1u << 2)
+#define PIPELINE_FEATURE_MIN    (1u << 3)
+#define PIPELINE_FEATURE_MAX    (1u << 4)
+
+// The differences of int8 samples do not fit in int8, so the vectors are wider
+typedef struct {
+    int16_t v[NUM_AXIS];
+} pipeline_vector_t;
+
+typedef struct {
+    uint8_t type;
+    uint8_t axis;    // for PIPELINE_AXIS
+    uint8_t primed;  // the number of previous samples seen, up to 2
+    pipeline_vector_t prev[2];
+} pipeline_stage_t;
+
+typedef struct {
+    float sum;
+    float sqsum;
+    float min;
+    float max;
+} pipeline_partial_t;
+
+typedef struct {
+    float mean;
+    float energy;
+    float std;
+    float min;
+    float max;
+} pipeline_result_t;
+
+typedef struct {
+    pipeline_stage_t stages[PIPELINE_MAX_STAGES];
+    uint8_t num_stages;
+    uint8_t features;
+    // the hops of the current window; `hop` is the one being filled
+    pipeline_partial_t partials[PIPELINE_HOPS];
+    uint8_t hop;
+    uint8_t num_full_hops;
+    uint16_t hop_count;
+} pipeline_t;
+
+// -----------------------------------------------------------
+
+static void pipeline_partial_reset(pipeline_partial_t *p)
+{
+    p->sum = 0;
+    p->sqsum = 0;
+    p->min = INFINITY;
+    p->max = -INFINITY;
+}
+
+void pipeline_init(pipeline_t *p, unsigned features)
+{
+    int i;
+    memset(p, 0, sizeof(*p));
+    p->features = features;
+    for (i = 0; i < PIPELINE_HOPS; ++i) {
+        pipeline_partial_reset(&p->partials[i]);
+    }
+}
+
+// Add a stage at the end; returns false if the stage does not fit.
+bool pipeline_add(pipeline_t *p, pipeline_stage_type_t type, int axis)
+{
+    if (p->num_stages >= PIPELINE_MAX_STAGES) {
+        return false;
+    }
+    // nothing can follow the stage that reduces the vectors to a series
+    if (p->num_stages > 0 && p->stages[p->num_stages - 1].type >= PIPELINE_AXIS) {
+        return false;
+    }
+    if (type == PIPELINE_AXIS && (axis < 0 || axis >= NUM_AXIS)) {
+        return false;
+    }
+    p->stages[p->num_stages].type = type;
+    p->stages[p->num_stages].axis = axis;
+    p->num_stages++;
+    return true;
+}
+
+// Clear the state of the filters and the windows, but keep the stages
+void pipeline_reset(pipeline_t *p)
+{
+    int i;
+    for (i = 0; i < p->num_stages; ++i) {
+        p->stages[i].primed = 0;
+    }
+    for (i = 0; i < PIPELINE_HOPS; ++i) {
+        pipeline_partial_reset(&p->partials[i]);
+    }
+    p->hop = 0;
+    p->num_full_hops = 0;
+    p->hop_count = 0;
+}
+
+// -----------------------------------------------------------
+// The vector stages. These return the number of samples output,
+// which is less than the number input while the filter is being primed.
+//
+// The buffers have PIPELINE_HISTORY free entries in front of the samples,
+// where the stages put their samples from the previous block, so that
+// the filters run over contiguous arrays. The axes are not treated separately:
+// the samples are flat arrays of NUM_AXIS values, which vectorizes well.
+
+#define PIPELINE_HISTORY 2
+
+static inline int pipeline_median3(int a, int b, int c)
+{
+    return max(min(a, b), min(max(a, b), c));
+}
+
+static int pipeline_median(pipeline_stage_t *s, pipeline_vector_t in[],
+                           pipeline_vector_t out[], int n)
+{
+    const int h = s->primed;
+    const int total = h + n;
+    int i, num_out;
+
+    memcpy(&in[-h], s->prev, h * sizeof(pipeline_vector_t));
+    num_out = max(total - 2, 0);
+    {
+        const int16_t *restrict x = in[-h].v;
+        int16_t *restrict y = out[0].v;
+        for (i = 0; i < num_out * NUM_AXIS; ++i) {
+            y[i] = pipeline_median3(x[i], x[i + NUM_AXIS], x[i + 2 * NUM_AXIS]);
+        }
+    }
+    s->primed = min(total, 2);
+    memcpy(s->prev, &in[n - s->primed], s->primed * sizeof(pipeline_vector_t));
+    return num_out;
+}
+
+static int pipeline_jerk(pipeline_stage_t *s, pipeline_vector_t in[],
+                         pipeline_vector_t out[], int n)
+{
+    const int h = s->primed;
+    const int total = h + n;
+    int i, num_out;
+
+    memcpy(&in[-h], s->prev, h * sizeof(pipeline_vector_t));
+    num_out = max(total - 1, 0);
+    {
+        const int16_t *restrict x = in[-h].v;
+        int16_t *restrict y = out[0].v;
+        for (i = 0; i < num_out * NUM_AXIS; ++i) {
+            y[i] = x[i + NUM_AXIS] - x[i];
+        }
+    }
+    s->primed = min(total, 1);
+    memcpy(s->prev, &in[n - s->primed], s->primed * sizeof(pipeline_vector_t));
+    return num_out;
+}
+
+// -----------------------------------------------------------
+// The reducing stages. The loops are over full blocks, so they are vectorized.
+
+static void pipeline_reduce(const pipeline_stage_t *s,
+                            const pipeline_vector_t *restrict in,
+                            float *restrict out)
+{
+    int i;
+    switch (s->type) {
+    case PIPELINE_AXIS:
+        for (i = 0; i < PIPELINE_BLOCK_SIZE; ++i) {
+            out[i] = in[i].v[s->axis];
+        }
+        break;
+    case PIPELINE_MAGNITUDE:
+    case PIPELINE_MAGNITUDE_SQ:
+        for (i = 0; i < PIPELINE_BLOCK_SIZE; ++i) {
+            int x = in[i].v[0];
+            int y = in[i].v[1];
+            int z = in[i].v[2];
+            out[i] = x * x + y * y + z * z;
+        }
+        if (s->type == PIPELINE_MAGNITUDE) {
+            for (i = 0; i < PIPELINE_BLOCK_SIZE; i += TRANSFORM_BLOCK_SIZE) {
+                transform_block_sqrt(&out[i]);
+            }
+        }
+        break;
+    case PIPELINE_L1NORM:
+    default:
+        for (i = 0; i < PIPELINE_BLOCK_SIZE; ++i) {
+            out[i] = abs(in[i].v[0]) + abs(in[i].v[1]) + abs(in[i].v[2]);
+        }
+        break;
+    }
+}
+
+#if PIPELINE_BLOCK_SIZE % TRANSFORM_BLOCK_SIZE
+#error PIPELINE_BLOCK_SIZE must be a multiple of TRANSFORM_BLOCK_SIZE
+#endif
+
+// -----------------------------------------------------------
+
+static void pipeline_window(const pipeline_t *p, pipeline_result_t *r)
+{
+    float sum = 0, sqsum = 0, lo = INFINITY, hi = -INFINITY;
+    int i;
+    for (i = 0; i < PIPELINE_HOPS; ++i) {
+        sum += p->partials[i].sum;
+        sqsum += p->partials[i].sqsum;
+        lo = min(lo, p->partials[i].min);
+        hi = max(hi, p->partials[i].max);
+    }
+    float mean = sum / TIME_WINDOW_SIZE;
+    float squared_mean = sqsum / TIME_WINDOW_SIZE;
+    float variance = squared_mean - mean * mean;
+    r->mean = mean;
+    r->energy = sqrtf(squared_mean);
+    r->std = variance > 0 ? sqrtf(variance) : 0;
+    r->min = lo;
+    r->max = hi;
+}
+
+// Accumulate a series into the hops; returns the number of windows completed
+static int pipeline_accumulate(pipeline_t *p, const float x[], int n,
+                               pipeline_result_t results[])
+{
+    int i = 0, num_results = 0;
+    const bool extremes = p->features & (PIPELINE_FEATURE_MIN | PIPELINE_FEATURE_MAX);
+
+    while (i < n) {
+        pipeline_partial_t *part = &p->partials[p->hop];
+        int len = min(n - i, PERIODIC_COMPUTATION_WINDOW_SIZE - p->hop_count);
+        float sum = 0, sqsum = 0;
+        int j;
+        for (j = 0; j < len; ++j) {
+            sum += x[i + j];
+            sqsum += x[i + j] * x[i + j];
+        }
+        part->sum += sum;
+        part->sqsum += sqsum;
+        if (extremes) {
+            float lo = part->min, hi = part->max;
+            for (j = 0; j < len; ++j) {
+                lo = min(lo, x[i + j]);
+                hi = max(hi, x[i + j]);
+            }
+            part->min = lo;
+            part->max = hi;
+        }
+        i += len;
+        p->hop_count += len;
+
+        if (p->hop_count == PERIODIC_COMPUTATION_WINDOW_SIZE) {
+            // the hop is full
+            if (p->num_full_hops < PIPELINE_HOPS) {
+                p->num_full_hops++;
+            }
+            if (p->num_full_hops == PIPELINE_HOPS) {
+                pipeline_window(p, &results[num_results++]);
+            }
+            // the oldest hop is reused for the next one
+            p->hop = (p->hop + 1) % PIPELINE_HOPS;
+            p->hop_count = 0;
+            pipeline_partial_reset(&p->partials[p->hop]);
+        }
+    }
+    return num_results;
+}
+
+// -----------------------------------------------------------
+
+// Push `n` samples; returns the number of windows completed, stored in `results`,
+// which must have space for PIPELINE_MAX_RESULTS(n) of them.
+int pipeline_process(pipeline_t *p, const accel_t in[], int n, pipeline_result_t results[])
+{
+    pipeline_vector_t buffer[2][PIPELINE_HISTORY + PIPELINE_BLOCK_SIZE];
+    float series[PIPELINE_BLOCK_SIZE];
+    int i, s, num_results = 0;
+
+    if (p->num_stages == 0 || p->stages[p->num_stages - 1].type < PIPELINE_AXIS) {
+        // not a complete pipeline
+        return 0;
+    }
+
+    for (i = 0; i < n; i += PIPELINE_BLOCK_SIZE) {
+        int len = min(n - i, PIPELINE_BLOCK_SIZE);
+        pipeline_vector_t *current = &buffer[0][PIPELINE_HISTORY];
+        pipeline_vector_t *next = &buffer[1][PIPELINE_HISTORY];
+        int j;
+
+        {
+            const int8_t *restrict x = in[i].v;
+            int16_t *restrict y = current[0].v;
+            for (j = 0; j < len * NUM_AXIS; ++j) {
+                y[j] = x[j];
+            }
+        }
+
+        for (s = 0; s < p->num_stages - 1; ++s) {
+            pipeline_stage_t *stage = &p->stages[s];
+            pipeline_vector_t *t;
+            if (stage->type == PIPELINE_MEDIAN) {
+                len = pipeline_median(stage, current, next, len);
+            } else {
+                len = pipeline_jerk(stage, current, next, len);
+            }
+            t = current;
+            current = next;
+            next = t;
+        }
+
+        // the reducing stage always works on a full block
+        memset(&current[len], 0, (PIPELINE_BLOCK_SIZE - len) * sizeof(pipeline_vector_t));
+        pipeline_reduce(&p->stages[p->num_stages - 1], current, series);
+
+        num_results += pipeline_accumulate(p, series, len, &results[num_results]);
+    }
+
+    return num_results;
+}
+
+// -----------------------------------------------------------
+
+void pipeline_output(const pipeline_t *p, const pipeline_result_t *r, int axis)
+{
+    if (p->features & PIPELINE_FEATURE_MEAN) {
+        OUTPUT_F(r->mean, result_f.v[axis]);
+    }
+    if (p->features & PIPELINE_FEATURE_ENERGY) {
+        OUTPUT_F(r->energy, result_f.v[axis]);
+    }
+    if (p->features & PIPELINE_FEATURE_STD) {
+        OUTPUT_F(r->std, result_f.v[axis]);
+    }
+    if (p->features & PIPELINE_FEATURE_MIN) {
+        OUTPUT_F(r->min, result_f.v[axis]);
+    }
+    if (p->features & PIPELINE_FEATURE_MAX) {
+        OUTPUT_F(r->max, result_f.v[axis]);
+    }
+    LOG("\n");
+}
+
+// -----------------------------------------------------------
+
+//
+// Benchmarks: mean and std of the magnitude of the jerk of the median-filtered data,
+// with the pipeline, and with a separate pass for each of the stages.
+// The data is pushed in chunks of PIPELINE_CHUNK_SIZE samples,
+// as it would arrive from a sensor.
+//
+#ifndef PIPELINE_CHUNK_SIZE
+#define PIPELINE_CHUNK_SIZE 50
+#endif
+
+void feature_pipeline_jerk_magnitude(int axis)
+{
+    pipeline_t p;
+    pipeline_result_t results[PIPELINE_MAX_RESULTS(PIPELINE_CHUNK_SIZE)];
+    int i, j;
+
+    LOG("axis=%d\n", axis);
+    pipeline_init(&p, PIPELINE_FEATURE_MEAN | PIPELINE_FEATURE_STD);
+    pipeline_add(&p, PIPELINE_MEDIAN, 0);
+    pipeline_add(&p, PIPELINE_JERK, 0);
+    pipeline_add(&p, PIPELINE_MAGNITUDE, 0);
+
+    for (i = 0; i < NSAMPLES; i += PIPELINE_CHUNK_SIZE) {
+        int n = pipeline_process(&p, &data[i], min(NSAMPLES - i, PIPELINE_CHUNK_SIZE), results);
+        for (j = 0; j < n; ++j) {
+            pipeline_output(&p, &results[j], axis);
+        }
+    }
+}
+
+void feature_pipeline_jerk_magnitude_passes(int axis)
+{
+    static accel_t filtered[NSAMPLES];
+    static float magnitude[NSAMPLES];
+    int i, j;
+
+    LOG("axis=%d\n", axis);
+
+    // pass 1: median filter
+    for (i = 0; i < NSAMPLES - 2; ++i) {
+        for (j = 0; j < NUM_AXIS; ++j) {
+            filtered[i].v[j] = median(data[i].v[j], data[i + 1].v[j], data[i + 2].v[j]);
+        }
+    }
+    // pass 2: jerk and magnitude
+    transform_jerk_magnitude_block(filtered, magnitude, NSAMPLES - 3);
+    // pass 3: features
+    for (i = 0; i <= NSAMPLES - 3 - TIME_WINDOW_SIZE; i += PERIODIC_COMPUTATION_WINDOW_SIZE) {
+        float sum = 0, sqsum = 0;
+        for (j = 0; j < TIME_WINDOW_SIZE; ++j) {
+            sum += magnitude[i + j];
+            sqsum += magnitude[i + j] * magnitude[i + j];
+        }
+        float mean = sum / TIME_WINDOW_SIZE;
+        float variance = sqsum / TIME_WINDOW_SIZE - mean * mean;
+        OUTPUT_F(mean, result_f.v[axis]);
+        OUTPUT_F(variance > 0 ? sqrtf(variance) : 0, result_f.v[axis]);
+        LOG("\n");
+    }
+}
+
+// -----------------------------------------------------------
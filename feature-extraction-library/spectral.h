@@ -0,0 +1,916 @@
+/*
+ * Copyright (c) 2019, Institute of Electronics and Computer Science (EDI)
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * Author: Atis Elsts
+ */
+
+/*
+ * File: spectral.h
+ * Loading of the windows for the float and integer FFT (with the optional
+ * analysis window and detrend), and the spectral features computed from the FFT result.
+ *
+ * Shared by features-frequency.c and the library (libfeatures-spectral.c).
+ */
+
+#ifndef SPECTRAL_H
+#define SPECTRAL_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <math.h>
+#include <string.h>
+#include "main.h"
+#include "tables.h"
+#include "sqrt.h"
+
+// ------------------------------------------
+
+// The following must hold: (#bins - 1) * (2 * divider) == FREQUENCY_WINDOW_SIZE
+#define NUM_FREQUENCY_HISTOGRAM_BINS 9
+#define FREQUENCY_HISTOGRAM_DIVIDER (FREQUENCY_WINDOW_SIZE / 16)
+
+// The bins of the power spectrum, from the DC to the Nyquist frequency
+#define SPECTRAL_NUM_BINS (FREQUENCY_WINDOW_SIZE / 2 + 1)
+
+// The spectral rolloff is the lowest frequency below which this much of the power is
+#ifndef SPECTRAL_ROLLOFF_PERCENT
+#define SPECTRAL_ROLLOFF_PERCENT 85
+#endif
+
+// The powers that are taken as equal to the highest one by the dominant frequency,
+// relative to it
+#ifndef SPECTRAL_DOMINANT_EPSILON
+#define SPECTRAL_DOMINANT_EPSILON 1e-4f
+#endif
+
+// The band ratio is the fraction of the power in the bins 1 .. SPECTRAL_BAND_SPLIT,
+// by default up to 3 Hz, where most of the power of walking is
+#ifndef SPECTRAL_BAND_SPLIT
+#define SPECTRAL_BAND_SPLIT (FREQUENCY_WINDOW_SIZE * 3 / SAMPLING_HZ)
+#endif
+
+// ------------------------------------------
+
+//
+// Analysis window applied to the samples when they are loaded for the FFT.
+// The rectangular window (the default) leaves the samples unchanged.
+//
+#define SPECTRAL_WINDOW_RECTANGULAR 0
+#define SPECTRAL_WINDOW_HANN        1
+#define SPECTRAL_WINDOW_HAMMING     2
+#define SPECTRAL_WINDOW_BLACKMAN    3
+
+#ifndef SPECTRAL_WINDOW
+#define SPECTRAL_WINDOW SPECTRAL_WINDOW_RECTANGULAR
+#endif
+
+// If set, the mean of each window is removed (DC detrend) before the spectral features
+#ifndef SPECTRAL_DETREND
+#define SPECTRAL_DETREND 0
+#endif
+
+//
+// The windows are periodic (i.e. w[n] = a0 - a1 cos(2 pi n / N) + a2 cos(4 pi n / N)),
+// which makes their DFT nonzero only in the bins 0, +-1 and +-2:
+//
+//    W[0] = N * a0,  W[+-1] = -N * a1 / 2,  W[+-2] = N * a2 / 2
+//
+// Since the FFT is linear, removing the mean from the windowed signal
+// is the same as subtracting `mean * W[k]` from these few bins afterwards.
+// This lets the detrend use the sum accumulated while loading the samples
+// instead of requiring a separate pass over the window.
+//
+#if SPECTRAL_WINDOW == SPECTRAL_WINDOW_HANN
+#define SPECTRAL_WINDOW_A0 0.5f
+#define SPECTRAL_WINDOW_A1 0.5f
+#define SPECTRAL_WINDOW_A2 0.0f
+#elif SPECTRAL_WINDOW == SPECTRAL_WINDOW_HAMMING
+#define SPECTRAL_WINDOW_A0 0.54f
+#define SPECTRAL_WINDOW_A1 0.46f
+#define SPECTRAL_WINDOW_A2 0.0f
+#elif SPECTRAL_WINDOW == SPECTRAL_WINDOW_BLACKMAN
+#define SPECTRAL_WINDOW_A0 0.42f
+#define SPECTRAL_WINDOW_A1 0.5f
+#define SPECTRAL_WINDOW_A2 0.08f
+#else
+#define SPECTRAL_WINDOW_A0 1.0f
+#define SPECTRAL_WINDOW_A1 0.0f
+#define SPECTRAL_WINDOW_A2 0.0f
+#endif
+
+// The integer versions of the coefficients use Q15 format
+#define SPECTRAL_Q15(x) ((int32_t)((x) * 32767.0f + 0.5f))
+
+#if SPECTRAL_WINDOW != SPECTRAL_WINDOW_RECTANGULAR
+static float spectral_window_f[FREQUENCY_WINDOW_SIZE];
+static int16_t spectral_window_i[FREQUENCY_WINDOW_SIZE];
+#endif
+
+// e^(-i pi j / N): half of the step of the FFT twiddles, for the odd bins
+// of the 2N-point FFT in `spectral_autocorrelation_f()`
+static float spectral_half_bin_re[FREQUENCY_WINDOW_SIZE];
+static float spectral_half_bin_im[FREQUENCY_WINDOW_SIZE];
+static bool spectral_window_ready;
+
+static void spectral_window_init(void)
+{
+    int j;
+    if (spectral_window_ready) {
+        return;
+    }
+    for (j = 0; j < FREQUENCY_WINDOW_SIZE; ++j) {
+        float phase = 2.0f * (float)M_PI * j / FREQUENCY_WINDOW_SIZE;
+#if SPECTRAL_WINDOW != SPECTRAL_WINDOW_RECTANGULAR
+        float w = SPECTRAL_WINDOW_A0
+                - SPECTRAL_WINDOW_A1 * cosf(phase)
+                + SPECTRAL_WINDOW_A2 * cosf(2.0f * phase);
+        spectral_window_f[j] = w;
+        spectral_window_i[j] = SPECTRAL_Q15(w);
+#endif
+        spectral_half_bin_re[j] = cosf(0.5f * phase);
+        spectral_half_bin_im[j] = -sinf(0.5f * phase);
+    }
+    spectral_window_ready = true;
+}
+
+//
+// Load one window of samples for the FFT. The int8 -> float conversion,
+// the multiplication with the window coefficients and the summing needed
+// for the detrend are all done in the same loop.
+// Returns the sum of the (unwindowed) samples.
+//
+static inline int32_t spectral_load_f(float re[], const accel_t *window, int axis)
+{
+    int j;
+    int32_t sum = 0;
+    for (j = 0; j < FREQUENCY_WINDOW_SIZE; ++j) {
+        int v = window[j].v[axis];
+        sum += v;
+#if SPECTRAL_WINDOW == SPECTRAL_WINDOW_RECTANGULAR
+        re[j] = v;
+#else
+        re[j] = v * spectral_window_f[j];
+#endif
+    }
+    return sum;
+}
+
+//
+// The same for WINDOW_LANES windows at once, for `fft_lanes()`:
+// the window `l` starts at `first[l * stride]`, and its sum is stored in `sum[l]`.
+// The lanes from `n` on are zero.
+//
+static inline void spectral_load_lanes_f(float re[][WINDOW_LANES], int32_t sum[WINDOW_LANES],
+                                         const accel_t *first, int stride, int n, int axis)
+{
+    int j, l;
+    for (l = 0; l < n; ++l) {
+        const accel_t *window = &first[l * stride];
+        sum[l] = 0;
+        for (j = 0; j < FREQUENCY_WINDOW_SIZE; ++j) {
+            int v = window[j].v[axis];
+            sum[l] += v;
+#if SPECTRAL_WINDOW == SPECTRAL_WINDOW_RECTANGULAR
+            re[j][l] = v;
+#else
+            re[j][l] = v * spectral_window_f[j];
+#endif
+        }
+    }
+    for (; l < WINDOW_LANES; ++l) {
+        sum[l] = 0;
+        for (j = 0; j < FREQUENCY_WINDOW_SIZE; ++j) {
+            re[j][l] = 0;
+        }
+    }
+}
+
+// Copy out the FFT result of one of the windows
+static inline void spectral_unload_lane_f(float re[], float im[],
+                                          float lanes_re[][WINDOW_LANES],
+                                          float lanes_im[][WINDOW_LANES], int l)
+{
+    int j;
+    for (j = 0; j < FREQUENCY_WINDOW_SIZE; ++j) {
+        re[j] = lanes_re[j][l];
+        im[j] = lanes_im[j][l];
+    }
+}
+
+//
+// The integer FFT uses quantized twiddle factors, so its DC bin is not exactly
+// the sum of the samples and the correction in the frequency domain would leave
+// a residual. Instead the mean is subtracted from the samples during the load.
+// The mean is taken by a separate pass over the int8 samples, which is cheap
+// compared to the load itself.
+//
+static inline void spectral_load_i(int16_t re[], const accel_t *window, int axis)
+{
+    int j;
+#if SPECTRAL_DETREND
+    int32_t sum = 0;
+    for (j = 0; j < FREQUENCY_WINDOW_SIZE; ++j) {
+        sum += window[j].v[axis];
+    }
+    int mean = sum / FREQUENCY_WINDOW_SIZE;
+#else
+    const int mean = 0;
+#endif
+    for (j = 0; j < FREQUENCY_WINDOW_SIZE; ++j) {
+        int v = window[j].v[axis] - mean;
+#if SPECTRAL_WINDOW == SPECTRAL_WINDOW_RECTANGULAR
+        re[j] = v;
+#else
+        re[j] = (v * spectral_window_i[j]) >> 15;
+#endif
+    }
+}
+
+//
+// Remove the mean of the window from the float FFT result (see above).
+// `sum` is the value returned by `spectral_load_f()`.
+//
+static inline void spectral_detrend_f(float re[], int32_t sum)
+{
+#if SPECTRAL_DETREND
+    re[0] -= sum * SPECTRAL_WINDOW_A0;
+#if SPECTRAL_WINDOW != SPECTRAL_WINDOW_RECTANGULAR
+    re[1] += sum * (SPECTRAL_WINDOW_A1 / 2);
+    re[FREQUENCY_WINDOW_SIZE - 1] += sum * (SPECTRAL_WINDOW_A1 / 2);
+#endif
+#if SPECTRAL_WINDOW == SPECTRAL_WINDOW_BLACKMAN
+    re[2] -= sum * (SPECTRAL_WINDOW_A2 / 2);
+    re[FREQUENCY_WINDOW_SIZE - 2] -= sum * (SPECTRAL_WINDOW_A2 / 2);
+#endif
+#endif
+}
+
+// ------------------------------------------
+
+//
+// The feature values of a window, computed from the result of the float FFT.
+//
+
+// The power spectrum: the squared magnitudes of the bins up to the Nyquist frequency.
+// The other half is the same for real samples. The features below take it
+// instead of the FFT result, so it is computed once for all of them.
+static inline void spectral_power_f(const float re[], const float im[],
+                                    float power[SPECTRAL_NUM_BINS])
+{
+    int j;
+    // the DC bin is separate, so the loop is vectorized without an epilogue
+    power[0] = re[0] * re[0] + im[0] * im[0];
+    for (j = 1; j < SPECTRAL_NUM_BINS; ++j) {
+        power[j] = re[j] * re[j] + im[j] * im[j];
+    }
+}
+
+// The squared magnitude of the DC bin, and the sums of those of the other bins
+// up to the Nyquist frequency, FREQUENCY_HISTOGRAM_DIVIDER bins at a time
+static inline void spectral_histogram_power_f(const float power[],
+                                              float bins[NUM_FREQUENCY_HISTOGRAM_BINS])
+{
+    int i;
+
+    bins[0] = power[0];
+    for (i = 1; i < NUM_FREQUENCY_HISTOGRAM_BINS; ++i) {
+        bins[i] = 0;
+    }
+
+    for (i = 1; i < SPECTRAL_NUM_BINS; ++i) {
+        uint8_t ui = (i - 1) / FREQUENCY_HISTOGRAM_DIVIDER + 1;
+        bins[ui] += power[i];
+    }
+}
+
+static inline void spectral_histogram_f(const float re[], const float im[],
+                                        float bins[NUM_FREQUENCY_HISTOGRAM_BINS])
+{
+    float power[SPECTRAL_NUM_BINS];
+    spectral_power_f(re, im, power);
+    spectral_histogram_power_f(power, bins);
+}
+
+// XXX: not sure this is the correct definition of entropy of a complex signal
+static inline float spectral_entropy_f(const float re[], const float im[])
+{
+    int j;
+    float entropy = 0;
+    float squared_sum = 0;
+    float msq[FREQUENCY_WINDOW_SIZE];
+    float normalization_coefficient = 1.0 / (FREQUENCY_WINDOW_SIZE * FREQUENCY_WINDOW_SIZE);
+    for (j = 0; j < FREQUENCY_WINDOW_SIZE; ++j) {
+        msq[j] = normalization_coefficient * (re[j] * re[j] + im[j] * im[j]); // calculate the squared module |x|^2
+        squared_sum += msq[j];
+    }
+    for (j = 0; j < FREQUENCY_WINDOW_SIZE; ++j) {
+        float q = msq[j] / squared_sum;
+        if (q) {
+            entropy += q * log2f(q);
+        }
+    }
+    return -entropy;
+}
+
+// -----------------------------------------------------------
+//
+// Faster variants of the spectral entropy, without `log2f()`
+
+// log2(x) for x > 0, with an absolute error below 2e-5: the exponent of the float,
+// and a polynomial of the mantissa 1 + t, log2(1 + t) ~ t * P(t), so it is exact for
+// powers of two. There are no branches, so the loops of it are vectorized.
+// Zero gives -127.
+static inline float spectral_log2_fast_f(float x)
+{
+    uint32_t bits;
+    float t;
+    int exponent;
+
+    memcpy(&bits, &x, sizeof(bits));
+    exponent = (int)(bits >> 23) - 127;
+    bits = (bits & 0x7fffff) | 0x3f800000;
+    memcpy(&t, &bits, sizeof(t));
+    t -= 1.0f;
+    return exponent + t * (1.44196607f + t * (-0.709668479f + t * (0.417616435f
+        + t * (-0.19629837f + t * 0.0463988246f))));
+}
+
+// Same as `spectral_entropy_f()` within 1e-4, with `spectral_log2_fast_f()`.
+// The terms are computed in a vectorized loop, and summed in order.
+static inline float spectral_entropy_fast_f(const float re[], const float im[])
+{
+    int j;
+    float entropy = 0;
+    float squared_sum = 0;
+    float inverse;
+    float msq[FREQUENCY_WINDOW_SIZE];
+    float terms[FREQUENCY_WINDOW_SIZE];
+
+    for (j = 0; j < FREQUENCY_WINDOW_SIZE; ++j) {
+        msq[j] = re[j] * re[j] + im[j] * im[j];
+    }
+    for (j = 0; j < FREQUENCY_WINDOW_SIZE; ++j) {
+        squared_sum += msq[j];
+    }
+    // the normalization of the squared magnitudes cancels out;
+    // as in `spectral_entropy_f()`, the result is NaN if they are all zero
+    inverse = 1.0f / squared_sum;
+    for (j = 0; j < FREQUENCY_WINDOW_SIZE; ++j) {
+        float q = msq[j] * inverse;
+        terms[j] = q * spectral_log2_fast_f(q);
+    }
+    for (j = 0; j < FREQUENCY_WINDOW_SIZE; ++j) {
+        entropy += terms[j];
+    }
+    return -entropy;
+}
+
+// log2(x) in Q16 fixed point for x > 0, with an error below 1e-4:
+// the position of the highest bit, and the fraction from `log2_lookup_table`,
+// interpolated linearly with the next 16 bits. Zero gives zero.
+static inline uint32_t spectral_log2_q16(uint64_t x)
+{
+    int exponent = 63 - __builtin_clzll(x | 1);
+    uint64_t normalized = x << (63 - exponent);
+    uint32_t i = (normalized >> (63 - LOG2_TABLE_BITS)) & (LOG2_TABLE_SIZE - 1);
+    uint32_t fraction = (normalized >> (63 - LOG2_TABLE_BITS - 16)) & 0xffff;
+    uint32_t lo = log2_lookup_table[i];
+    uint32_t hi = log2_lookup_table[i + 1];
+    return ((uint32_t)exponent << 16) + lo + (((hi - lo) * fraction) >> 16);
+}
+
+// The spectral entropy of the output of `intfft()`, in Q16 fixed point,
+// without floating point operations. With the sum S of the squared magnitudes m,
+// it is log2(S) - sum(m * log2(m)) / S. Zero if all of them are zero.
+static inline uint32_t spectral_entropy_q16(const int16_t re[], const int16_t im[])
+{
+    int j;
+    uint32_t msq[FREQUENCY_WINDOW_SIZE];
+    uint64_t squared_sum = 0;
+    // at most 2^31 * (31 << 16) for each frequency
+    uint64_t weighted_sum = 0;
+    uint32_t log2_sum, weighted_avg;
+
+    for (j = 0; j < FREQUENCY_WINDOW_SIZE; ++j) {
+        msq[j] = (uint32_t)re[j] * re[j] + (uint32_t)im[j] * im[j];
+        squared_sum += msq[j];
+    }
+    if (squared_sum == 0) {
+        return 0;
+    }
+    for (j = 0; j < FREQUENCY_WINDOW_SIZE; ++j) {
+        weighted_sum += (uint64_t)msq[j] * spectral_log2_q16(msq[j]);
+    }
+    log2_sum = spectral_log2_q16(squared_sum);
+    weighted_avg = weighted_sum / squared_sum;
+    // the errors of the approximation could make it negative
+    return log2_sum > weighted_avg ? log2_sum - weighted_avg : 0;
+}
+
+// -----------------------------------------------------------
+//
+// The shape of the power spectrum. The DC bin is left out, as the gravity
+// would dominate it; the frequencies are in bins, i.e. SAMPLING_HZ / FREQUENCY_WINDOW_SIZE Hz.
+// Each of them is one pass over the bins, and zero if all of them are zero.
+//
+
+// The sum of the powers, without the DC bin
+static inline float spectral_total_f(const float power[])
+{
+    int j;
+    float total = 0;
+    for (j = 1; j < SPECTRAL_NUM_BINS; ++j) {
+        total += power[j];
+    }
+    return total;
+}
+
+// The mean frequency, weighted by the power
+static inline float spectral_centroid_f(const float power[])
+{
+    int j;
+    float total = 0, weighted = 0;
+    for (j = 1; j < SPECTRAL_NUM_BINS; ++j) {
+        total += power[j];
+        weighted += j * power[j];
+    }
+    return total ? weighted / total : 0;
+}
+
+// The standard deviation of the frequency around the centroid, weighted by the power
+static inline float spectral_spread_f(const float power[])
+{
+    int j;
+    float total = 0, weighted = 0;
+    float centroid = spectral_centroid_f(power);
+    for (j = 1; j < SPECTRAL_NUM_BINS; ++j) {
+        float d = j - centroid;
+        total += power[j];
+        weighted += d * d * power[j];
+    }
+    return total ? sqrtf(weighted / total) : 0;
+}
+
+// The lowest bin with SPECTRAL_ROLLOFF_PERCENT of the power in it and below
+static inline float spectral_rolloff_f(const float power[])
+{
+    int j;
+    float threshold = spectral_total_f(power) * (SPECTRAL_ROLLOFF_PERCENT / 100.0f);
+    float cumulative = 0;
+    if (threshold == 0) {
+        return 0;
+    }
+    for (j = 1; j < SPECTRAL_NUM_BINS - 1; ++j) {
+        cumulative += power[j];
+        if (cumulative >= threshold) {
+            break;
+        }
+    }
+    return j;
+}
+
+// The geometric mean of the powers over their arithmetic mean, from 0 (a single tone)
+// to 1 (white noise). Zero if any of them is zero. With `spectral_log2_fast_f()`,
+// so the loop is vectorized; the relative error is below 1e-4.
+static inline float spectral_flatness_f(const float power[])
+{
+    int j, zeros = 0;
+    float total = 0, log_sum = 0;
+    float logs[SPECTRAL_NUM_BINS];
+
+    for (j = 1; j < SPECTRAL_NUM_BINS; ++j) {
+        logs[j] = spectral_log2_fast_f(power[j]);
+        zeros += power[j] == 0;
+    }
+    if (zeros) {
+        return 0;
+    }
+    for (j = 1; j < SPECTRAL_NUM_BINS; ++j) {
+        total += power[j];
+        log_sum += logs[j];
+    }
+    return exp2f(log_sum / (SPECTRAL_NUM_BINS - 1)) / (total / (SPECTRAL_NUM_BINS - 1));
+}
+
+// The bin with the highest power; the lowest one of the powers within
+// SPECTRAL_DOMINANT_EPSILON of it, so the rounding errors of the FFT do not
+// choose between equal peaks, e.g. in the flat spectrum of an impulse
+static inline float spectral_dominant_f(const float power[])
+{
+    int j;
+    float highest = 0, threshold;
+    for (j = 1; j < SPECTRAL_NUM_BINS; ++j) {
+        highest = max(highest, power[j]);
+    }
+    if (highest == 0) {
+        return 0;
+    }
+    threshold = highest * (1 - SPECTRAL_DOMINANT_EPSILON);
+    j = 1;
+    while (power[j] < threshold) {
+        ++j;
+    }
+    return j;
+}
+
+// The fraction of the power in the bins 1 .. SPECTRAL_BAND_SPLIT
+static inline float spectral_band_ratio_f(const float power[])
+{
+    int j;
+    float low = 0, total;
+    for (j = 1; j <= SPECTRAL_BAND_SPLIT; ++j) {
+        low += power[j];
+    }
+    total = spectral_total_f(power);
+    return total ? low / total : 0;
+}
+
+// -----------------------------------------------------------
+//
+// The same for the output of `intfft()`, without floating point operations.
+// The powers are below 2^31, so their sums fit in 64 bits.
+//
+
+static inline void spectral_power_i(const int16_t re[], const int16_t im[],
+                                    uint32_t power[SPECTRAL_NUM_BINS])
+{
+    int j;
+    power[0] = (uint32_t)re[0] * re[0] + (uint32_t)im[0] * im[0];
+    for (j = 1; j < SPECTRAL_NUM_BINS; ++j) {
+        power[j] = (uint32_t)re[j] * re[j] + (uint32_t)im[j] * im[j];
+    }
+}
+
+static inline uint64_t spectral_total_i(const uint32_t power[])
+{
+    int j;
+    uint64_t total = 0;
+    for (j = 1; j < SPECTRAL_NUM_BINS; ++j) {
+        total += power[j];
+    }
+    return total;
+}
+
+// `numerator` / `total` in fixed point with `bits` fractional bits, rounded down.
+// The remainder is below `total`, so it can be shifted without overflowing.
+static inline uint64_t spectral_ratio_fixed(uint64_t numerator, uint64_t total, int bits)
+{
+    return ((numerator / total) << bits) + ((numerator % total) << bits) / total;
+}
+
+// In units of 2^-8 bins
+static inline uint32_t spectral_centroid_q8(const uint32_t power[])
+{
+    int j;
+    uint64_t total = 0, weighted = 0;
+    for (j = 1; j < SPECTRAL_NUM_BINS; ++j) {
+        total += power[j];
+        weighted += (uint64_t)j * power[j];
+    }
+    return total ? spectral_ratio_fixed(weighted, total, 8) : 0;
+}
+
+// In units of 2^-8 bins: the root of E[j^2] - E[j]^2, both in Q16.
+// The spread is at most N/4 bins, so the variance fits in 32 bits for N up to 512.
+static inline uint32_t spectral_spread_q8(const uint32_t power[])
+{
+    int j;
+    uint64_t total = 0, weighted = 0, weighted_sq = 0;
+    uint64_t mean_q16, mean_sq_q16, square_of_mean_q16;
+
+    for (j = 1; j < SPECTRAL_NUM_BINS; ++j) {
+        total += power[j];
+        weighted += (uint64_t)j * power[j];
+        weighted_sq += (uint64_t)(j * j) * power[j];
+    }
+    if (total == 0) {
+        return 0;
+    }
+    mean_q16 = spectral_ratio_fixed(weighted, total, 16);
+    mean_sq_q16 = spectral_ratio_fixed(weighted_sq, total, 16);
+    square_of_mean_q16 = (mean_q16 * mean_q16) >> 16;
+    // the rounding could make it negative
+    return mean_sq_q16 > square_of_mean_q16 ? isqrt32(mean_sq_q16 - square_of_mean_q16) : 0;
+}
+
+static inline uint32_t spectral_rolloff_i(const uint32_t power[])
+{
+    int j;
+    uint64_t threshold = spectral_total_i(power) * SPECTRAL_ROLLOFF_PERCENT;
+    uint64_t cumulative = 0;
+    if (threshold == 0) {
+        return 0;
+    }
+    for (j = 1; j < SPECTRAL_NUM_BINS - 1; ++j) {
+        cumulative += power[j];
+        if (cumulative * 100 >= threshold) {
+            break;
+        }
+    }
+    return j;
+}
+
+// The flatness as -log2(flatness) in Q16, i.e. 0 for white noise, with `spectral_log2_q16()`.
+// The bins of zero power, which are common after the rounding of `intfft()`,
+// are taken as the smallest nonzero power, 1.
+static inline uint32_t spectral_flatness_log2_q16(const uint32_t power[])
+{
+    int j;
+    const int bins_log2 = __builtin_ctz(SPECTRAL_NUM_BINS - 1);
+    uint64_t total = 0, log_sum = 0;
+    uint32_t log2_mean, mean_log2;
+
+    for (j = 1; j < SPECTRAL_NUM_BINS; ++j) {
+        uint32_t p = power[j] ? power[j] : 1;
+        total += p;
+        log_sum += spectral_log2_q16(p);
+    }
+    log2_mean = spectral_log2_q16(total) - ((uint32_t)bins_log2 << 16);
+    mean_log2 = log_sum >> bins_log2;
+    // the errors of the approximation could make it negative
+    return log2_mean > mean_log2 ? log2_mean - mean_log2 : 0;
+}
+
+static inline uint32_t spectral_dominant_i(const uint32_t power[])
+{
+    int j, dominant = 0;
+    uint32_t highest = 0;
+    for (j = 1; j < SPECTRAL_NUM_BINS; ++j) {
+        if (power[j] > highest) {
+            highest = power[j];
+            dominant = j;
+        }
+    }
+    return dominant;
+}
+
+// In Q15
+static inline uint32_t spectral_band_ratio_q15(const uint32_t power[])
+{
+    int j;
+    uint64_t low = 0, total;
+    for (j = 1; j <= SPECTRAL_BAND_SPLIT; ++j) {
+        low += power[j];
+    }
+    total = spectral_total_i(power);
+    return total ? spectral_ratio_fixed(low, total, 15) : 0;
+}
+
+// -----------------------------------------------------------
+
+//
+// The maxima of the power spectrum
+//
+
+// The powers up to this are taken as zero by the float maximum, as the FFT of a window
+// without those frequencies leaves rounding errors in them
+#ifndef SPECTRAL_MAXIMUM_EPSILON
+#define SPECTRAL_MAXIMUM_EPSILON 0.1f
+#endif
+
+// The same for the integer FFT
+#ifndef SPECTRAL_MAXIMUM_EPSILON_I
+#define SPECTRAL_MAXIMUM_EPSILON_I 0
+#endif
+
+// The number of the highest peaks of the power spectrum
+#ifndef SPECTRAL_TOP_PEAKS
+#define SPECTRAL_TOP_PEAKS 3
+#endif
+
+// The highest bin with a power above `epsilon`, or -1 if there is none.
+// The whole spectrum is scanned instead of stopping at the first such bin from the top,
+// so there are no branches and the loop is vectorized. The DC bin is separate,
+// so the number of iterations is a power of two.
+static inline int spectral_last_above_f(const float power[], float epsilon)
+{
+    int j, last = power[0] > epsilon ? 0 : -1;
+    for (j = 1; j < SPECTRAL_NUM_BINS; ++j) {
+        last = power[j] > epsilon ? j : last;
+    }
+    return last;
+}
+
+static inline int spectral_last_above_i(const uint32_t power[], uint32_t epsilon)
+{
+    int j, last = power[0] > epsilon ? 0 : -1;
+    for (j = 1; j < SPECTRAL_NUM_BINS; ++j) {
+        last = power[j] > epsilon ? j : last;
+    }
+    return last;
+}
+
+// The squared magnitude of the maximal nonzero frequency, up to the Nyquist frequency;
+// returns false if there is none
+static inline bool spectral_maximum_f(const float power[], float *result)
+{
+    int last = spectral_last_above_f(power, SPECTRAL_MAXIMUM_EPSILON);
+    if (last < 0) {
+        return false;
+    }
+    *result = power[last];
+    return true;
+}
+
+// Mark the local maxima of the power spectrum in the bins 1 .. N/2. As the peaks of the time
+// domain (see window-features.h), a peak is a rise followed by a fall, with possibly a plateau
+// between them, so the steps of a staircase are not peaks. A plateau is marked at its first bin.
+// The bin 1 is not compared with the DC, which holds the mean (e.g. the gravity) and is not
+// a frequency, so it is always a rise. The bin N/2 + 1 would be the same as N/2 - 1, so the
+// end is always a fall. The comparisons are vectorized; the plateaus are followed back from
+// the end in a scan without branches.
+static inline void spectral_mark_peaks(const float power[], uint8_t is_peak[SPECTRAL_NUM_BINS])
+{
+    uint8_t rising[SPECTRAL_NUM_BINS];
+    uint8_t level[SPECTRAL_NUM_BINS];
+    // whether the next change of the values after the bin j is a fall
+    uint8_t falling = 1;
+    int j;
+
+    rising[1] = 1;
+    level[1] = 0;
+    for (j = 2; j < SPECTRAL_NUM_BINS; ++j) {
+        rising[j] = power[j] > power[j - 1];
+        level[j] = power[j] == power[j - 1];
+    }
+    for (j = SPECTRAL_NUM_BINS - 1; j >= 1; --j) {
+        is_peak[j] = rising[j] & falling;
+        falling = (level[j] & falling) | (!level[j] & !rising[j]);
+    }
+}
+
+// The SPECTRAL_TOP_PEAKS highest local maxima of the power spectrum above SPECTRAL_MAXIMUM_EPSILON,
+// highest first, so the first one is the bin with the highest power other than the DC.
+// Of equal peaks the lower bin comes first. The rest of them are zero if there are fewer.
+// The peaks are found in a vectorized pass; only they go through the insertion.
+static inline void spectral_top_peaks_f(const float power[], int bins[SPECTRAL_TOP_PEAKS],
+                                        float powers[SPECTRAL_TOP_PEAKS])
+{
+    uint8_t is_peak[SPECTRAL_NUM_BINS];
+    int i, j, count = 0;
+
+    spectral_mark_peaks(power, is_peak);
+    for (j = 1; j < SPECTRAL_NUM_BINS; ++j) {
+        if (!is_peak[j] || power[j] <= SPECTRAL_MAXIMUM_EPSILON) {
+            continue;
+        }
+        if (count == SPECTRAL_TOP_PEAKS && power[j] <= powers[count - 1]) {
+            continue;
+        }
+        // insert it after the peaks that are not lower
+        i = count < SPECTRAL_TOP_PEAKS ? count++ : count - 1;
+        for (; i > 0 && powers[i - 1] < power[j]; --i) {
+            bins[i] = bins[i - 1];
+            powers[i] = powers[i - 1];
+        }
+        bins[i] = j;
+        powers[i] = power[j];
+    }
+    for (i = count; i < SPECTRAL_TOP_PEAKS; ++i) {
+        bins[i] = 0;
+        powers[i] = 0;
+    }
+}
+
+// -----------------------------------------------------------
+//
+// The autocorrelation of the window, from its FFT
+//
+
+// A local maximum of the autocorrelation is the dominant period if it is at least
+// this fraction of the highest one, so the shortest of nearly equal periods is taken
+// (e.g. one step rather than two)
+#ifndef SPECTRAL_PERIOD_THRESHOLD
+#define SPECTRAL_PERIOD_THRESHOLD 0.9f
+#endif
+
+// The differences of the autocorrelation that are ignored, relative to r[0]
+#ifndef SPECTRAL_PERIOD_EPSILON
+#define SPECTRAL_PERIOD_EPSILON 1e-4f
+#endif
+
+// The window is taken as constant if r[0], the sum of the squares of its samples
+// without the mean, is below this; the rounding errors of the detrend are not zero
+#ifndef SPECTRAL_PERIOD_MIN_ENERGY
+#define SPECTRAL_PERIOD_MIN_ENERGY 1e-3f
+#endif
+
+// The autocorrelation of the window for the lags 0 .. N - 1: the inverse FFT of the squared
+// magnitudes of its FFT zero-padded to 2N points, so the lags do not wrap around the window.
+// The even bins of the 2N-point FFT are the bins of `re`, `im`, and the odd ones are the FFT
+// of the window multiplied with e^(-i pi j / N), so only N-point transforms are needed:
+//
+//    r[k] = (ifft(|X|^2)[k] + e^(i pi k / N) * ifft(|Y|^2)[k]) / 2
+//
+// The DC bin is left out, so it is that of the window without its mean.
+// Not normalized; r[0] is the sum of the squares. Needs `spectral_window_init()`.
+static inline void spectral_autocorrelation_f(const float re[], const float im[],
+                                              float r[FREQUENCY_WINDOW_SIZE])
+{
+    int j;
+    float x_re[FREQUENCY_WINDOW_SIZE];
+    float x_im[FREQUENCY_WINDOW_SIZE];
+    float y_re[FREQUENCY_WINDOW_SIZE];
+    float y_im[FREQUENCY_WINDOW_SIZE];
+
+    // the window back from its spectrum; it is real
+    x_re[0] = 0;
+    x_im[0] = 0;
+    for (j = 1; j < FREQUENCY_WINDOW_SIZE; ++j) {
+        x_re[j] = re[j];
+        x_im[j] = im[j];
+    }
+    ifft(x_re, x_im, FREQUENCY_WINDOW_SIZE);
+
+    // the odd bins
+    for (j = 0; j < FREQUENCY_WINDOW_SIZE; ++j) {
+        y_re[j] = x_re[j] * spectral_half_bin_re[j];
+        y_im[j] = x_re[j] * spectral_half_bin_im[j];
+    }
+    fft(y_re, y_im, FREQUENCY_WINDOW_SIZE);
+
+    // the squared magnitudes of the even and the odd bins
+    x_re[0] = 0;
+    x_im[0] = 0;
+    for (j = 1; j < FREQUENCY_WINDOW_SIZE; ++j) {
+        x_re[j] = re[j] * re[j] + im[j] * im[j];
+        x_im[j] = 0;
+    }
+    for (j = 0; j < FREQUENCY_WINDOW_SIZE; ++j) {
+        y_re[j] = y_re[j] * y_re[j] + y_im[j] * y_im[j];
+        y_im[j] = 0;
+    }
+    ifft(x_re, x_im, FREQUENCY_WINDOW_SIZE);
+    ifft(y_re, y_im, FREQUENCY_WINDOW_SIZE);
+
+    // the real part, as e^(i pi k / N) is the conjugate of the twiddle
+    for (j = 0; j < FREQUENCY_WINDOW_SIZE; ++j) {
+        r[j] = 0.5f * (x_re[j] + y_re[j] * spectral_half_bin_re[j]
+                       + y_im[j] * spectral_half_bin_im[j]);
+    }
+}
+
+// Is r[j] a local maximum of the autocorrelation? The lags of a plateau give the first one.
+// Differences below `epsilon` are ties: the samples are integers, so the exact autocorrelation
+// often has plateaus, and the rounding errors of the FFT must not split them.
+static inline bool spectral_is_peak_f(const float r[], int j, float epsilon)
+{
+    return r[j] > r[j - 1] + epsilon && r[j] >= r[j + 1] - epsilon;
+}
+
+// The dominant period of an autocorrelation from `spectral_autocorrelation_f()`:
+// the lag of a local maximum in 1 .. N/2 (see SPECTRAL_PERIOD_THRESHOLD),
+// and its strength r[lag] / r[0], from -1 to 1.
+// Returns false if there is none, e.g. for a constant window.
+static inline bool spectral_period_f(const float r[], int *lag, float *strength)
+{
+    int j;
+    float highest = 0;
+    float epsilon = SPECTRAL_PERIOD_EPSILON * r[0];
+
+    if (r[0] < SPECTRAL_PERIOD_MIN_ENERGY) {
+        return false;
+    }
+    for (j = 1; j <= FREQUENCY_WINDOW_SIZE / 2; ++j) {
+        if (spectral_is_peak_f(r, j, epsilon) && r[j] > highest) {
+            highest = r[j];
+        }
+    }
+    if (highest <= epsilon) {
+        return false;
+    }
+    for (j = 1; j <= FREQUENCY_WINDOW_SIZE / 2; ++j) {
+        if (spectral_is_peak_f(r, j, epsilon) && r[j] >= SPECTRAL_PERIOD_THRESHOLD * highest) {
+            break;
+        }
+    }
+    *lag = j;
+    *strength = r[j] / r[0];
+    return true;
+}
+
+#endif // SPECTRAL_H
@@ -0,0 +1,130 @@
+/*
+ * Copyright (c) 2019, Institute of Electronics and Computer Science (EDI)
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * Author: Atis Elsts
+ */
+
+/*
+ * File: spsc-queue.h
+ * A lock-free single producer, single consumer queue of pointers.
+ *
+ * Used to pass preallocated blocks between the threads of a pipeline:
+ * each connection has a queue of the full blocks and a queue of the free ones,
+ * so a stage that runs ahead waits for a free block (backpressure),
+ * and nothing is allocated while running.
+ */
+
+#ifndef SPSC_QUEUE_H
+#define SPSC_QUEUE_H
+
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <sched.h>
+
+// Must be a power of 2
+#ifndef SPSC_QUEUE_SIZE
+#define SPSC_QUEUE_SIZE 32
+#endif
+
+#if SPSC_QUEUE_SIZE & (SPSC_QUEUE_SIZE - 1)
+#error SPSC_QUEUE_SIZE must be a power of 2
+#endif
+
+// The number of polls before giving up the CPU while waiting
+#define SPSC_QUEUE_SPIN 64
+
+#define SPSC_QUEUE_CACHE_LINE 64
+
+typedef struct {
+    // written by the consumer
+    _Alignas(SPSC_QUEUE_CACHE_LINE) atomic_uint head;
+    // written by the producer
+    _Alignas(SPSC_QUEUE_CACHE_LINE) atomic_uint tail;
+    _Alignas(SPSC_QUEUE_CACHE_LINE) void *slots[SPSC_QUEUE_SIZE];
+} spsc_queue_t;
+
+// -----------------------------------------------------------
+
+static inline void spsc_queue_init(spsc_queue_t *q)
+{
+    atomic_init(&q->head, 0);
+    atomic_init(&q->tail, 0);
+}
+
+// Returns false if full
+static inline bool spsc_queue_push(spsc_queue_t *q, void *item)
+{
+    unsigned tail = atomic_load_explicit(&q->tail, memory_order_relaxed);
+    unsigned head = atomic_load_explicit(&q->head, memory_order_acquire);
+    if (tail - head == SPSC_QUEUE_SIZE) {
+        return false;
+    }
+    q->slots[tail % SPSC_QUEUE_SIZE] = item;
+    atomic_store_explicit(&q->tail, tail + 1, memory_order_release);
+    return true;
+}
+
+// Returns NULL if empty
+static inline void *spsc_queue_pop(spsc_queue_t *q)
+{
+    unsigned head = atomic_load_explicit(&q->head, memory_order_relaxed);
+    unsigned tail = atomic_load_explicit(&q->tail, memory_order_acquire);
+    void *item;
+    if (head == tail) {
+        return NULL;
+    }
+    item = q->slots[head % SPSC_QUEUE_SIZE];
+    atomic_store_explicit(&q->head, head + 1, memory_order_release);
+    return item;
+}
+
+// -----------------------------------------------------------
+
+// The blocking versions: poll for a while, then yield between the polls
+static inline void spsc_queue_put(spsc_queue_t *q, void *item)
+{
+    int spin = 0;
+    while (!spsc_queue_push(q, item)) {
+        if (++spin > SPSC_QUEUE_SPIN) {
+            sched_yield();
+        }
+    }
+}
+
+static inline void *spsc_queue_get(spsc_queue_t *q)
+{
+    int spin = 0;
+    void *item;
+    while ((item = spsc_queue_pop(q)) == NULL) {
+        if (++spin > SPSC_QUEUE_SPIN) {
+            sched_yield();
+        }
+    }
+    return item;
+}
+
+#endif // SPSC_QUEUE_H
@@ -0,0 +1,145 @@
+/*
+ * Copyright (c) 2019, Institute of Electronics and Computer Science (EDI)
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * Author: Atis Elsts
+ */
+
+
+/*
+ * File: sqrt.h
+ * Integer square roots, for the targets without a FPU (see INTEGER_SQRT in main.h).
+ *
+ * `isqrt32()` finds the root bit by bit, with shifts, additions and comparisons only.
+ * `irsqrt()` is the reciprocal square root: a seed from a small table,
+ * refined by two Newton iterations with 32x32->64 bit multiplications.
+ * Its result is a Q16 mantissa `r` in (0.5, 1] and a shift `k`,
+ * so that 1/sqrt(x) = r * 2^-(16 + k); the relative error is within 2^-15.
+ *
+ * `sqrt_block_f()` is the float square root of a block, with vector instructions.
+ */
+
+#ifndef SQRT_H
+#define SQRT_H
+
+#include <stdint.h>
+#include <math.h>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#elif defined(__SSE__)
+#include <xmmintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+// -----------------------------------------------------------
+
+// The square root, rounded to the nearest integer
+static inline uint32_t isqrt32(uint32_t x)
+{
+    uint32_t result = 0;
+    uint32_t bit = 1ul << 30;
+
+    while (bit > x) {
+        bit >>= 2;
+    }
+    while (bit != 0) {
+        if (x >= result + bit) {
+            x -= result + bit;
+            result = (result >> 1) + bit;
+        } else {
+            result >>= 1;
+        }
+        bit >>= 2;
+    }
+    // `x` is the remainder now; round up if x > result + 0.25
+    return x > result ? result + 1 : result;
+}
+
+// The square root in Q8, for x < 2^16
+static inline uint32_t isqrt_q8(uint32_t x)
+{
+    return isqrt32(x << 16);
+}
+
+// -----------------------------------------------------------
+
+// 1/sqrt(u) for u in [1, 4) in steps of 1/8, sampled in the middles of the steps; Q16
+static const uint16_t irsqrt_seed[24] = {
+    63579, 60140, 57205, 54661, 52429, 50450, 48679, 47082,
+    45633, 44310, 43096, 41977, 40940, 39977, 39078, 38238,
+    37449, 36708, 36008, 35347, 34722, 34128, 33564, 33027,
+};
+
+// The reciprocal square root of x > 0 as r * 2^-(16 + *shift), with `r` in Q16
+static inline uint32_t irsqrt(uint32_t x, int *shift)
+{
+    // x = u * 4^k with u in [1, 4)
+    int k = (31 - __builtin_clz(x)) >> 1;
+    uint32_t u = 2 * k <= 16 ? x << (16 - 2 * k) : x >> (2 * k - 16);
+    uint32_t r = irsqrt_seed[(u >> 13) - 8];
+    int i;
+
+    for (i = 0; i < 2; ++i) {
+        // r = r * (3 - u * r^2) / 2
+        uint32_t t = ((uint64_t)u * r) >> 16;
+        t = ((uint64_t)t * r) >> 16;
+        r = ((uint64_t)r * (3 * 65536 - t)) >> 17;
+    }
+
+    *shift = k;
+    return r;
+}
+
+// -----------------------------------------------------------
+
+// In-place square root of `n` floats, `n` a multiple of 8;
+// the compiler does not vectorize `sqrtf` because of `errno`, so do it explicitly.
+// The result is the same as `sqrtf`, as these are exact rather than estimated roots.
+static inline void sqrt_block_f(float *r, int n)
+{
+    int k;
+#if defined(__AVX__)
+    for (k = 0; k < n; k += 8) {
+        _mm256_storeu_ps(&r[k], _mm256_sqrt_ps(_mm256_loadu_ps(&r[k])));
+    }
+#elif defined(__SSE__)
+    for (k = 0; k < n; k += 4) {
+        _mm_storeu_ps(&r[k], _mm_sqrt_ps(_mm_loadu_ps(&r[k])));
+    }
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+    for (k = 0; k < n; k += 4) {
+        vst1q_f32(&r[k], vsqrtq_f32(vld1q_f32(&r[k])));
+    }
+#else
+    for (k = 0; k < n; ++k) {
+        r[k] = sqrtf(r[k]);
+    }
+#endif
+}
+
+#endif // SQRT_H
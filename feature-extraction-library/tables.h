@@ -0,0 +1,176 @@
+/*
+ * Copyright (c) 2019, Institute of Electronics and Computer Science (EDI)
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * Author: Atis Elsts
+ */
+
+/*
+ * File: tables.h
+ * Lookup tables that depend on the window sizes: entropy, FFT sine and bit reversal,
+ * and the fixed point log2 table.
+ *
+ * By default the tables are generated at build time by `gen-tables`
+ * for the configured TIME_WINDOW_SIZE and FREQUENCY_WINDOW_SIZE (see the Makefile),
+ * and included from `tables-generated.h`.
+ * If GENERATE_TABLES_AT_INIT is set, the tables are placed in RAM instead
+ * and filled by `tables_init()`, which must be called before any of the features.
+ */
+
+#include <math.h>
+#include "main.h"
+
+#ifndef TABLES_H
+#define TABLES_H
+
+#ifndef GENERATE_TABLES_AT_INIT
+#define GENERATE_TABLES_AT_INIT 0
+#endif
+
+// Store just the first quarter of the sine wave, [0, pi/2], instead of [0, pi)
+#ifndef FFT_QUARTER_WAVE_TABLE
+#define FFT_QUARTER_WAVE_TABLE 1
+#endif
+
+// log2 of a power of two up to 2^16; usable in #if as well
+#define TABLES_LOG2(n)                                                  \
+    ((n) >= 65536 ? 16 : (n) >= 32768 ? 15 : (n) >= 16384 ? 14 :        \
+     (n) >= 8192 ? 13 : (n) >= 4096 ? 12 : (n) >= 2048 ? 11 :           \
+     (n) >= 1024 ? 10 : (n) >= 512 ? 9 : (n) >= 256 ? 8 : (n) >= 128 ? 7 : \
+     (n) >= 64 ? 6 : (n) >= 32 ? 5 : (n) >= 16 ? 4 : (n) >= 8 ? 3 :     \
+     (n) >= 4 ? 2 : (n) >= 2 ? 1 : 0)
+
+#define FREQUENCY_WINDOW_BITS TABLES_LOG2(FREQUENCY_WINDOW_SIZE)
+
+#if (1 << FREQUENCY_WINDOW_BITS) != FREQUENCY_WINDOW_SIZE || FREQUENCY_WINDOW_SIZE < 4
+#error FREQUENCY_WINDOW_SIZE must be a power of two!
+#endif
+
+// The entropy table is indexed by the number of occurrences, from 0 to TIME_WINDOW_SIZE
+#define ENTROPY_TABLE_LEN (TIME_WINDOW_SIZE + 1)
+
+// The sine table has FFT_TABLE_SIZE steps in the range [0, pi)
+#define FFT_TABLE_SIZE (FREQUENCY_WINDOW_SIZE / 2)
+#define FFT_TABLE_BITS (FREQUENCY_WINDOW_BITS - 1)
+
+#if FFT_QUARTER_WAVE_TABLE
+#define SIN_TABLE_LEN (FFT_TABLE_SIZE / 2 + 1)
+#else
+#define SIN_TABLE_LEN FFT_TABLE_SIZE
+#endif
+
+// The log2 table has log2(1 + i / LOG2_TABLE_SIZE) in Q16, from i = 0 to LOG2_TABLE_SIZE
+#define LOG2_TABLE_BITS 6
+#define LOG2_TABLE_SIZE (1 << LOG2_TABLE_BITS)
+#define LOG2_TABLE_LEN  (LOG2_TABLE_SIZE + 1)
+
+#if FREQUENCY_WINDOW_SIZE <= 256
+typedef uint8_t bitrev_table_t;
+#else
+typedef uint16_t bitrev_table_t;
+#endif
+
+// -----------------------------------------------------------
+// The functions used to compute the values of the tables
+
+// -p * log2(p), where p = count / TIME_WINDOW_SIZE
+static inline float table_entropy_value(int count)
+{
+    double p = (double)count / TIME_WINDOW_SIZE;
+    if (count == 0 || count == TIME_WINDOW_SIZE) {
+        return 0.0f;
+    }
+    return (float)(-p * log2(p));
+}
+
+static inline float table_sin_value(int i)
+{
+    return (float)sin(M_PI * i / FFT_TABLE_SIZE);
+}
+
+static inline uint32_t table_log2_value(int i)
+{
+    return (uint32_t)(log2(1.0 + (double)i / LOG2_TABLE_SIZE) * 65536.0 + 0.5);
+}
+
+// reverse the bits in a n-bit word
+static inline uint16_t table_bitrev_value(uint16_t j, uint16_t nbits)
+{
+    uint16_t k = 0;
+    for (; nbits > 0; nbits--) {
+        k = (k << 1) + (j & 1);
+        j = j >> 1;
+    }
+    return k;
+}
+
+// -----------------------------------------------------------
+
+#ifndef TABLES_GENERATOR
+
+#if GENERATE_TABLES_AT_INIT
+
+static float entropy_lookup_table[ENTROPY_TABLE_LEN];
+static float sin_table[SIN_TABLE_LEN];
+static bitrev_table_t bitrev_table[FREQUENCY_WINDOW_SIZE];
+static uint32_t log2_lookup_table[LOG2_TABLE_LEN];
+
+static void tables_init(void)
+{
+    int i;
+    for (i = 0; i < ENTROPY_TABLE_LEN; ++i) {
+        entropy_lookup_table[i] = table_entropy_value(i);
+    }
+    for (i = 0; i < SIN_TABLE_LEN; ++i) {
+        sin_table[i] = table_sin_value(i);
+    }
+    for (i = 0; i < FREQUENCY_WINDOW_SIZE; ++i) {
+        bitrev_table[i] = table_bitrev_value(i, FREQUENCY_WINDOW_BITS);
+    }
+    for (i = 0; i < LOG2_TABLE_LEN; ++i) {
+        log2_lookup_table[i] = table_log2_value(i);
+    }
+}
+
+#else // GENERATE_TABLES_AT_INIT
+
+#include "tables-generated.h"
+
+#if TABLES_GENERATED_TIME_WINDOW_SIZE != TIME_WINDOW_SIZE \
+    || TABLES_GENERATED_FREQUENCY_WINDOW_SIZE != FREQUENCY_WINDOW_SIZE \
+    || TABLES_GENERATED_QUARTER_WAVE != FFT_QUARTER_WAVE_TABLE
+#error tables-generated.h is out of date, regenerate it with `make tables`
+#endif
+
+static inline void tables_init(void)
+{
+}
+
+#endif // GENERATE_TABLES_AT_INIT
+
+#endif // TABLES_GENERATOR
+
+#endif // TABLES_H
@@ -34,6 +34,9 @@
  * Features can be calculated on the result of these.
  */
 
+#include "sqrt.h"
+#include "angles.h"
+
 // -----------------------------------------------------------
 
 void transform_jerk(int axis)
@@ -94,6 +97,27 @@ void transform_magnitude(int axis)
     LOG("\n");
 }
 
+// in Q8
+void transform_magnitude_i(int axis)
+{
+    int i;
+    LOG("axis=%d\n", axis);
+    for (i = 0; i < NSAMPLES; i++) {
+        int x = data[i].v[0];
+        int y = data[i].v[1];
+        int z = data[i].v[2];
+
+        x *= x;
+        y *= y;
+        z *= z;
+
+        OUTPUT_I(isqrt_q8(x + y + z), result_i.v[axis]);
+        LOG("\n");
+    }
+    OUTPUT_I(0, result_i.v[axis]);
+    LOG("\n");
+}
+
 // -----------------------------------------------------------
 
 void transform_l1norm(int axis)
@@ -179,6 +203,367 @@ void transform_jerk_l1norm(int axis)
 
 // -----------------------------------------------------------
 
+// The orientation in radians, from the fast arc tangent;
+// the axis selects the pitch, the roll or the tilt (see angles.h)
+void transform_orientation(int axis)
+{
+    int i;
+    LOG("axis=%d\n", axis);
+    for (i = 0; i < NSAMPLES; i++) {
+        OUTPUT_F(orientation_angle_f(data[i].v[0], data[i].v[1], data[i].v[2], axis),
+                 result_f.v[axis]);
+        LOG("\n");
+    }
+    OUTPUT_F(0.0, result_f.v[axis]);
+    LOG("\n");
+}
+
+// in Q13, with the CORDIC
+void transform_orientation_i(int axis)
+{
+    int i;
+    LOG("axis=%d\n", axis);
+    for (i = 0; i < NSAMPLES; i++) {
+        OUTPUT_I(orientation_angle_q13(data[i].v[0], data[i].v[1], data[i].v[2], axis),
+                 result_i.v[axis]);
+        LOG("\n");
+    }
+    OUTPUT_I(0, result_i.v[axis]);
+    LOG("\n");
+}
+
+// -----------------------------------------------------------
+
+//
+// Block versions of the transforms.
+//
+// These read `n` samples from `in` and write the results to the caller-provided
+// buffer `out`, so that they can be used as inputs of other features.
+// The samples are processed TRANSFORM_BLOCK_SIZE at a time, in loops of a fixed length
+// with non-aliased inputs and outputs, which the compiler is able to vectorize
+// (the x, y and z values are split by `ld3` on NEON and by `pshufb` on SSSE3 and later).
+// The last, partial block is computed in a local buffer.
+//
+// The jerk versions produce `n` outputs from `n + 1` input samples.
+//
+
+#define TRANSFORM_BLOCK_SIZE 32
+
+static inline void transform_block_magnitude_sq(const accel_t *restrict in,
+                                                uint32_t *restrict r)
+{
+    int k;
+    for (k = 0; k < TRANSFORM_BLOCK_SIZE; ++k) {
+        int x = in[k].v[0];
+        int y = in[k].v[1];
+        int z = in[k].v[2];
+        r[k] = x * x + y * y + z * z;
+    }
+}
+
+static inline void transform_block_l1norm(const accel_t *restrict in,
+                                          uint16_t *restrict r)
+{
+    int k;
+    for (k = 0; k < TRANSFORM_BLOCK_SIZE; ++k) {
+        r[k] = abs(in[k].v[0]) + abs(in[k].v[1]) + abs(in[k].v[2]);
+    }
+}
+
+static inline void transform_block_jerk_magnitude_sq(const accel_t *restrict in,
+                                                     uint32_t *restrict r)
+{
+    int k;
+    for (k = 0; k < TRANSFORM_BLOCK_SIZE; ++k) {
+        int x = in[k + 1].v[0] - in[k].v[0];
+        int y = in[k + 1].v[1] - in[k].v[1];
+        int z = in[k + 1].v[2] - in[k].v[2];
+        r[k] = x * x + y * y + z * z;
+    }
+}
+
+static inline void transform_block_jerk_l1norm(const accel_t *restrict in,
+                                               uint16_t *restrict r)
+{
+    int k;
+    for (k = 0; k < TRANSFORM_BLOCK_SIZE; ++k) {
+        r[k] = abs(in[k + 1].v[0] - in[k].v[0])
+            + abs(in[k + 1].v[1] - in[k].v[1])
+            + abs(in[k + 1].v[2] - in[k].v[2]);
+    }
+}
+
+// in-place square root of a block (see sqrt.h)
+static inline void transform_block_sqrt(float *r)
+{
+    sqrt_block_f(r, TRANSFORM_BLOCK_SIZE);
+}
+
+static inline void transform_block_magnitude(const accel_t *restrict in,
+                                             float *restrict r)
+{
+    uint32_t sq[TRANSFORM_BLOCK_SIZE];
+    int k;
+    transform_block_magnitude_sq(in, sq);
+    for (k = 0; k < TRANSFORM_BLOCK_SIZE; ++k) {
+        r[k] = sq[k];
+    }
+    transform_block_sqrt(r);
+}
+
+static inline void transform_block_jerk_magnitude(const accel_t *restrict in,
+                                                  float *restrict r)
+{
+    uint32_t sq[TRANSFORM_BLOCK_SIZE];
+    int k;
+    transform_block_jerk_magnitude_sq(in, sq);
+    for (k = 0; k < TRANSFORM_BLOCK_SIZE; ++k) {
+        r[k] = sq[k];
+    }
+    transform_block_sqrt(r);
+}
+
+// the arguments of the arc tangent are split off first, so that each loop is vectorized
+static inline void transform_block_orientation(const accel_t *restrict in,
+                                               float *restrict r, int angle)
+{
+    float y[TRANSFORM_BLOCK_SIZE];
+    float x[TRANSFORM_BLOCK_SIZE];
+    int k;
+    switch (angle) {
+    case ORIENTATION_PITCH:
+        for (k = 0; k < TRANSFORM_BLOCK_SIZE; ++k) {
+            y[k] = -in[k].v[0];
+            x[k] = in[k].v[1] * in[k].v[1] + in[k].v[2] * in[k].v[2];
+        }
+        transform_block_sqrt(x);
+        break;
+    case ORIENTATION_ROLL:
+        for (k = 0; k < TRANSFORM_BLOCK_SIZE; ++k) {
+            y[k] = in[k].v[1];
+            x[k] = in[k].v[2];
+        }
+        break;
+    default:
+        for (k = 0; k < TRANSFORM_BLOCK_SIZE; ++k) {
+            y[k] = in[k].v[0] * in[k].v[0] + in[k].v[1] * in[k].v[1];
+            x[k] = in[k].v[2];
+        }
+        transform_block_sqrt(y);
+        break;
+    }
+    atan2_block_f(y, x, r, TRANSFORM_BLOCK_SIZE);
+}
+
+static inline void transform_block_pitch(const accel_t *restrict in, float *restrict r)
+{
+    transform_block_orientation(in, r, ORIENTATION_PITCH);
+}
+
+static inline void transform_block_roll(const accel_t *restrict in, float *restrict r)
+{
+    transform_block_orientation(in, r, ORIENTATION_ROLL);
+}
+
+static inline void transform_block_tilt(const accel_t *restrict in, float *restrict r)
+{
+    transform_block_orientation(in, r, ORIENTATION_TILT);
+}
+
+// -----------------------------------------------------------
+
+// Run a block function over `n` outputs, `extra` is the number of additional inputs needed
+#define TRANSFORM_BLOCKS(block_function, in, out, n, extra)             \
+    do {                                                                \
+        int _i;                                                         \
+        for (_i = 0; _i + TRANSFORM_BLOCK_SIZE <= (n); _i += TRANSFORM_BLOCK_SIZE) { \
+            block_function(&(in)[_i], &(out)[_i]);                      \
+        }                                                               \
+        if (_i < (n)) {                                                 \
+            accel_t _tail_in[TRANSFORM_BLOCK_SIZE + 1] = {0};           \
+            __typeof__((out)[0]) _tail_out[TRANSFORM_BLOCK_SIZE];       \
+            memcpy(_tail_in, &(in)[_i], ((n) - _i + (extra)) * sizeof(accel_t)); \
+            block_function(_tail_in, _tail_out);                        \
+            memcpy(&(out)[_i], _tail_out, ((n) - _i) * sizeof((out)[0])); \
+        }                                                               \
+    } while (0)
+
+void transform_magnitude_sq_block(const accel_t in[], uint32_t out[], int n)
+{
+    TRANSFORM_BLOCKS(transform_block_magnitude_sq, in, out, n, 0);
+}
+
+void transform_magnitude_block(const accel_t in[], float out[], int n)
+{
+    TRANSFORM_BLOCKS(transform_block_magnitude, in, out, n, 0);
+}
+
+void transform_l1norm_block(const accel_t in[], uint16_t out[], int n)
+{
+    TRANSFORM_BLOCKS(transform_block_l1norm, in, out, n, 0);
+}
+
+void transform_jerk_block(const accel_t in[], int16_t out[], int n, int axis)
+{
+    int i;
+    for (i = 0; i < n; i++) {
+        out[i] = in[i + 1].v[axis] - in[i].v[axis];
+    }
+}
+
+void transform_jerk_magnitude_sq_block(const accel_t in[], uint32_t out[], int n)
+{
+    TRANSFORM_BLOCKS(transform_block_jerk_magnitude_sq, in, out, n, 1);
+}
+
+void transform_jerk_magnitude_block(const accel_t in[], float out[], int n)
+{
+    TRANSFORM_BLOCKS(transform_block_jerk_magnitude, in, out, n, 1);
+}
+
+void transform_jerk_l1norm_block(const accel_t in[], uint16_t out[], int n)
+{
+    TRANSFORM_BLOCKS(transform_block_jerk_l1norm, in, out, n, 1);
+}
+
+// `angle` is one of ORIENTATION_PITCH, ORIENTATION_ROLL and ORIENTATION_TILT
+void transform_orientation_block(const accel_t in[], float out[], int n, int angle)
+{
+    switch (angle) {
+    case ORIENTATION_PITCH:
+        TRANSFORM_BLOCKS(transform_block_pitch, in, out, n, 0);
+        break;
+    case ORIENTATION_ROLL:
+        TRANSFORM_BLOCKS(transform_block_roll, in, out, n, 0);
+        break;
+    default:
+        TRANSFORM_BLOCKS(transform_block_tilt, in, out, n, 0);
+        break;
+    }
+}
+
+// -----------------------------------------------------------
+
+//
+// Benchmarks of the block versions. The output has the same format
+// as the per-sample versions above, including the trailing zero.
+//
+#define TRANSFORM_OUTPUT_SIZE 1024
+
+void transform_magnitude_sq_v(int axis)
+{
+    int i;
+    uint32_t out[TRANSFORM_OUTPUT_SIZE];
+    LOG("axis=%d\n", axis);
+    for (i = 0; i < NSAMPLES; i += TRANSFORM_OUTPUT_SIZE) {
+        int n = min(NSAMPLES - i, TRANSFORM_OUTPUT_SIZE);
+        transform_magnitude_sq_block(&data[i], out, n);
+        OUTPUT_BLOCK_I(out, n, result_i.v[axis]);
+    }
+    OUTPUT_I(0, result_i.v[axis]);
+    LOG("\n");
+}
+
+void transform_magnitude_v(int axis)
+{
+    int i;
+    float out[TRANSFORM_OUTPUT_SIZE];
+    LOG("axis=%d\n", axis);
+    for (i = 0; i < NSAMPLES; i += TRANSFORM_OUTPUT_SIZE) {
+        int n = min(NSAMPLES - i, TRANSFORM_OUTPUT_SIZE);
+        transform_magnitude_block(&data[i], out, n);
+        OUTPUT_BLOCK_F(out, n, result_f.v[axis]);
+    }
+    OUTPUT_F(0.0, result_f.v[axis]);
+    LOG("\n");
+}
+
+void transform_l1norm_v(int axis)
+{
+    int i;
+    uint16_t out[TRANSFORM_OUTPUT_SIZE];
+    LOG("axis=%d\n", axis);
+    for (i = 0; i < NSAMPLES; i += TRANSFORM_OUTPUT_SIZE) {
+        int n = min(NSAMPLES - i, TRANSFORM_OUTPUT_SIZE);
+        transform_l1norm_block(&data[i], out, n);
+        OUTPUT_BLOCK_I(out, n, result_i.v[axis]);
+    }
+    OUTPUT_I(0, result_i.v[axis]);
+    LOG("\n");
+}
+
+void transform_jerk_v(int axis)
+{
+    int i;
+    int16_t out[TRANSFORM_OUTPUT_SIZE];
+    LOG("axis=%d\n", axis);
+    for (i = 0; i < NSAMPLES - 1; i += TRANSFORM_OUTPUT_SIZE) {
+        int n = min(NSAMPLES - 1 - i, TRANSFORM_OUTPUT_SIZE);
+        transform_jerk_block(&data[i], out, n, axis);
+        OUTPUT_BLOCK_I(out, n, result_i.v[axis]);
+    }
+    OUTPUT_I(0, result_i.v[axis]);
+    LOG("\n");
+}
+
+void transform_jerk_magnitude_sq_v(int axis)
+{
+    int i;
+    uint32_t out[TRANSFORM_OUTPUT_SIZE];
+    LOG("axis=%d\n", axis);
+    for (i = 0; i < NSAMPLES - 1; i += TRANSFORM_OUTPUT_SIZE) {
+        int n = min(NSAMPLES - 1 - i, TRANSFORM_OUTPUT_SIZE);
+        transform_jerk_magnitude_sq_block(&data[i], out, n);
+        OUTPUT_BLOCK_I(out, n, result_i.v[axis]);
+    }
+    OUTPUT_I(0, result_i.v[axis]);
+    LOG("\n");
+}
+
+void transform_jerk_magnitude_v(int axis)
+{
+    int i;
+    float out[TRANSFORM_OUTPUT_SIZE];
+    LOG("axis=%d\n", axis);
+    for (i = 0; i < NSAMPLES - 1; i += TRANSFORM_OUTPUT_SIZE) {
+        int n = min(NSAMPLES - 1 - i, TRANSFORM_OUTPUT_SIZE);
+        transform_jerk_magnitude_block(&data[i], out, n);
+        OUTPUT_BLOCK_F(out, n, result_f.v[axis]);
+    }
+    OUTPUT_F(0.0, result_f.v[axis]);
+    LOG("\n");
+}
+
+void transform_jerk_l1norm_v(int axis)
+{
+    int i;
+    uint16_t out[TRANSFORM_OUTPUT_SIZE];
+    LOG("axis=%d\n", axis);
+    for (i = 0; i < NSAMPLES - 1; i += TRANSFORM_OUTPUT_SIZE) {
+        int n = min(NSAMPLES - 1 - i, TRANSFORM_OUTPUT_SIZE);
+        transform_jerk_l1norm_block(&data[i], out, n);
+        OUTPUT_BLOCK_I(out, n, result_i.v[axis]);
+    }
+    OUTPUT_I(0, result_i.v[axis]);
+    LOG("\n");
+}
+
+void transform_orientation_v(int axis)
+{
+    int i;
+    float out[TRANSFORM_OUTPUT_SIZE];
+    LOG("axis=%d\n", axis);
+    for (i = 0; i < NSAMPLES; i += TRANSFORM_OUTPUT_SIZE) {
+        int n = min(NSAMPLES - i, TRANSFORM_OUTPUT_SIZE);
+        transform_orientation_block(&data[i], out, n, axis);
+        OUTPUT_BLOCK_F(out, n, result_f.v[axis]);
+    }
+    OUTPUT_F(0.0, result_f.v[axis]);
+    LOG("\n");
+}
+
+// -----------------------------------------------------------
+
 static inline int median(int a, int b, int c)
 {
     if (a > b) {
@@ -222,3 +607,240 @@ void filter_median(int axis)
 }
 
 // -----------------------------------------------------------
+
+//
+// Running median filter with an arbitrary odd width, up to MEDIAN_FILTER_MAX_WIDTH.
+//
+// For streaming use, the last `width` samples are kept in a histogram
+// of the int8 values together with the bin of the current median and
+// the number of samples below it. When a sample enters and another one
+// leaves the window, the median moves by at most a few bins, so each output
+// costs O(1) in practice (O(256) in the worst case), independent of the width.
+//
+// For small widths the samples are instead filtered in blocks: the block
+// is copied into `width` rows, each shifted by one sample, and the rows
+// are sorted with an odd-even transposition network of min/max operations.
+// The middle row then holds the medians for the whole block. The operations
+// are branchless and work on whole rows, so the compiler vectorizes them.
+//
+
+// The maximal width of the filter; the widths must be odd and at most this,
+// the other widths are rejected
+#ifndef MEDIAN_FILTER_MAX_WIDTH
+#define MEDIAN_FILTER_MAX_WIDTH 63
+#endif
+
+// Use the sorting network for widths up to this
+#ifndef MEDIAN_FILTER_NETWORK_MAX_WIDTH
+#define MEDIAN_FILTER_NETWORK_MAX_WIDTH 9
+#endif
+
+// the width, the count and the position of the running filter are bytes
+#if MEDIAN_FILTER_MAX_WIDTH > 255
+#error MEDIAN_FILTER_MAX_WIDTH must not be larger than 255
+#endif
+
+#if MEDIAN_FILTER_NETWORK_MAX_WIDTH > MEDIAN_FILTER_MAX_WIDTH
+#error MEDIAN_FILTER_NETWORK_MAX_WIDTH must not be larger than MEDIAN_FILTER_MAX_WIDTH
+#endif
+
+// The number of outputs produced by the sorting network at once
+#define MEDIAN_FILTER_BLOCK 64
+
+typedef struct {
+    uint16_t bins[256];
+    int8_t history[MEDIAN_FILTER_MAX_WIDTH];
+    uint8_t width;
+    uint8_t count;
+    uint8_t pos;
+    // the bin of the current median, and the number of samples in the bins below it
+    uint8_t median;
+    uint8_t below;
+} running_median_t;
+
+static inline bool median_filter_width_is_valid(int width)
+{
+    return width > 0 && width <= MEDIAN_FILTER_MAX_WIDTH && (width & 1);
+}
+
+// Returns false if the width is even or larger than MEDIAN_FILTER_MAX_WIDTH
+bool running_median_init(running_median_t *m, int width)
+{
+    if (!median_filter_width_is_valid(width)) {
+        return false;
+    }
+    memset(m, 0, sizeof(*m));
+    m->width = width;
+    m->median = 128;
+    return true;
+}
+
+//
+// Add a new sample and return the median of the last `width` samples
+// (of all samples, if less than `width` have been added so far).
+//
+int running_median_push(running_median_t *m, int8_t x)
+{
+    int half;
+    uint8_t v = x + 128;
+
+    if (m->count == m->width) {
+        // remove the oldest sample
+        uint8_t old = m->history[m->pos] + 128;
+        m->bins[old]--;
+        if (old < m->median) {
+            m->below--;
+        }
+    } else {
+        m->count++;
+    }
+
+    m->bins[v]++;
+    if (v < m->median) {
+        m->below++;
+    }
+    m->history[m->pos] = x;
+    if (++m->pos == m->width) {
+        m->pos = 0;
+    }
+
+    // move the median to the bin that contains the sample with index `half`
+    half = (m->count - 1) / 2;
+    while (m->below > half) {
+        m->median--;
+        m->below -= m->bins[m->median];
+    }
+    while (m->below + m->bins[m->median] <= half) {
+        m->below += m->bins[m->median];
+        m->median++;
+    }
+
+    return m->median - 128;
+}
+
+// -----------------------------------------------------------
+
+static inline void median_compare_exchange(int8_t *restrict a, int8_t *restrict b)
+{
+    int i;
+    for (i = 0; i < MEDIAN_FILTER_BLOCK; ++i) {
+        int8_t lo = a[i] < b[i] ? a[i] : b[i];
+        int8_t hi = a[i] < b[i] ? b[i] : a[i];
+        a[i] = lo;
+        b[i] = hi;
+    }
+}
+
+//
+// Compute MEDIAN_FILTER_BLOCK outputs of the filter: out[i] = median(x[i], ..., x[i + width - 1]).
+// `x` must have MEDIAN_FILTER_BLOCK + width - 1 samples, and the width must be valid
+// and at most MEDIAN_FILTER_NETWORK_MAX_WIDTH.
+//
+void median_filter_network(const int8_t x[], int8_t out[MEDIAN_FILTER_BLOCK], int width)
+{
+    int8_t rows[MEDIAN_FILTER_NETWORK_MAX_WIDTH][MEDIAN_FILTER_BLOCK];
+    int r, round;
+
+    for (r = 0; r < width; ++r) {
+        memcpy(rows[r], &x[r], MEDIAN_FILTER_BLOCK);
+    }
+
+    // odd-even transposition sort: `width` rounds sort `width` rows
+    for (round = 0; round < width; ++round) {
+        for (r = round & 1; r + 1 < width; r += 2) {
+            median_compare_exchange(rows[r], rows[r + 1]);
+        }
+    }
+
+    memcpy(out, rows[width / 2], MEDIAN_FILTER_BLOCK);
+}
+
+// -----------------------------------------------------------
+
+void filter_median_histogram(int axis, int width)
+{
+    int i;
+    running_median_t m;
+    LOG("axis=%d\n", axis);
+
+    if (!running_median_init(&m, width)) {
+        return;
+    }
+    for (i = 0; i < width - 1; i++) {
+        running_median_push(&m, data[i].v[axis]);
+    }
+    for (i = 0; i < width / 2; i++) {
+        OUTPUT_I(0, result_i.v[axis]);
+    }
+    for (i = width - 1; i < NSAMPLES; i++) {
+        int med = running_median_push(&m, data[i].v[axis]);
+        OUTPUT_I(med, result_i.v[axis]);
+        LOG("\n");
+    }
+    for (i = 0; i < width / 2; i++) {
+        OUTPUT_I(0, result_i.v[axis]);
+    }
+    LOG("\n");
+}
+
+void filter_median_network(int axis, int width)
+{
+    int i, j;
+    int8_t x[MEDIAN_FILTER_BLOCK + MEDIAN_FILTER_NETWORK_MAX_WIDTH - 1] = {0};
+    int8_t out[MEDIAN_FILTER_BLOCK];
+    LOG("axis=%d\n", axis);
+
+    if (!median_filter_width_is_valid(width) || width > MEDIAN_FILTER_NETWORK_MAX_WIDTH) {
+        return;
+    }
+    for (i = 0; i < width / 2; i++) {
+        OUTPUT_I(0, result_i.v[axis]);
+    }
+    for (i = 0; i < NSAMPLES - width + 1; i += MEDIAN_FILTER_BLOCK) {
+        int n = min(MEDIAN_FILTER_BLOCK, NSAMPLES - width + 1 - i);
+        for (j = 0; j < n + width - 1; ++j) {
+            x[j] = data[i + j].v[axis];
+        }
+        median_filter_network(x, out, width);
+        for (j = 0; j < n; ++j) {
+            OUTPUT_I(out[j], result_i.v[axis]);
+            LOG("\n");
+        }
+    }
+    for (i = 0; i < width / 2; i++) {
+        OUTPUT_I(0, result_i.v[axis]);
+    }
+    LOG("\n");
+}
+
+// Outputs nothing if the width is even or larger than MEDIAN_FILTER_MAX_WIDTH
+void filter_median_k(int axis, int width)
+{
+    if (width <= MEDIAN_FILTER_NETWORK_MAX_WIDTH) {
+        filter_median_network(axis, width);
+    } else {
+        filter_median_histogram(axis, width);
+    }
+}
+
+void filter_median5(int axis)
+{
+    filter_median_k(axis, 5);
+}
+
+void filter_median9(int axis)
+{
+    filter_median_k(axis, 9);
+}
+
+void filter_median9_histogram(int axis)
+{
+    filter_median_histogram(axis, 9);
+}
+
+void filter_median15(int axis)
+{
+    filter_median_k(axis, 15);
+}
+
+// -----------------------------------------------------------
@@ -0,0 +1,706 @@
+/*
+ * Copyright (c) 2019, Institute of Electronics and Computer Science (EDI)
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * Author: Atis Elsts
+ */
+
+/*
+ * File: window-features.h
+ * The time domain features of a single window of TIME_WINDOW_SIZE samples.
+ *
+ * These are shared by the feature functions, which run them over `data`,
+ * and by the library (libfeatures.c), which runs them over the caller's samples.
+ */
+
+#ifndef WINDOW_FEATURES_H
+#define WINDOW_FEATURES_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <limits.h>
+#include <string.h>
+#include <math.h>
+#include "main.h"
+#include "tables.h"
+#include "sqrt.h"
+#include "angles.h"
+
+// -----------------------------------------------------------
+
+// The integer mean and mean of squares
+typedef struct {
+    int32_t avg;
+    int32_t squared_avg;
+} window_moments_t;
+
+// From the sum and the sum of squares of the window, e.g. kept as running sums
+static inline void window_moments_from_sums(window_sum_t sum, window_sqsum_t sqsum,
+                                            window_moments_t *m)
+{
+    m->avg = sum / TIME_WINDOW_SIZE;
+    m->squared_avg = sqsum / TIME_WINDOW_SIZE;
+}
+
+static inline void window_moments(const accel_t *w, int axis, window_moments_t *m)
+{
+    int j;
+    window_sum_t sum = 0;
+    window_sqsum_t sqsum = 0;
+    for (j = 0; j < TIME_WINDOW_SIZE; ++j) {
+        sum += w[j].v[axis];
+        sqsum += (int)w[j].v[axis] * w[j].v[axis];
+    }
+    window_moments_from_sums(sum, sqsum, m);
+}
+
+// The roots in fixed point: Q8 for energy and std, Q15 for the correlation.
+// These need no FPU; with INTEGER_SQRT, the float versions below use them as well.
+
+// this is also known as root mean square
+static inline uint32_t window_energy_q8(const window_moments_t *m)
+{
+    return isqrt_q8(m->squared_avg);
+}
+
+static inline uint32_t window_std_q8(const window_moments_t *m)
+{
+    return isqrt_q8(m->squared_avg - m->avg * m->avg);
+}
+
+static inline float window_energy(const window_moments_t *m)
+{
+#if INTEGER_SQRT
+    return window_energy_q8(m) / 256.0f;
+#else
+    return sqrtf(m->squared_avg);
+#endif
+}
+
+static inline float window_std(const window_moments_t *m)
+{
+#if INTEGER_SQRT
+    return window_std_q8(m) / 256.0f;
+#else
+    return sqrtf(m->squared_avg - m->avg * m->avg);
+#endif
+}
+
+// -----------------------------------------------------------
+
+// The variances of two axes and their covariance, times N^2, from the sums of the axes
+// and the sum of their products. These are exact: the means are not truncated, unlike
+// those of window_moments_t. They are below N^2 * 2^14, so 64 bits hold them.
+typedef struct {
+    int64_t var1;
+    int64_t var2;
+    int64_t cov;
+} window_covariance_t;
+
+static inline void window_covariance_from_sums(window_sum_t sum1, window_sqsum_t sqsum1,
+                                               window_sum_t sum2, window_sqsum_t sqsum2,
+                                               window_sum_t msum, window_covariance_t *c)
+{
+    c->var1 = (int64_t)TIME_WINDOW_SIZE * sqsum1 - (int64_t)sum1 * sum1;
+    c->var2 = (int64_t)TIME_WINDOW_SIZE * sqsum2 - (int64_t)sum2 * sum2;
+    c->cov = (int64_t)TIME_WINDOW_SIZE * msum - (int64_t)sum1 * sum2;
+}
+
+// The std in Q8 from a variance times N^2
+static inline uint32_t window_covariance_std_q8(int64_t var)
+{
+    return isqrt32(((uint64_t)var << 16) / ((uint64_t)TIME_WINDOW_SIZE * TIME_WINDOW_SIZE));
+}
+
+// The shift that leaves x > 0 below 2^16
+static inline int window_covariance_shift(int64_t x)
+{
+    int bits = 64 - __builtin_clzll(x);
+    return bits > 16 ? bits - 16 : 0;
+}
+
+// The correlation in Q15: the covariance times 1/sqrt(var1 * var2). The variances
+// are shifted below 2^16 each for `irsqrt()`, and the covariance by half of the shifts.
+static inline int32_t window_covariance_correlation_q15(const window_covariance_t *c)
+{
+    int shift, shift1, shift2;
+    uint32_t r;
+    int64_t e;
+
+    if (c->var1 == 0 || c->var2 == 0) {
+        return 0;
+    }
+    shift1 = window_covariance_shift(c->var1);
+    shift2 = window_covariance_shift(c->var2);
+    // an even total; the one that is shifted is at least 2^15, so it stays nonzero
+    if ((shift1 + shift2) & 1) {
+        if (shift1) {
+            shift1++;
+        } else {
+            shift2++;
+        }
+    }
+    r = irsqrt((uint32_t)(c->var1 >> shift1) * (uint32_t)(c->var2 >> shift2), &shift);
+    e = c->cov >> ((shift1 + shift2) / 2);
+    // e * r * 2^-(16 + shift) in Q15
+    return (e * r) >> (1 + shift);
+}
+
+// The correlation in Q15 from the sums of the two axes and the sum of their products
+static inline int32_t window_correlation_q15_from_sums(window_sum_t sum1, window_sqsum_t sqsum1,
+                                                       window_sum_t sum2, window_sqsum_t sqsum2,
+                                                       window_sum_t msum)
+{
+    window_covariance_t c;
+    window_covariance_from_sums(sum1, sqsum1, sum2, sqsum2, msum, &c);
+    return window_covariance_correlation_q15(&c);
+}
+
+// The correlation from the sums of the two axes and the sum of their products
+static inline float window_correlation_from_sums(window_sum_t sum1, window_sqsum_t sqsum1,
+                                                 window_sum_t sum2, window_sqsum_t sqsum2,
+                                                 window_sum_t msum,
+                                                 float *std1_out, float *std2_out)
+{
+    window_covariance_t c;
+    window_covariance_from_sums(sum1, sqsum1, sum2, sqsum2, msum, &c);
+#if INTEGER_SQRT
+    if (std1_out) {
+        *std1_out = window_covariance_std_q8(c.var1) / 256.0f;
+    }
+    if (std2_out) {
+        *std2_out = window_covariance_std_q8(c.var2) / 256.0f;
+    }
+    return window_covariance_correlation_q15(&c) / 32768.0f;
+#else
+    // the scaling by N is exact in floating point
+    float std1 = sqrtf(c.var1) / TIME_WINDOW_SIZE;
+    float std2 = sqrtf(c.var2) / TIME_WINDOW_SIZE;
+    float cov = c.cov / ((float)TIME_WINDOW_SIZE * TIME_WINDOW_SIZE);
+    float corr = (std1 == 0 || std2 == 0) ? 0 : cov / (std1 * std2);
+
+    if (std1_out) {
+        *std1_out = std1;
+    }
+    if (std2_out) {
+        *std2_out = std2;
+    }
+    return corr;
+#endif
+}
+
+static inline void window_correlation_sums(const accel_t *w, int axis1, int axis2,
+                                           window_sum_t *sum1, window_sqsum_t *sqsum1,
+                                           window_sum_t *sum2, window_sqsum_t *sqsum2,
+                                           window_sum_t *msum)
+{
+    int j;
+    *sum1 = *sum2 = *msum = 0;
+    *sqsum1 = *sqsum2 = 0;
+    for (j = 0; j < TIME_WINDOW_SIZE; ++j) {
+        *sum1 += w[j].v[axis1];
+        *sqsum1 += (int)w[j].v[axis1] * w[j].v[axis1];
+
+        *sum2 += w[j].v[axis2];
+        *sqsum2 += (int)w[j].v[axis2] * w[j].v[axis2];
+
+        *msum += (int)w[j].v[axis1] * w[j].v[axis2];
+    }
+}
+
+// The correlation of two axes; optionally returns their std as well
+static inline float window_correlation(const accel_t *w, int axis1, int axis2,
+                                       float *std1_out, float *std2_out)
+{
+    window_sum_t sum1, sum2, msum;
+    window_sqsum_t sqsum1, sqsum2;
+    window_correlation_sums(w, axis1, axis2, &sum1, &sqsum1, &sum2, &sqsum2, &msum);
+    return window_correlation_from_sums(sum1, sqsum1, sum2, sqsum2, msum, std1_out, std2_out);
+}
+
+// The same in Q15
+static inline int32_t window_correlation_q15(const accel_t *w, int axis1, int axis2)
+{
+    window_sum_t sum1, sum2, msum;
+    window_sqsum_t sqsum1, sqsum2;
+    window_correlation_sums(w, axis1, axis2, &sum1, &sqsum1, &sum2, &sqsum2, &msum);
+    return window_correlation_q15_from_sums(sum1, sqsum1, sum2, sqsum2, msum);
+}
+
+// -----------------------------------------------------------
+//
+// Skewness and kurtosis, from the sums of the first four powers of the values.
+// The sums are exact: |v|^4 <= 2^28, so 64 bits hold them for any window size,
+// and like the other sums they can be kept for the hops of a window and added up.
+// The central moments are derived from them in double precision; the values are
+// at most 2^28, so little is lost in the cancellation.
+
+typedef struct {
+    window_sum_t sum;
+    window_sqsum_t sqsum;
+    int64_t cubesum;
+    uint64_t quartsum;
+} window_powers_t;
+
+// The sums of `n` samples
+static inline void window_powers(const accel_t *w, int axis, int n, window_powers_t *p)
+{
+    int j;
+    window_sum_t sum = 0;
+    window_sqsum_t sqsum = 0;
+    int64_t cubesum = 0;
+    uint64_t quartsum = 0;
+    for (j = 0; j < n; ++j) {
+        int v = w[j].v[axis];
+        int v2 = v * v;
+        sum += v;
+        sqsum += v2;
+        cubesum += v2 * v;
+        quartsum += (uint32_t)(v2 * v2);
+    }
+    p->sum = sum;
+    p->sqsum = sqsum;
+    p->cubesum = cubesum;
+    p->quartsum = quartsum;
+}
+
+static inline void window_powers_add(window_powers_t *p, const window_powers_t *a,
+                                     const window_powers_t *b)
+{
+    p->sum = a->sum + b->sum;
+    p->sqsum = a->sqsum + b->sqsum;
+    p->cubesum = a->cubesum + b->cubesum;
+    p->quartsum = a->quartsum + b->quartsum;
+}
+
+// The second, third and fourth central moments of a window
+static inline void window_central_moments(const window_powers_t *p, double m[3])
+{
+    double mean = (double)p->sum / TIME_WINDOW_SIZE;
+    double mean2 = mean * mean;
+    double s2 = (double)p->sqsum / TIME_WINDOW_SIZE;
+    double s3 = (double)p->cubesum / TIME_WINDOW_SIZE;
+    double s4 = (double)p->quartsum / TIME_WINDOW_SIZE;
+
+    m[0] = s2 - mean2;
+    m[1] = s3 - 3 * mean * s2 + 2 * mean * mean2;
+    m[2] = s4 - 4 * mean * s3 + 6 * mean2 * s2 - 3 * mean2 * mean2;
+}
+
+// zero for a constant window
+static inline float window_skewness(const window_powers_t *p)
+{
+    double m[3];
+    window_central_moments(p, m);
+    return m[0] > 0 ? m[1] / (m[0] * sqrt(m[0])) : 0.0;
+}
+
+// The excess kurtosis, i.e. zero for the normal distribution; also zero for a constant window
+static inline float window_kurtosis(const window_powers_t *p)
+{
+    double m[3];
+    window_central_moments(p, m);
+    return m[0] > 0 ? m[2] / (m[0] * m[0]) - 3.0 : 0.0;
+}
+
+// -----------------------------------------------------------
+//
+// The covariances and correlations of all three pairs of axes, and the mean and std
+// of each axis, from one set of sums: the sums and the sums of squares of the axes,
+// and the sums of the products of the pairs. The pair `a` is the axis `a` with the
+// axis `(a + 1) % NUM_AXIS` (xy, yz, zx), the same as in `feature_correlation`.
+// The mean is the integer one, as of `feature_mean`; the std and the covariances
+// are exact, as in the correlation (see window_covariance_t).
+// The sums are additive, so those of a window are also those of its hops added up.
+
+typedef struct {
+    window_sum_t sum[NUM_AXIS];
+    window_sqsum_t sqsum[NUM_AXIS];
+    window_sum_t msum[NUM_AXIS];
+} window_cross_sums_t;
+
+typedef struct {
+    int32_t avg[NUM_AXIS];
+    float std[NUM_AXIS];
+    float cov[NUM_AXIS];
+    float corr[NUM_AXIS];
+} window_correlation_matrix_t;
+
+// The sums of `n` samples
+static inline void window_cross_sums(const accel_t *w, int n, window_cross_sums_t *s)
+{
+    int j;
+    window_sum_t x = 0, y = 0, z = 0, xy = 0, yz = 0, zx = 0;
+    window_sqsum_t xx = 0, yy = 0, zz = 0;
+    for (j = 0; j < n; ++j) {
+        int vx = w[j].v[0];
+        int vy = w[j].v[1];
+        int vz = w[j].v[2];
+        x += vx;
+        y += vy;
+        z += vz;
+        xx += vx * vx;
+        yy += vy * vy;
+        zz += vz * vz;
+        xy += vx * vy;
+        yz += vy * vz;
+        zx += vz * vx;
+    }
+    s->sum[0] = x;
+    s->sum[1] = y;
+    s->sum[2] = z;
+    s->sqsum[0] = xx;
+    s->sqsum[1] = yy;
+    s->sqsum[2] = zz;
+    s->msum[0] = xy;
+    s->msum[1] = yz;
+    s->msum[2] = zx;
+}
+
+static inline void window_cross_sums_add(window_cross_sums_t *s, const window_cross_sums_t *a,
+                                         const window_cross_sums_t *b)
+{
+    int i;
+    for (i = 0; i < NUM_AXIS; ++i) {
+        s->sum[i] = a->sum[i] + b->sum[i];
+        s->sqsum[i] = a->sqsum[i] + b->sqsum[i];
+        s->msum[i] = a->msum[i] + b->msum[i];
+    }
+}
+
+// The sums must be those of a whole window. The correlations reuse the covariances and
+// the std of the axes, and are the same as those of `window_correlation_from_sums`.
+static inline void window_correlation_matrix_from_sums(const window_cross_sums_t *s,
+                                                       window_correlation_matrix_t *m)
+{
+    int64_t var[NUM_AXIS];
+    int i;
+    for (i = 0; i < NUM_AXIS; ++i) {
+        m->avg[i] = s->sum[i] / TIME_WINDOW_SIZE;
+        var[i] = (int64_t)TIME_WINDOW_SIZE * s->sqsum[i] - (int64_t)s->sum[i] * s->sum[i];
+#if INTEGER_SQRT
+        m->std[i] = window_covariance_std_q8(var[i]) / 256.0f;
+#else
+        m->std[i] = sqrtf(var[i]) / TIME_WINDOW_SIZE;
+#endif
+    }
+    for (i = 0; i < NUM_AXIS; ++i) {
+        int next = (i + 1) % NUM_AXIS;
+        window_covariance_t c;
+        c.var1 = var[i];
+        c.var2 = var[next];
+        c.cov = (int64_t)TIME_WINDOW_SIZE * s->msum[i] - (int64_t)s->sum[i] * s->sum[next];
+        m->cov[i] = c.cov / ((float)TIME_WINDOW_SIZE * TIME_WINDOW_SIZE);
+#if INTEGER_SQRT
+        m->corr[i] = window_covariance_correlation_q15(&c) / 32768.0f;
+#else
+        m->corr[i] = (m->std[i] == 0 || m->std[next] == 0) ? 0
+            : m->cov[i] / (m->std[i] * m->std[next]);
+#endif
+    }
+}
+
+static inline void window_correlation_matrix(const accel_t *w, window_correlation_matrix_t *m)
+{
+    window_cross_sums_t s;
+    window_cross_sums(w, TIME_WINDOW_SIZE, &s);
+    window_correlation_matrix_from_sums(&s, m);
+}
+
+// -----------------------------------------------------------
+//
+// Crossings and peaks. A crossing of the level `t` is a pair of consecutive samples
+// with one of them below `t` and the other not. A peak is a local maximum above `t`:
+// a sample larger than the next one, reached by a rise and possibly a plateau after it.
+// The peak is at the last sample of the plateau, so that a plateau counts once and the
+// steps of a staircase do not count at all. The mean crossings and the peaks use the integer
+// mean of the window as the level, e.g. from its sums (see window-lanes.h).
+// The loops have no branches.
+
+static inline int window_crossings(const accel_t *w, int axis, int level)
+{
+    int j;
+    int count = 0;
+    for (j = 0; j < TIME_WINDOW_SIZE - 1; ++j) {
+        count += (w[j].v[axis] >= level) != (w[j + 1].v[axis] >= level);
+    }
+    return count;
+}
+
+// The number of peaks, and the positions of the first and the last one
+typedef struct {
+    int count;
+    int first;
+    int last;
+} window_peaks_t;
+
+static inline void window_peaks(const accel_t *w, int axis, int level, window_peaks_t *p)
+{
+    int j;
+    int count = 0;
+    int first = TIME_WINDOW_SIZE;
+    int last = 0;
+    // whether the last change of the values was a rise
+    int rising = 0;
+    for (j = 1; j < TIME_WINDOW_SIZE - 1; ++j) {
+        int v = w[j].v[axis];
+        int prev = w[j - 1].v[axis];
+        int is_peak;
+        rising = (v > prev) | (rising & (v >= prev));
+        is_peak = rising & (v > w[j + 1].v[axis]) & (v > level);
+        count += is_peak;
+        first = min(first, is_peak ? j : TIME_WINDOW_SIZE);
+        last = max(last, is_peak ? j : 0);
+    }
+    p->count = count;
+    p->first = first;
+    p->last = last;
+}
+
+// The mean interval between the peaks, in samples; zero if there are less than two
+static inline float window_peak_interval(const window_peaks_t *p)
+{
+    return p->count > 1 ? (float)(p->last - p->first) / (p->count - 1) : 0.0f;
+}
+
+// -----------------------------------------------------------
+
+// Signal magnitude area: the mean of the absolute values
+static inline int window_sma(const accel_t *w, int axis)
+{
+    int j;
+    uint32_t abssum = 0;
+    for (j = 0; j < TIME_WINDOW_SIZE; ++j) {
+        abssum += abs(w[j].v[axis]);
+    }
+    return abssum / TIME_WINDOW_SIZE;
+}
+
+static inline int window_min(const accel_t *w, int axis)
+{
+    int j;
+    int minval = INT_MAX;
+    for (j = 0; j < TIME_WINDOW_SIZE; ++j) {
+        minval = min(minval, w[j].v[axis]);
+    }
+    return minval;
+}
+
+static inline int window_max(const accel_t *w, int axis)
+{
+    int j;
+    int maxval = INT_MIN;
+    for (j = 0; j < TIME_WINDOW_SIZE; ++j) {
+        maxval = max(maxval, w[j].v[axis]);
+    }
+    return maxval;
+}
+
+// -----------------------------------------------------------
+//
+// The mean orientation of the window (see angles.h). The samples are taken in blocks,
+// in vectorized loops, and the sums are kept for each position in the block.
+// The pitch and the tilt do not wrap around, so they are the plain means. The roll is
+// the circular mean: the angle of the sum of the unit vectors (z, y) / sqrt(y^2 + z^2),
+// so that a device upside down, with the roll near pi and -pi, has the mean near pi too.
+// If the unit vectors cancel out, the roll has no direction and is zero.
+// The zeros that pad the last block add nothing to any of the sums.
+
+#define WINDOW_ORIENTATION_BLOCK 32
+
+// The smallest mean length of the sum of the unit vectors of the roll
+#ifndef WINDOW_ORIENTATION_MIN_RESULTANT
+#define WINDOW_ORIENTATION_MIN_RESULTANT 1e-3f
+#endif
+
+typedef struct {
+    float pitch;
+    float roll;
+    float tilt;
+} window_orientation_t;
+
+typedef struct {
+    float pitch[WINDOW_ORIENTATION_BLOCK];
+    float tilt[WINDOW_ORIENTATION_BLOCK];
+    float cos_roll[WINDOW_ORIENTATION_BLOCK];
+    float sin_roll[WINDOW_ORIENTATION_BLOCK];
+} window_orientation_sums_t;
+
+static inline void window_orientation_block(const accel_t *restrict in,
+                                            window_orientation_sums_t *restrict s)
+{
+    float x[WINDOW_ORIENTATION_BLOCK];
+    float y[WINDOW_ORIENTATION_BLOCK];
+    float z[WINDOW_ORIENTATION_BLOCK];
+    float yz[WINDOW_ORIENTATION_BLOCK];
+    float xy[WINDOW_ORIENTATION_BLOCK];
+    float angle[WINDOW_ORIENTATION_BLOCK];
+    int k;
+
+    for (k = 0; k < WINDOW_ORIENTATION_BLOCK; ++k) {
+        x[k] = -in[k].v[0];
+        y[k] = in[k].v[1];
+        z[k] = in[k].v[2];
+        yz[k] = in[k].v[1] * in[k].v[1] + in[k].v[2] * in[k].v[2];
+        xy[k] = in[k].v[0] * in[k].v[0] + in[k].v[1] * in[k].v[1];
+    }
+    sqrt_block_f(yz, WINDOW_ORIENTATION_BLOCK);
+    sqrt_block_f(xy, WINDOW_ORIENTATION_BLOCK);
+
+    atan2_block_f(x, yz, angle, WINDOW_ORIENTATION_BLOCK);
+    for (k = 0; k < WINDOW_ORIENTATION_BLOCK; ++k) {
+        s->pitch[k] += angle[k];
+    }
+    atan2_block_f(xy, z, angle, WINDOW_ORIENTATION_BLOCK);
+    for (k = 0; k < WINDOW_ORIENTATION_BLOCK; ++k) {
+        s->tilt[k] += angle[k];
+    }
+    for (k = 0; k < WINDOW_ORIENTATION_BLOCK; ++k) {
+        float length = yz[k] > 1e-30f ? yz[k] : 1e-30f;
+        s->cos_roll[k] += z[k] / length;
+        s->sin_roll[k] += y[k] / length;
+    }
+}
+
+static inline void window_orientation(const accel_t *w, window_orientation_t *o)
+{
+    window_orientation_sums_t s;
+    float pitch = 0.0f, tilt = 0.0f, cos_roll = 0.0f, sin_roll = 0.0f;
+    int i, k;
+
+    memset(&s, 0, sizeof(s));
+    for (i = 0; i + WINDOW_ORIENTATION_BLOCK <= TIME_WINDOW_SIZE; i += WINDOW_ORIENTATION_BLOCK) {
+        window_orientation_block(&w[i], &s);
+    }
+    if (i < TIME_WINDOW_SIZE) {
+        accel_t tail[WINDOW_ORIENTATION_BLOCK] = {0};
+        memcpy(tail, &w[i], (TIME_WINDOW_SIZE - i) * sizeof(accel_t));
+        window_orientation_block(tail, &s);
+    }
+
+    for (k = 0; k < WINDOW_ORIENTATION_BLOCK; ++k) {
+        pitch += s.pitch[k];
+        tilt += s.tilt[k];
+        cos_roll += s.cos_roll[k];
+        sin_roll += s.sin_roll[k];
+    }
+    o->pitch = pitch / TIME_WINDOW_SIZE;
+    o->roll = cos_roll * cos_roll + sin_roll * sin_roll
+        < WINDOW_ORIENTATION_MIN_RESULTANT * WINDOW_ORIENTATION_MIN_RESULTANT * TIME_WINDOW_SIZE * TIME_WINDOW_SIZE
+        ? 0.0f : atan2_fast_f(sin_roll, cos_roll);
+    o->tilt = tilt / TIME_WINDOW_SIZE;
+}
+
+// -----------------------------------------------------------
+
+// Put the int8 values in 256 bins
+static inline void window_histogram(const accel_t *w, int axis, histogram_bin_t stats[256])
+{
+    int j;
+    memset(stats, 0, 256 * sizeof(histogram_bin_t));
+    for (j = 0; j < TIME_WINDOW_SIZE; ++j) {
+        stats[w[j].v[axis] + 128]++;
+    }
+}
+
+// Walk through the bins while the nth smallest value (counting from 1) is found
+static inline int window_histogram_select(const histogram_bin_t stats[256], int nth)
+{
+    int j;
+    for (j = 0; j < 256; ++j) {
+        if (stats[j] >= nth) break;
+        nth -= stats[j];
+    }
+    return j - 128;
+}
+
+// The entropy of the distribution of the values
+static inline float window_entropy(const histogram_bin_t stats[256])
+{
+    int j;
+    float entropy = 0.0;
+    for (j = 0; j < 256; ++j) {
+        entropy += entropy_lookup_table[stats[j]];
+    }
+    return entropy;
+}
+
+// -----------------------------------------------------------
+//
+// When the smallest and the largest value are known, e.g. from the min and max
+// of the window, only the bins between them are used. That makes the histograms
+// of constant and near-constant windows (of a device at rest) cheap.
+// The empty bins add nothing to the entropy, so the results are the same.
+
+// Are the first `n` values of the axis all the same?
+static inline bool window_is_constant(const accel_t *w, int axis, int n)
+{
+    int j;
+    for (j = 1; j < n; ++j) {
+        if (w[j].v[axis] != w[0].v[axis]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static inline void window_histogram_range(const accel_t *w, int axis, int lo, int hi,
+                                          histogram_bin_t stats[256])
+{
+    int j;
+    if (lo == hi) {
+        // a constant window
+        stats[lo + 128] = TIME_WINDOW_SIZE;
+        return;
+    }
+    memset(&stats[lo + 128], 0, (hi - lo + 1) * sizeof(histogram_bin_t));
+    for (j = 0; j < TIME_WINDOW_SIZE; ++j) {
+        stats[w[j].v[axis] + 128]++;
+    }
+}
+
+static inline int window_histogram_select_range(const histogram_bin_t stats[256], int lo, int nth)
+{
+    int j;
+    for (j = lo + 128; j < 256; ++j) {
+        if (stats[j] >= nth) break;
+        nth -= stats[j];
+    }
+    return j - 128;
+}
+
+static inline float window_entropy_range(const histogram_bin_t stats[256], int lo, int hi)
+{
+    int j;
+    float entropy = 0.0;
+    for (j = lo + 128; j <= hi + 128; ++j) {
+        entropy += entropy_lookup_table[stats[j]];
+    }
+    return entropy;
+}
+
+#endif // WINDOW_FEATURES_H
@@ -0,0 +1,237 @@
+/*
+ * Copyright (c) 2019, Institute of Electronics and Computer Science (EDI)
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * Author: Atis Elsts
+ */
+
+/*
+ * File: window-lanes.h
+ * Cross-window kernels: the time domain features of WINDOW_LANES windows at once.
+ *
+ * The windows are transposed in a tile, with the sample `j` of the window `l`
+ * at `[j][l]`, so the inner loops go over the windows and are vectorized,
+ * whatever the length of the windows is. The windows can be from different
+ * streams or from different offsets of the same one.
+ * The sums are the same as those of window-features.h, and so are the features.
+ */
+
+#ifndef WINDOW_LANES_H
+#define WINDOW_LANES_H
+
+#include <stdint.h>
+#include "main.h"
+
+// -----------------------------------------------------------
+
+typedef int8_t window_lanes_t[TIME_WINDOW_SIZE][WINDOW_LANES];
+
+// The sums of up to 256 int8 values fit in 16 bits, so those are summed
+// in 16-bit lanes, twice as many per vector; the sums of squares and products
+// need the full window_sum_t
+#if TIME_WINDOW_SIZE <= 256 && !WINDOW_WIDE_SUMS
+typedef int16_t window_lanes_sum_t;
+#else
+typedef window_sum_t window_lanes_sum_t;
+#endif
+
+// Transpose `n` windows, the window `l` starting at `first[l * stride]`;
+// the lanes from `n` on are zero
+static inline void window_lanes_load(window_lanes_t t, const accel_t *first, int stride,
+                                     int n, int axis)
+{
+    int j, l;
+    for (l = 0; l < n; ++l) {
+        const accel_t *w = &first[l * stride];
+        for (j = 0; j < TIME_WINDOW_SIZE; ++j) {
+            t[j][l] = w[j].v[axis];
+        }
+    }
+    for (; l < WINDOW_LANES; ++l) {
+        for (j = 0; j < TIME_WINDOW_SIZE; ++j) {
+            t[j][l] = 0;
+        }
+    }
+}
+
+// The same for two axes, with a single pass over the samples
+static inline void window_lanes_load2(window_lanes_t t1, window_lanes_t t2,
+                                      const accel_t *first, int stride, int n,
+                                      int axis1, int axis2)
+{
+    int j, l;
+    for (l = 0; l < n; ++l) {
+        const accel_t *w = &first[l * stride];
+        for (j = 0; j < TIME_WINDOW_SIZE; ++j) {
+            t1[j][l] = w[j].v[axis1];
+            t2[j][l] = w[j].v[axis2];
+        }
+    }
+    for (; l < WINDOW_LANES; ++l) {
+        for (j = 0; j < TIME_WINDOW_SIZE; ++j) {
+            t1[j][l] = 0;
+            t2[j][l] = 0;
+        }
+    }
+}
+
+// The same for all axes
+static inline void window_lanes_load3(window_lanes_t t[NUM_AXIS],
+                                      const accel_t *first, int stride, int n)
+{
+    int j, l;
+    for (l = 0; l < n; ++l) {
+        const accel_t *w = &first[l * stride];
+        for (j = 0; j < TIME_WINDOW_SIZE; ++j) {
+            t[0][j][l] = w[j].v[0];
+            t[1][j][l] = w[j].v[1];
+            t[2][j][l] = w[j].v[2];
+        }
+    }
+    for (; l < WINDOW_LANES; ++l) {
+        for (j = 0; j < TIME_WINDOW_SIZE; ++j) {
+            t[0][j][l] = 0;
+            t[1][j][l] = 0;
+            t[2][j][l] = 0;
+        }
+    }
+}
+
+// The sums of the values and of their squares
+static inline void window_lanes_sums(const window_lanes_t t,
+                                     window_sum_t sum[WINDOW_LANES],
+                                     window_sqsum_t sqsum[WINDOW_LANES])
+{
+    int j, l;
+    window_lanes_sum_t s[WINDOW_LANES] = {0};
+    window_sqsum_t q[WINDOW_LANES] = {0};
+    for (j = 0; j < TIME_WINDOW_SIZE; ++j) {
+        for (l = 0; l < WINDOW_LANES; ++l) {
+            int v = t[j][l];
+            s[l] += v;
+            q[l] += (uint32_t)(v * v);
+        }
+    }
+    for (l = 0; l < WINDOW_LANES; ++l) {
+        sum[l] = s[l];
+        sqsum[l] = q[l];
+    }
+}
+
+// The sums of the products of two axes
+static inline void window_lanes_cross_sums(const window_lanes_t t1, const window_lanes_t t2,
+                                           window_sum_t msum[WINDOW_LANES])
+{
+    int j, l;
+    window_sum_t m[WINDOW_LANES] = {0};
+    for (j = 0; j < TIME_WINDOW_SIZE; ++j) {
+        for (l = 0; l < WINDOW_LANES; ++l) {
+            int v1 = t1[j][l];
+            int v2 = t2[j][l];
+            m[l] += v1 * v2;
+        }
+    }
+    for (l = 0; l < WINDOW_LANES; ++l) {
+        msum[l] = m[l];
+    }
+}
+
+// The crossings of a level for each window, see window_crossings()
+static inline void window_lanes_crossings(const window_lanes_t t, const int level[WINDOW_LANES],
+                                          int count[WINDOW_LANES])
+{
+    int j, l;
+    int8_t lv[WINDOW_LANES];
+    window_lanes_sum_t c[WINDOW_LANES] = {0};
+    for (l = 0; l < WINDOW_LANES; ++l) {
+        lv[l] = level[l];
+    }
+    for (j = 0; j < TIME_WINDOW_SIZE - 1; ++j) {
+        for (l = 0; l < WINDOW_LANES; ++l) {
+            c[l] += (t[j][l] >= lv[l]) != (t[j + 1][l] >= lv[l]);
+        }
+    }
+    for (l = 0; l < WINDOW_LANES; ++l) {
+        count[l] = c[l];
+    }
+}
+
+// The peaks above a level for each window, see window_peaks()
+static inline void window_lanes_peaks(const window_lanes_t t, const int level[WINDOW_LANES],
+                                      int count[WINDOW_LANES],
+                                      int first[WINDOW_LANES], int last[WINDOW_LANES])
+{
+    int j, l;
+    int8_t lv[WINDOW_LANES];
+    window_lanes_sum_t c[WINDOW_LANES] = {0};
+    window_lanes_sum_t f[WINDOW_LANES], e[WINDOW_LANES];
+    int8_t r[WINDOW_LANES];
+    for (l = 0; l < WINDOW_LANES; ++l) {
+        lv[l] = level[l];
+        f[l] = TIME_WINDOW_SIZE;
+        e[l] = 0;
+        r[l] = 0;
+    }
+    for (j = 1; j < TIME_WINDOW_SIZE - 1; ++j) {
+        for (l = 0; l < WINDOW_LANES; ++l) {
+            int8_t v = t[j][l];
+            window_lanes_sum_t is_peak;
+            r[l] = (v > t[j - 1][l]) | (r[l] & (v >= t[j - 1][l]));
+            is_peak = r[l] & (v > t[j + 1][l]) & (v > lv[l]);
+            c[l] += is_peak;
+            f[l] = min(f[l], is_peak ? j : TIME_WINDOW_SIZE);
+            e[l] = is_peak ? j : e[l];
+        }
+    }
+    for (l = 0; l < WINDOW_LANES; ++l) {
+        count[l] = c[l];
+        first[l] = f[l];
+        last[l] = e[l];
+    }
+}
+
+static inline void window_lanes_min_max(const window_lanes_t t,
+                                        int minval[WINDOW_LANES], int maxval[WINDOW_LANES])
+{
+    int j, l;
+    int8_t mn[WINDOW_LANES], mx[WINDOW_LANES];
+    for (l = 0; l < WINDOW_LANES; ++l) {
+        mn[l] = INT8_MAX;
+        mx[l] = INT8_MIN;
+    }
+    for (j = 0; j < TIME_WINDOW_SIZE; ++j) {
+        for (l = 0; l < WINDOW_LANES; ++l) {
+            mn[l] = t[j][l] < mn[l] ? t[j][l] : mn[l];
+            mx[l] = t[j][l] > mx[l] ? t[j][l] : mx[l];
+        }
+    }
+    for (l = 0; l < WINDOW_LANES; ++l) {
+        minval[l] = mn[l];
+        maxval[l] = mx[l];
+    }
+}
+
+#endif // WINDOW_LANES_H